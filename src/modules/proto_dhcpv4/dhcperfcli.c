@@ -8,8 +8,15 @@
 #include "dpc_packet_list.h"
 #include "dpc_util.h"
 #include "dpc_xlat.h"
+#include "dpc_templ.h"
+#include "dpc_responder.h"
+#include "dpc_bench.h"
+#include "dpc_population.h"
 
 #include <getopt.h>
+#include <math.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 static char const *prog_version = RADIUSD_VERSION_STRING_BUILD("FreeRADIUS");
 
@@ -34,6 +41,10 @@ int dpc_debug_lvl = 0;
 
 dpc_context_t exe_ctx = {
 	.progress_interval = 10.0,
+	.ts_interval = 1.0,
+	.search_step = 10.0,
+	.sla_loss = 1.0,
+	.sla_rtt_percentile = 99,
 	.request_timeout = 1.0,
 	.retransmit_max = 2,
 	.session_max_active = 1,
@@ -61,12 +72,17 @@ fr_dict_attr_t const *attr_rate_limit;
 fr_dict_attr_t const *attr_max_duration;
 fr_dict_attr_t const *attr_max_use;
 fr_dict_attr_t const *attr_request_label;
+fr_dict_attr_t const *attr_rate_profile;
 
 fr_dict_attr_t const *attr_dhcp_hop_count;
 fr_dict_attr_t const *attr_dhcp_transaction_id;
+fr_dict_attr_t const *attr_dhcp_number_of_seconds;
+fr_dict_attr_t const *attr_dhcp_flags;
 fr_dict_attr_t const *attr_dhcp_client_ip_address;
 fr_dict_attr_t const *attr_dhcp_your_ip_address;
+fr_dict_attr_t const *attr_dhcp_server_ip_address;
 fr_dict_attr_t const *attr_dhcp_gateway_ip_address;
+fr_dict_attr_t const *attr_dhcp_client_hardware_address;
 fr_dict_attr_t const *attr_dhcp_server_identifier;
 fr_dict_attr_t const *attr_dhcp_requested_ip_address;
 fr_dict_attr_t const *attr_dhcp_message_type;
@@ -109,12 +125,17 @@ fr_dict_attr_autoload_t dpc_dict_attr_autoload[] = {
 	{ .out = &attr_max_duration, .name = "Max-Duration", .type = FR_TYPE_STRING, .dict = &dict_dhcperfcli },
 	{ .out = &attr_max_use, .name = "Max-Use", .type = FR_TYPE_UINT32, .dict = &dict_dhcperfcli },
 	{ .out = &attr_request_label, .name = "Request-Label", .type = FR_TYPE_STRING, .dict = &dict_dhcperfcli },
+	{ .out = &attr_rate_profile, .name = "Rate-Profile", .type = FR_TYPE_STRING, .dict = &dict_dhcperfcli },
 
 	{ .out = &attr_dhcp_hop_count, .name = "DHCP-Hop-Count", .type = FR_TYPE_UINT8, .dict = &dict_dhcpv4 },
 	{ .out = &attr_dhcp_transaction_id, .name = "DHCP-Transaction-Id", .type = FR_TYPE_UINT32, .dict = &dict_dhcpv4 },
+	{ .out = &attr_dhcp_number_of_seconds, .name = "DHCP-Number-of-Seconds", .type = FR_TYPE_UINT16, .dict = &dict_dhcpv4 },
+	{ .out = &attr_dhcp_flags, .name = "DHCP-Flags", .type = FR_TYPE_UINT16, .dict = &dict_dhcpv4 },
 	{ .out = &attr_dhcp_client_ip_address, .name = "DHCP-Client-IP-Address", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
 	{ .out = &attr_dhcp_your_ip_address, .name = "DHCP-Your-IP-Address", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
+	{ .out = &attr_dhcp_server_ip_address, .name = "DHCP-Server-IP-Address", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
 	{ .out = &attr_dhcp_gateway_ip_address, .name = "DHCP-Gateway-IP-Address", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
+	{ .out = &attr_dhcp_client_hardware_address, .name = "DHCP-Client-Hardware-Address", .type = FR_TYPE_ETHERNET, .dict = &dict_dhcpv4 },
 
 	{ .out = &attr_dhcp_server_identifier, .name = "DHCP-DHCP-Server-Identifier", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
 	{ .out = &attr_dhcp_requested_ip_address, .name = "DHCP-Requested-IP-Address", .type = FR_TYPE_IPV4_ADDR, .dict = &dict_dhcpv4 },
@@ -128,12 +149,18 @@ static int packet_trace_lvl = -1; /* If unspecified, figure out something automa
 
 static dpc_packet_list_t *pl; /* List of outgoing packets. */
 static fr_event_list_t *event_list;
+static ncc_list_t timeout_list; /* Sessions with an armed request timeout, ordered by deadline. */
 
 static bool with_stdin_input = false; /* Whether we have something from stdin or not. */
 static char const *file_vps_in;
 static ncc_list_t vps_list_in;
+
+static FILE *input_stream_fp; /* Source from which input items are currently being streamed. */
+static char const *input_stream_name; /* Name of that source (NULL if streaming has not started). */
+static uint32_t input_stream_num = 0; /* Number of valid input items streamed so far. */
 static int with_template = 0;
 static int with_xlat = 0;
+static int with_co_correct = 0; /* Also measure rtt from the intended start of sessions (coordinated omission). */
 static ncc_list_item_t *template_input_prev; /* In template mode, previous used input item. */
 
 static ncc_endpoint_t server_ep = {
@@ -145,6 +172,19 @@ static ncc_endpoint_t client_ep = {
 	.port = DHCP_PORT_CLIENT
 };
 
+static bool with_responder = false; /* Answer requests (loopback responder), instead of sending them. */
+static ncc_endpoint_t responder_ep = {
+	.ipaddr = { .af = AF_INET, .prefix = 32 },
+	.port = DHCP_PORT_SERVER
+};
+static dpc_responder_t *responder;
+
+static dpc_bench_format_t bench_format = 0; /* Run microbenchmarks (and report in this format), instead of sending requests. */
+static char const *bench_filter; /* Only run benchmarks whose name contain this. */
+
+static dpc_population_t *population; /* Simulated clients, which acquire and renew leases (population mode). */
+static char const *lease_file; /* Leases of simulated clients are loaded from (if it exists) and saved to this file. */
+
 static ncc_endpoint_list_t *gateway_list; /* List of gateways. */
 static fr_ipaddr_t allowed_server; /* Only allow replies from a specific server. */
 
@@ -165,6 +205,9 @@ static uint32_t session_num_active = 0; /* Number of active sessions. */
 static uint32_t session_num_in_active = 0; /* Number of active sessions from input. */
 static uint32_t session_num_parallel = 0; /* Number of active sessions from input which are handling initial request. */
 
+static dpc_session_ctx_t *session_free_list; /* Session contexts which are not in use, and can be reused. */
+static uint32_t session_free_num = 0; /* Number of session contexts in the free list. */
+
 static bool job_done = false;
 static bool signal_done = false;
 
@@ -173,9 +216,53 @@ static uint32_t *retr_breakdown; /* Retransmit breakdown by number of retransmis
 static fr_event_timer_t const *ev_progress_stats;
 static fr_time_t fte_progress_stat; /* When next ongoing statistics is supposed to fire. */
 
+static char const *file_ts_out; /* File to which time-series statistics are written. */
+static FILE *fp_ts;
+static fr_event_timer_t const *ev_ts_stats;
+static fr_time_t fte_ts_stat; /* When next time-series statistics record is supposed to be written. */
+static dpc_ts_snapshot_t ts_prev; /* Statistics at the end of previous time-series interval. */
+
 static fr_time_delta_t ftd_loop_max_time = 50 * 1000 * 1000; /* Max time spent in each iteration of the start loop. */
+static bool loop_sampled = false; /* Whether the current iteration of the main loop is timed. */
+static fr_time_delta_t ftd_loop_idle; /* Time spent waiting in the current iteration of the main loop (if timed). */
+static fr_time_t fte_loop_prev; /* Previous progress statistics: when they were produced. */
+static dpc_loop_stats_t loop_prev; /* And main loop statistics at that time. */
+static uint32_t loop_session_num_in_prev; /* And number of sessions initialized from input. */
+static bool loop_saturated = false; /* Whether we've warned that the client is saturated. */
+
+static dpc_rate_profile_t *rate_profile; /* Global rate schedule (instead of a fixed rate limit). */
+
+static fr_time_t fte_pacing_next; /* When the next session is scheduled to be started (with pacing). */
+static double pacing_due; /* Number of sessions due (according to the rate schedule) when the next one is to be started. */
+static double rate_idle_elapsed; /* Population mode: elapsed time when clients last had nothing to do. */
+static uint32_t rate_idle_num; /* Population mode: number of sessions started when clients last had nothing to do. */
+static fr_time_t fte_pacing_prev; /* When the previous session was started (with pacing). */
+static fr_time_delta_t ftd_pacing_spin = 1100 * 1000; /* Below this, busy-wait for the next session to be started.
+                                                       * (epoll has a millisecond granularity.) */
+
+static fr_event_timer_t const *ev_search;
+static fr_time_t fte_search; /* When the saturation search is next supposed to check on the current step. */
+static bool search_measuring; /* If the current step is being measured (i.e. its warm-up is over). */
+static dpc_ts_snapshot_t search_snap; /* Statistics at the start of the measurement of current step. */
+static double search_rate; /* Rate of the current step. */
+static double search_low; /* Highest rate sustained within the SLA so far (0: none yet). */
+static double search_high; /* Lowest rate not sustained within the SLA so far (0: none yet). */
+static dpc_search_step_t *search_steps; /* The curve of rate vs. latency and loss. */
+static uint32_t search_num_steps;
 
 static bool multi_offer = false;
+
+/* Percentiles of rtt which are reported in statistics. */
+static double const rtt_percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+#define NUM_RTT_PERCENTILES (int)(sizeof(rtt_percentiles) / sizeof(rtt_percentiles[0]))
+
+static dpc_worker_stats_t *worker_stats_shm; /* Statistics of all the workers (memory shared with the parent). */
+static dpc_worker_stats_t *worker_stats; /* In a worker process: our own statistics. NULL otherwise. */
+static uint32_t worker_id; /* In a worker process: our id (0 for the first one). */
+static bool worker_tr_types_truncated = false; /* In a worker process: whether some transaction types are not published. */
+static uint32_t num_workers_running; /* In the parent process: number of workers still running. */
+static dpc_worker_sockets_t *worker_sockets; /* Groups of sockets shared by the workers. */
+static uint32_t num_worker_sockets;
 #ifdef HAVE_LIBPCAP
 static fr_pcap_t *pcap;
 static char *iface;
@@ -236,7 +323,6 @@ static char const *transaction_types[DPC_TR_MAX] = {
 	"<DORA>"
 };
 #define LG_PAD_TR_TYPE_MAX 50 /* Limit transaction type name displayed. */
-#define LG_PAD_STATS       20
 
 static ncc_str_array_t *arr_tr_types; /* Store dynamically encountered transaction types. */
 
@@ -259,20 +345,35 @@ static double dpc_start_sessions_elapsed_time_get(void);
 static double dpc_get_tr_rate(dpc_transaction_stats_t *my_stat);
 static double dpc_get_session_in_rate(bool per_input);
 static size_t dpc_tr_name_max_len(void);
+static void dpc_rtt_percentiles_fprint(FILE *fp, dpc_histogram_t const *histo, uint32_t num,
+                                       fr_time_delta_t rtt_min, fr_time_delta_t rtt_max);
 static int dpc_tr_stat_fprint(FILE *fp, unsigned int pad_len, dpc_transaction_stats_t *my_stats, char const *name);
 static void dpc_tr_stats_fprint(FILE *fp);
 static void dpc_stats_fprint(FILE *fp);
-static void dpc_tr_stats_update(dpc_transaction_type_t tr_type, fr_time_delta_t rtt);
+static void dpc_pacing_stats_fprint(FILE *fp);
+static double dpc_loop_busy_get(dpc_loop_stats_t const *loop, dpc_loop_stats_t const *prev);
+static void dpc_loop_stats_fprint(FILE *fp);
+static void dpc_loop_saturation_check(FILE *fp);
+static void dpc_population_stats_sync(void);
+static void dpc_population_stats_fprint(FILE *fp);
+static void dpc_tr_stats_update(dpc_transaction_type_t tr_type, fr_time_delta_t rtt, fr_time_delta_t rtt_wire,
+                                fr_time_delta_t rtt_co);
 static void dpc_statistics_update(dpc_session_ctx_t *session, DHCP_PACKET *request, DHCP_PACKET *reply);
 
 static void dpc_progress_stats(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, UNUSED void *ctx);
 static void dpc_event_add_progress_stats(void);
-static void dpc_request_timeout(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, void *uctx);
-static void dpc_event_add_request_timeout(dpc_session_ctx_t *session, fr_time_delta_t *timeout_in);
-
-static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_p);
+static void dpc_ts_init(void);
+static void dpc_ts_record(fr_time_t now, bool header);
+static void dpc_event_add_ts_stats(void);
+static void dpc_request_timeout(dpc_session_ctx_t *session);
+static void dpc_request_timeout_arm(dpc_session_ctx_t *session);
+
+static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_p, bool defer);
+static void dpc_packet_sent(dpc_session_ctx_t *session, DHCP_PACKET *packet);
+static void dpc_packet_sent_deferred(DHCP_PACKET **packet_p, bool sent);
+static void dpc_send_error_count(int err);
 static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time);
-static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *reply);
+static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *reply, dpc_reply_info_t *reply_info);
 static bool dpc_session_dora_request(dpc_session_ctx_t *session);
 static bool dpc_session_dora_release(dpc_session_ctx_t *session);
 static bool dpc_session_dora_decline(dpc_session_ctx_t *session);
@@ -289,20 +390,38 @@ static bool dpc_item_get_rate(double *input_rate, dpc_input_t *input);
 static bool dpc_item_rate_limited(dpc_input_t *input);
 static dpc_input_t *dpc_get_input_from_template(TALLOC_CTX *ctx);
 static dpc_input_t *dpc_get_input(void);
+static dpc_session_ctx_t *dpc_session_alloc(TALLOC_CTX *ctx);
+static void dpc_session_release(dpc_session_ctx_t *session);
+static fr_time_t dpc_session_intended_start(dpc_session_ctx_t *session, dpc_input_t *input);
 static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx);
+static dpc_session_ctx_t *dpc_client_session_init(TALLOC_CTX *ctx, uint32_t idx, unsigned int code,
+                                                  uint32_t ciaddr, uint32_t server_id);
+static dpc_session_ctx_t *dpc_session_init_from_population(TALLOC_CTX *ctx);
+static void dpc_population_release_all(void);
 static void dpc_session_finish(dpc_session_ctx_t *session);
 
 static void dpc_loop_recv(void);
-static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit_ref, float elapsed_ref, uint32_t cur_num_started);
+static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit_ref, dpc_rate_profile_t const *profile,
+                                    float elapsed_ref, uint32_t cur_num_started);
 static bool dpc_rate_limit_calc(uint32_t *max_new_sessions);
+static bool dpc_with_rate_limit(void);
+static double dpc_rate_limit_get(void);
+static double dpc_rate_due(double elapsed);
+static double dpc_item_rate_limit_get(dpc_input_t *input);
+static bool dpc_pacing_active(void);
+static void dpc_pacing_update(fr_time_t fte_started);
 static void dpc_end_start_sessions(void);
 static uint32_t dpc_loop_start_sessions(void);
 static bool dpc_loop_check_done(void);
 static void dpc_main_loop(void);
 
 static bool dpc_parse_input(dpc_input_t *input);
-static void dpc_handle_input(dpc_input_t *input, ncc_list_t *list);
+static void dpc_input_stream_hold(dpc_input_t *input);
+static bool dpc_handle_input(dpc_input_t *input, ncc_list_t *list);
+static dpc_input_t *dpc_input_read(TALLOC_CTX *ctx, FILE *file_in, char const *filename, bool *file_done);
 static void dpc_input_load_from_fd(TALLOC_CTX *ctx, FILE *file_in, ncc_list_t *list, char const *filename);
+static bool dpc_input_stream_next_source(void);
+static void dpc_input_stream_read(TALLOC_CTX *ctx);
 static int dpc_input_load(TALLOC_CTX *ctx);
 static int dpc_pair_list_xlat(DHCP_PACKET *packet, VALUE_PAIR *vps);
 
@@ -313,8 +432,28 @@ static void dpc_packet_list_init(TALLOC_CTX *ctx);
 static int dpc_command_parse(char const *command);
 static ncc_endpoint_list_t *dpc_addr_list_parse(TALLOC_CTX *ctx, ncc_endpoint_list_t **ep_list, char const *in,
                                                 ncc_endpoint_t *default_ep);
+static bool dpc_sla_rtt_parse(char const *in);
 static void dpc_options_parse(int argc, char **argv);
 
+static int dpc_worker_socket_provide(fr_ipaddr_t *src_ipaddr, uint16_t src_port);
+static int dpc_socket_preallocate(fr_ipaddr_t *src_ipaddr, uint16_t src_port);
+static void dpc_workers_start(void);
+static void dpc_worker_init(void);
+static void dpc_population_init(void);
+static void dpc_worker_stats_publish(void);
+static void dpc_workers_stats_merge(void);
+static void dpc_workers_wait(void);
+
+static void dpc_search_init(void);
+static void dpc_search_step_eval(fr_time_t now);
+static bool dpc_search_next(void);
+static void dpc_search_event(fr_event_list_t *el, fr_time_t now, void *ctx);
+static void dpc_event_add_search(void);
+static void dpc_search_fprint(FILE *fp);
+
+static void NEVER_RETURNS dpc_responder_main(void);
+static void NEVER_RETURNS dpc_bench_main(void);
+
 static void dpc_signal(int sig);
 static void dpc_end(void);
 
@@ -443,12 +582,42 @@ static void dpc_progress_stats_fprint(FILE *fp, bool force)
 	if (session_num_in >= ECTX.min_session_for_rps
 	    && dpc_job_elapsed_time_get() >= ECTX.min_session_time_for_rps
 		&& start_sessions_flag) {
-		bool per_input = ECTX.rate_limit ? false : true;
+		bool per_input = (dpc_with_rate_limit() || worker_stats_shm) ? false : true; /* Workers inputs are not known here. */
 		fprintf(fp, ", session rate (/s): %.3f", dpc_get_session_in_rate(per_input));
 	}
 
+	/* Current target rate, if following a rate schedule. */
+	if (rate_profile && start_sessions_flag) {
+		fprintf(fp, ", target rate (/s): %.3f", dpc_rate_limit_get());
+	}
+
+	/* Percentiles of rtt (all unitary transactions), if we have some. */
+	if (stat_ctx.tr_stats[DPC_TR_ALL].num > 0) {
+		fprintf(fp, ", RTT (ms): [");
+		dpc_transaction_stats_t *my_stats = &stat_ctx.tr_stats[DPC_TR_ALL];
+		dpc_rtt_percentiles_fprint(fp, &my_stats->rtt_histo, my_stats->num, my_stats->rtt_min, my_stats->rtt_max);
+		fprintf(fp, "]");
+	}
+
+	/* Simulated clients, and where they stand with their lease. */
+	dpc_population_stats_sync();
+	if (stat_ctx.population.num > 0) {
+		dpc_population_stats_t *ps = &stat_ctx.population;
+
+		fprintf(fp, ", clients: [selecting: %u, bound: %u, renewing: %u, rebinding: %u]",
+		        ps->num_state[DPC_CLIENT_SELECTING], ps->num_state[DPC_CLIENT_BOUND],
+		        ps->num_state[DPC_CLIENT_RENEWING], ps->num_state[DPC_CLIENT_REBINDING]);
+	}
+
+	/* How busy the client has been since previous progress statistics (if we know). */
+	if (stat_ctx.loop.num_sampled > loop_prev.num_sampled) {
+		fprintf(fp, ", client busy: %.1f%%", dpc_loop_busy_get(&stat_ctx.loop, &loop_prev));
+	}
+
 	fprintf(fp, "\n");
 
+	dpc_loop_saturation_check(fp);
+
 	/* Per-input statistics line. */
 	if (session_num_in >= ECTX.min_session_for_rps) {
 		dpc_per_input_stats_fprint(fp, force);
@@ -580,6 +749,26 @@ static size_t dpc_tr_name_max_len(void)
 	return max_len;
 }
 
+/*
+ *	Print rtt percentiles from a histogram.
+ *	Values are bounded by the actual lowest and highest rtt (which are more precise than the histogram).
+ */
+static void dpc_rtt_percentiles_fprint(FILE *fp, dpc_histogram_t const *histo, uint32_t num,
+                                       fr_time_delta_t rtt_min, fr_time_delta_t rtt_max)
+{
+	fr_time_delta_t values[NUM_RTT_PERCENTILES];
+	int i;
+
+	dpc_histogram_percentiles(values, histo, num, rtt_percentiles, NUM_RTT_PERCENTILES);
+
+	for (i = 0; i < NUM_RTT_PERCENTILES; i++) {
+		if (values[i] < rtt_min) values[i] = rtt_min;
+		if (values[i] > rtt_max) values[i] = rtt_max;
+
+		fprintf(fp, "%sp%g: %.3f", i ? ", " : "", rtt_percentiles[i], 1000 * ncc_fr_time_to_float(values[i]));
+	}
+}
+
 /*
  *	Print statistics for a given transaction type.
  */
@@ -591,8 +780,28 @@ static int dpc_tr_stat_fprint(FILE *fp, unsigned int pad_len, dpc_transaction_st
 	double rtt_min = 1000 * ncc_fr_time_to_float(my_stats->rtt_min);
 	double rtt_max = 1000 * ncc_fr_time_to_float(my_stats->rtt_max);
 
-	fprintf(fp, "\t%-*.*s: num: %u, RTT (ms): [avg: %.3f, min: %.3f, max: %.3f]",
-	        pad_len, pad_len, name, my_stats->num, rtt_avg, rtt_min, rtt_max);
+	fprintf(fp, "\t%-*.*s: num: %u, %s (ms): [avg: %.3f, min: %.3f, max: %.3f, ",
+	        pad_len, pad_len, name, my_stats->num, ECTX.timestamping ? "app RTT" : "RTT", rtt_avg, rtt_min, rtt_max);
+	dpc_rtt_percentiles_fprint(fp, &my_stats->rtt_histo, my_stats->num, my_stats->rtt_min, my_stats->rtt_max);
+	fprintf(fp, "]");
+
+	/* Print corrected RTT if we have it. */
+	if (my_stats->rtt_co_cumul) {
+		fprintf(fp, ", corrected RTT (ms): [avg: %.3f, min: %.3f, max: %.3f, ",
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_co_cumul) / my_stats->num,
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_co_min),
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_co_max));
+		dpc_rtt_percentiles_fprint(fp, &my_stats->rtt_co_histo, my_stats->num, my_stats->rtt_co_min, my_stats->rtt_co_max);
+		fprintf(fp, "]");
+	}
+
+	/* Print wire RTT if we have timestamps. */
+	if (my_stats->num_wire > 0) {
+		fprintf(fp, ", wire RTT (ms): [avg: %.3f, min: %.3f, max: %.3f]",
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_wire_cumul) / my_stats->num_wire,
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_wire_min),
+		        1000 * ncc_fr_time_to_float(my_stats->rtt_wire_max));
+	}
 
 	/* Print rate if job elapsed time is at least 1 s. */
 	if (dpc_job_elapsed_time_get() >= 1.0) {
@@ -682,16 +891,217 @@ static void dpc_stats_fprint(FILE *fp)
 	/* Packets received but which were not expected (timed out, sent to the wrong address, or whatever. */
 	fprintf(fp, "\t%-*.*s: %u\n", LG_PAD_STATS, LG_PAD_STATS, "Replies unexpected",
 	        stat_ctx.num_packet_recv_unexpected);
+
+	/* How well sessions have been paced (if they were). */
+	if (stat_ctx.pacing.num > 0) dpc_pacing_stats_fprint(fp);
+
+	/* Where time went in the main loop. */
+	if (stat_ctx.loop.num_sampled > 0) dpc_loop_stats_fprint(fp);
+
+	/* What became of simulated clients leases. */
+	dpc_population_stats_sync();
+	if (stat_ctx.population.num > 0) dpc_population_stats_fprint(fp);
+}
+
+/*
+ *	Print pacing statistics: lateness of sessions compared to their schedule, and achieved intervals between
+ *	sessions (with their standard deviation, i.e. jitter).
+ */
+static void dpc_pacing_stats_fprint(FILE *fp)
+{
+	dpc_pacing_stats_t *my_stats = &stat_ctx.pacing;
+	fr_time_delta_t values[NUM_RTT_PERCENTILES];
+	int i;
+
+	dpc_histogram_percentiles(values, &my_stats->late_histo, my_stats->num, rtt_percentiles, NUM_RTT_PERCENTILES);
+
+	fprintf(fp, "\t%-*.*s: [avg: %.1f", LG_PAD_STATS, LG_PAD_STATS, "Pacing late (us)",
+	        ncc_fr_time_to_float(my_stats->late_cumul) * 1000000 / my_stats->num);
+	for (i = 0; i < NUM_RTT_PERCENTILES; i++) {
+		if (values[i] > my_stats->late_max) values[i] = my_stats->late_max;
+		fprintf(fp, ", p%g: %.1f", rtt_percentiles[i], ncc_fr_time_to_float(values[i]) * 1000000);
+	}
+	fprintf(fp, ", max: %.1f]\n", ncc_fr_time_to_float(my_stats->late_max) * 1000000);
+
+	if (my_stats->num_gap > 0) {
+		double avg = my_stats->gap_cumul / my_stats->num_gap;
+		double variance = my_stats->gap_sq_cumul / my_stats->num_gap - avg * avg;
+
+		fprintf(fp, "\t%-*.*s: [avg: %.1f, min: %.1f, max: %.1f, jitter: %.1f]\n",
+		        LG_PAD_STATS, LG_PAD_STATS, "Pacing interval (us)", avg * 1000000,
+		        ncc_fr_time_to_float(my_stats->gap_min) * 1000000, ncc_fr_time_to_float(my_stats->gap_max) * 1000000,
+		        (variance > 0 ? sqrt(variance) : 0) * 1000000);
+	}
+}
+
+/*
+ *	Get how busy the client has been (%): the part of main loop time not spent waiting.
+ *	If a previous state is provided, this is for the interval since then.
+ */
+static double dpc_loop_busy_get(dpc_loop_stats_t const *loop, dpc_loop_stats_t const *prev)
+{
+	fr_time_delta_t total = 0, idle;
+	int i;
+
+	for (i = 0; i < DPC_LOOP_PHASE_MAX; i++) {
+		total += loop->phase[i] - (prev ? prev->phase[i] : 0);
+	}
+	if (total <= 0) return 0;
+
+	idle = loop->phase[DPC_LOOP_IDLE] - (prev ? prev->phase[DPC_LOOP_IDLE] : 0);
+
+	return 100 * (double)(total - idle) / total;
+}
+
+/*
+ *	Print main loop statistics: iterations, time spent in each phase, and send buffer full events.
+ */
+static void dpc_loop_stats_fprint(FILE *fp)
+{
+	dpc_loop_stats_t *loop = &stat_ctx.loop;
+	fr_time_delta_t total = 0;
+	double elapsed = dpc_job_elapsed_time_get();
+	int i;
+
+	for (i = 0; i < DPC_LOOP_PHASE_MAX; i++) {
+		total += loop->phase[i];
+	}
+
+	fprintf(fp, "\t%-*.*s: %"PRIu64" (rate (/s): %.1f, sessions per iteration: %.2f)\n",
+	        LG_PAD_STATS, LG_PAD_STATS, "Loop iterations", loop->num_iter, (elapsed > 0) ? loop->num_iter / elapsed : 0,
+	        (double)loop->num_started / loop->num_iter);
+
+	if (total > 0) {
+		fprintf(fp, "\t%-*.*s: [start: %.1f, recv: %.1f, timers: %.1f, idle: %.1f]\n",
+		        LG_PAD_STATS, LG_PAD_STATS, "Loop time (%)",
+		        100 * (double)loop->phase[DPC_LOOP_START] / total, 100 * (double)loop->phase[DPC_LOOP_RECV] / total,
+		        100 * (double)loop->phase[DPC_LOOP_TIMERS] / total, 100 * (double)loop->phase[DPC_LOOP_IDLE] / total);
+
+		fprintf(fp, "\t%-*.*s: %.1f\n", LG_PAD_STATS, LG_PAD_STATS, "Client busy (%)", dpc_loop_busy_get(loop, NULL));
+	}
+
+	if (loop->num_send_full > 0) {
+		fprintf(fp, "\t%-*.*s: %u\n", LG_PAD_STATS, LG_PAD_STATS, "Send buffer full", loop->num_send_full);
+	}
+}
+
+/*
+ *	Get the current statistics of simulated clients (population mode), if we have some.
+ *	(With workers, the parent gets them from the workers.)
+ */
+static void dpc_population_stats_sync(void)
+{
+	if (population) stat_ctx.population = *dpc_population_stats(population);
+}
+
+/*
+ *	Print simulated clients statistics: current state of clients, and what happened to their leases.
+ */
+static void dpc_population_stats_fprint(FILE *fp)
+{
+	dpc_population_stats_t *my_stats = &stat_ctx.population;
+
+	fprintf(fp, "\t%-*.*s: %u (init: %u, selecting: %u, bound: %u, renewing: %u, rebinding: %u)\n",
+	        LG_PAD_STATS, LG_PAD_STATS, "Clients", my_stats->num,
+	        my_stats->num_state[DPC_CLIENT_INIT], my_stats->num_state[DPC_CLIENT_SELECTING],
+	        my_stats->num_state[DPC_CLIENT_BOUND], my_stats->num_state[DPC_CLIENT_RENEWING],
+	        my_stats->num_state[DPC_CLIENT_REBINDING]);
+
+	fprintf(fp, "\t%-*.*s: [acquired: %u, renewed: %u, rebound: %u, expired: %u, nak: %u, released: %u]\n",
+	        LG_PAD_STATS, LG_PAD_STATS, "Leases", my_stats->num_acquired, my_stats->num_renewed,
+	        my_stats->num_rebound, my_stats->num_expired, my_stats->num_nak, my_stats->num_released);
+}
+
+/*
+ *	Check if the client itself (rather than the server) is limiting the rate of sessions, i.e. it is (almost) always
+ *	busy, while it could start more sessions: either there is no rate limit and sessions in parallel are below the max
+ *	allowed, or the rate achieved is below the target rate.
+ *	Warn when this starts happening (and when it stops). Then take a new reference for the next check.
+ */
+static void dpc_loop_saturation_check(FILE *fp)
+{
+	fr_time_t now = fr_time();
+	bool saturated = false;
+
+	if (start_sessions_flag && fte_loop_prev && stat_ctx.loop.num_sampled > loop_prev.num_sampled
+	    && dpc_loop_busy_get(&stat_ctx.loop, &loop_prev) >= DPC_LOOP_BUSY_WARN) {
+
+		if (dpc_with_rate_limit()) {
+			double elapsed = ncc_fr_time_to_float(now - fte_loop_prev);
+			double rate = (elapsed > 0) ? (session_num_in - loop_session_num_in_prev) / elapsed : 0;
+
+			saturated = (rate < DPC_SEARCH_ACHIEVED_MIN * dpc_rate_limit_get());
+		} else {
+			saturated = (session_num_active < ECTX.session_max_active);
+		}
+	}
+
+	if (saturated && !loop_saturated) {
+		fprintf(fp, "(*) Warning: client is saturated (busy: %.1f%%). The rate measured is limited by the client, not the server\n",
+		        dpc_loop_busy_get(&stat_ctx.loop, &loop_prev));
+	} else if (!saturated && loop_saturated) {
+		fprintf(fp, "(*) Client is no longer saturated\n");
+	}
+	loop_saturated = saturated;
+
+	fte_loop_prev = now;
+	loop_prev = stat_ctx.loop;
+	loop_session_num_in_prev = session_num_in;
+}
+
+/*
+ *	Merge main loop statistics into another.
+ */
+static void dpc_loop_stats_merge(dpc_loop_stats_t *my_stats, dpc_loop_stats_t const *in)
+{
+	int i;
+
+	my_stats->num_iter += in->num_iter;
+	my_stats->num_sampled += in->num_sampled;
+	for (i = 0; i < DPC_LOOP_PHASE_MAX; i++) {
+		my_stats->phase[i] += in->phase[i];
+	}
+	my_stats->num_started += in->num_started;
+	my_stats->num_send_full += in->num_send_full;
+}
+
+/*
+ *	Merge simulated clients statistics.
+ */
+static void dpc_population_stats_merge(dpc_population_stats_t *my_stats, dpc_population_stats_t const *in)
+{
+	int i;
+
+	my_stats->num += in->num;
+	for (i = 0; i < DPC_CLIENT_STATE_MAX; i++) {
+		my_stats->num_state[i] += in->num_state[i];
+	}
+	my_stats->num_acquired += in->num_acquired;
+	my_stats->num_renewed += in->num_renewed;
+	my_stats->num_rebound += in->num_rebound;
+	my_stats->num_expired += in->num_expired;
+	my_stats->num_nak += in->num_nak;
+	my_stats->num_released += in->num_released;
 }
 
 /*
  *	Update a type of transaction statistics, with one newly completed transaction:
  *	number of such transactions, cumulated rtt, min/max rtt.
+ *	Likewise for wire rtt, if known.
  */
-static void dpc_tr_stats_update_values(dpc_transaction_stats_t *my_stats, fr_time_delta_t rtt)
+static void dpc_tr_stats_update_values(dpc_transaction_stats_t *my_stats, fr_time_delta_t rtt, fr_time_delta_t rtt_wire,
+                                       fr_time_delta_t rtt_co)
 {
 	if (!rtt) return;
 
+	if (rtt_wire) {
+		if (my_stats->num_wire == 0 || rtt_wire < my_stats->rtt_wire_min) my_stats->rtt_wire_min = rtt_wire;
+		if (my_stats->num_wire == 0 || rtt_wire > my_stats->rtt_wire_max) my_stats->rtt_wire_max = rtt_wire;
+
+		my_stats->rtt_wire_cumul += rtt_wire;
+		my_stats->num_wire ++;
+	}
+
 	/* Update 'rtt_min'. */
 	if (my_stats->num == 0 || rtt < my_stats->rtt_min) {
 		my_stats->rtt_min = rtt;
@@ -702,22 +1112,86 @@ static void dpc_tr_stats_update_values(dpc_transaction_stats_t *my_stats, fr_tim
 		my_stats->rtt_max = rtt;
 	}
 
+	/* Same for corrected rtt, if we have it. */
+	if (rtt_co) {
+		if (my_stats->num == 0 || rtt_co < my_stats->rtt_co_min) my_stats->rtt_co_min = rtt_co;
+		if (my_stats->num == 0 || rtt_co > my_stats->rtt_co_max) my_stats->rtt_co_max = rtt_co;
+
+		my_stats->rtt_co_cumul += rtt_co;
+		dpc_histogram_add(&my_stats->rtt_co_histo, rtt_co);
+	}
+
 	/* Update 'rtt_cumul' and 'num'. */
 	my_stats->rtt_cumul += rtt;
 	my_stats->num ++;
+
+	dpc_histogram_add(&my_stats->rtt_histo, rtt);
+}
+
+/*
+ *	Merge statistics of a type of transaction into another.
+ */
+static void dpc_tr_stats_merge(dpc_transaction_stats_t *my_stats, dpc_transaction_stats_t const *in)
+{
+	if (in->num_wire) {
+		if (my_stats->num_wire == 0 || in->rtt_wire_min < my_stats->rtt_wire_min) my_stats->rtt_wire_min = in->rtt_wire_min;
+		if (my_stats->num_wire == 0 || in->rtt_wire_max > my_stats->rtt_wire_max) my_stats->rtt_wire_max = in->rtt_wire_max;
+
+		my_stats->rtt_wire_cumul += in->rtt_wire_cumul;
+		my_stats->num_wire += in->num_wire;
+	}
+
+	if (!in->num) return;
+
+	if (my_stats->num == 0 || in->rtt_min < my_stats->rtt_min) my_stats->rtt_min = in->rtt_min;
+	if (my_stats->num == 0 || in->rtt_max > my_stats->rtt_max) my_stats->rtt_max = in->rtt_max;
+
+	if (in->rtt_co_cumul) {
+		if (my_stats->num == 0 || in->rtt_co_min < my_stats->rtt_co_min) my_stats->rtt_co_min = in->rtt_co_min;
+		if (my_stats->num == 0 || in->rtt_co_max > my_stats->rtt_co_max) my_stats->rtt_co_max = in->rtt_co_max;
+
+		my_stats->rtt_co_cumul += in->rtt_co_cumul;
+		dpc_histogram_merge(&my_stats->rtt_co_histo, &in->rtt_co_histo);
+	}
+
+	my_stats->rtt_cumul += in->rtt_cumul;
+	my_stats->num += in->num;
+
+	dpc_histogram_merge(&my_stats->rtt_histo, &in->rtt_histo);
+}
+
+/*
+ *	Merge pacing statistics into another.
+ */
+static void dpc_pacing_stats_merge(dpc_pacing_stats_t *my_stats, dpc_pacing_stats_t const *in)
+{
+	if (in->late_max > my_stats->late_max) my_stats->late_max = in->late_max;
+	my_stats->late_cumul += in->late_cumul;
+	dpc_histogram_merge(&my_stats->late_histo, &in->late_histo);
+	my_stats->num += in->num;
+
+	if (!in->num_gap) return;
+
+	if (my_stats->num_gap == 0 || in->gap_min < my_stats->gap_min) my_stats->gap_min = in->gap_min;
+	if (my_stats->num_gap == 0 || in->gap_max > my_stats->gap_max) my_stats->gap_max = in->gap_max;
+
+	my_stats->gap_cumul += in->gap_cumul;
+	my_stats->gap_sq_cumul += in->gap_sq_cumul;
+	my_stats->num_gap += in->num_gap;
 }
 
 /*
  *	Update statistics for a type of transaction
  */
-static void dpc_tr_stats_update(dpc_transaction_type_t tr_type, fr_time_delta_t rtt)
+static void dpc_tr_stats_update(dpc_transaction_type_t tr_type, fr_time_delta_t rtt, fr_time_delta_t rtt_wire,
+                                fr_time_delta_t rtt_co)
 {
 	if (tr_type < 0 || tr_type >= DPC_TR_MAX) return;
 	if (!rtt) return;
 
 	dpc_transaction_stats_t *my_stats = &stat_ctx.tr_stats[tr_type];
 
-	dpc_tr_stats_update_values(my_stats, rtt);
+	dpc_tr_stats_update_values(my_stats, rtt, rtt_wire, rtt_co);
 
 	DEBUG_TRACE("Updated transaction stats: type: %d, num: %d, this rtt: %.6f, min: %.6f, max: %.6f",
 	            tr_type, my_stats->num, ncc_fr_time_to_float(rtt),
@@ -727,7 +1201,8 @@ static void dpc_tr_stats_update(dpc_transaction_type_t tr_type, fr_time_delta_t
 /*
  *	Update statistics for a dynamically named transaction type.
  */
-static void dpc_dyn_tr_stats_update(dpc_session_ctx_t *session, fr_time_delta_t rtt)
+static void dpc_dyn_tr_stats_update(dpc_session_ctx_t *session, fr_time_delta_t rtt, fr_time_delta_t rtt_wire,
+                                    fr_time_delta_t rtt_co)
 {
 	char name[256];
 
@@ -745,7 +1220,7 @@ static void dpc_dyn_tr_stats_update(dpc_session_ctx_t *session, fr_time_delta_t
 	}
 
 	dpc_transaction_stats_t *my_stats = &stat_ctx.dyn_tr_stats[i];
-	dpc_tr_stats_update_values(my_stats, rtt);
+	dpc_tr_stats_update_values(my_stats, rtt, rtt_wire, rtt_co);
 
 	DEBUG_TRACE("Updated named transaction stats: id: %u, name: [%s], num: %u, this rtt: %.6f, min: %.6f, max: %.6f",
 	            i, name, my_stats->num, ncc_fr_time_to_float(rtt),
@@ -759,16 +1234,26 @@ static void dpc_statistics_update(dpc_session_ctx_t *session, DHCP_PACKET *reque
 {
 	if (!request || !reply) return;
 
-	fr_time_delta_t rtt;
+	fr_time_delta_t rtt, rtt_co = 0;
 
 	/* Get rtt previously computed. */
 	rtt = session->ftd_rtt;
 
+	/*
+	 *	Corrected rtt: the initial request of a session is measured from when the session should have been started,
+	 *	so delays in starting sessions (e.g. because the server stalls) are not hidden. Other requests are not
+	 *	scheduled, their corrected rtt is the same.
+	 */
+	if (with_co_correct) {
+		rtt_co = rtt;
+		if (session->num_send == 1) rtt_co += session->fte_init - session->fte_intended;
+	}
+
 	/* Name the transaction and update its statistics. */
-	dpc_dyn_tr_stats_update(session, rtt);
+	dpc_dyn_tr_stats_update(session, rtt, session->ftd_rtt_wire, rtt_co);
 
 	/* Also update for 'All'. */
-	dpc_tr_stats_update(DPC_TR_ALL, rtt);
+	dpc_tr_stats_update(DPC_TR_ALL, rtt, session->ftd_rtt_wire, rtt_co);
 }
 
 /*
@@ -776,8 +1261,12 @@ static void dpc_statistics_update(dpc_session_ctx_t *session, DHCP_PACKET *reque
  */
 static void dpc_progress_stats(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, UNUSED void *ctx)
 {
-	/* Do statistics summary. */
-	dpc_progress_stats_fprint(stdout, false);
+	/* Do statistics summary. Or, in a worker process, hand over our statistics to the parent which does it. */
+	if (worker_stats) {
+		dpc_worker_stats_publish();
+	} else {
+		dpc_progress_stats_fprint(stdout, false);
+	}
 
 	/* ... and schedule next time. */
 	dpc_event_add_progress_stats();
@@ -813,115 +1302,477 @@ static void dpc_event_add_progress_stats(void)
 }
 
 /*
- *	One request timed-out, but maybe we can retransmit.
+ *	Open the time-series statistics file (if one has been requested), and write the CSV header.
  */
-static bool dpc_retransmit(dpc_session_ctx_t *session)
+static void dpc_ts_init(void)
 {
-	if (session->retransmit >= ECTX.retransmit_max) {
-		/* Give up. */
-		return false;
-	}
-
-	/* Try again. */
-	retr_breakdown[session->retransmit] ++;
-	session->retransmit ++;
+	if (!file_ts_out) return;
 
-	if (dpc_send_one_packet(session, &session->request) < 0) {
-		/* Caller will finish session. */
-		return false;
+	fp_ts = fopen(file_ts_out, "w");
+	if (!fp_ts) {
+		ERROR("Failed to open time-series statistics file \"%s\": %s", file_ts_out, fr_syserror(errno));
+		exit(EXIT_FAILURE);
 	}
 
-	/*
-	 *	Arm request timeout.
-	 */
-	dpc_event_add_request_timeout(session, NULL);
-	return true;
+	ts_prev.fte = fte_job_start;
+	if (ECTX.ts_format == DPC_TS_FORMAT_CSV) dpc_ts_record(fte_job_start, true);
 }
 
 /*
- *	Event callback: request timeout.
+ *	Take a snapshot of the statistics used for time-series.
  */
-static void dpc_request_timeout(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, void *uctx)
+static void dpc_ts_snapshot_take(dpc_ts_snapshot_t *snap, fr_time_t now)
 {
-	dpc_session_ctx_t *session = talloc_get_type_abort(uctx, dpc_session_ctx_t);
+	snap->fte = now;
+	snap->session_num_in = session_num_in;
+	memcpy(snap->dpc_stat, stat_ctx.dpc_stat, sizeof(snap->dpc_stat));
+	snap->rtt_num = stat_ctx.tr_stats[DPC_TR_ALL].num;
+	snap->rtt_histo = stat_ctx.tr_stats[DPC_TR_ALL].rtt_histo;
+}
 
-	if (session->state == DPC_STATE_WAIT_OTHER_REPLIES) {
-		/*
-		 *	We have received at least one reply. We've been waiting for more from other DHCP servers.
-		 *	So do not track this as "packet lost".
-		 */
-		DEBUG_TRACE("Stop waiting for more replies");
-	} else {
-		DEBUG_TRACE("Request timed out (retransmissions so far: %u)", session->retransmit);
+/*
+ *	Get the rate of sessions we're trying to achieve: either the global rate limit, or the combined rate limits of
+ *	input items still in use (if they all have one).
+ *	Returns false if there is no target rate.
+ */
+static bool dpc_ts_target_rate(double *rate)
+{
+	ncc_list_item_t *list_item = vps_list_in.head;
 
-		if (!signal_done && dpc_retransmit(session)) {
-			/* Packet has been successfully retransmitted. */
-			STAT_INCR_PACKET_RETR(session->request);
-			return;
-		}
+	if (dpc_with_rate_limit()) {
+		*rate = dpc_rate_limit_get();
+		return true;
+	}
 
-		if (packet_trace_lvl >= 1) dpc_packet_digest_fprint(fr_log_fp, session, session->request, DPC_PACKET_TIMEOUT);
+	*rate = 0;
+	while (list_item) {
+		dpc_input_t *input = (dpc_input_t *)list_item;
+		list_item = list_item->next;
 
-		/* Statistics. */
-		STAT_INCR_PACKET_LOST(session->request);
+		if (input->done) continue;
+		if (!input->rate_limit && !input->rate_profile) return false;
+		*rate += dpc_item_rate_limit_get(input);
+	}
+	return (*rate > 0);
+}
+
+/*
+ *	Print a time-series statistics value (or its name, if printing the CSV header).
+ */
+static void dpc_ts_value_fprint(FILE *fp, bool header, bool first, char const *name, double value, int decimals,
+                                bool is_set)
+{
+	if (ECTX.ts_format == DPC_TS_FORMAT_JSON) {
+		fprintf(fp, "%s\"%s\": ", first ? "{" : ", ", name);
+		if (is_set) fprintf(fp, "%.*f", decimals, value);
+		else fprintf(fp, "null");
+		return;
 	}
 
-	/* Finish the session. */
-	dpc_session_finish(session);
+	if (!first) fprintf(fp, ",");
+	if (header) fprintf(fp, "%s", name);
+	else if (is_set) fprintf(fp, "%.*f", decimals, value);
 }
 
 /*
- *	Add timer event: request timeout.
- *	Note: even if timeout = 0 we do insert an event (in this case it will be triggered immediately).
- *	If timeout_in is not NULL: use this as timeout. Otherwise, use fixed global timeout.
+ *	Write a time-series statistics record, with values for the interval since the previous record.
+ *	Or the names of the values, if writing the CSV header.
  */
-static void dpc_event_add_request_timeout(dpc_session_ctx_t *session, fr_time_delta_t *timeout_in)
+static void dpc_ts_record(fr_time_t now, bool header)
 {
-	fr_time_t fte_event = fr_time();
-	fte_event += (timeout_in ? *timeout_in : ECTX.ftd_request_timeout);
+	static dpc_histogram_t histo; /* Interval histogram. Static so we don't need it on the stack. */
+	dpc_ts_snapshot_t cur;
+	fr_time_delta_t values[NUM_RTT_PERCENTILES];
+	double interval, target_rate;
+	bool with_target;
+	uint32_t sessions, rtt_num;
+	int i, j;
+
+#define TS_STAT_DIFF(_type, _code) (cur.dpc_stat[_type][_code] - ts_prev.dpc_stat[_type][_code])
+#define TS_VALUE(_name, _value, _decimals, _is_set) \
+	dpc_ts_value_fprint(fp_ts, header, (i++ == 0), _name, _value, _decimals, _is_set)
+
+	if (!fp_ts) return;
+
+	dpc_ts_snapshot_take(&cur, now);
+
+	interval = ncc_fr_time_to_float(now - ts_prev.fte);
+	sessions = cur.session_num_in - ts_prev.session_num_in;
+	rtt_num = cur.rtt_num - ts_prev.rtt_num;
+	with_target = dpc_ts_target_rate(&target_rate);
+
+	dpc_histogram_diff(&histo, &cur.rtt_histo, &ts_prev.rtt_histo);
+	dpc_histogram_percentiles(values, &histo, rtt_num, rtt_percentiles, NUM_RTT_PERCENTILES);
+
+	i = 0;
+	TS_VALUE("time", ncc_fr_time_to_float(now - fte_job_start), 3, true);
+	TS_VALUE("interval", interval, 3, true);
+	TS_VALUE("sessions", sessions, 0, true);
+	TS_VALUE("sent", TS_STAT_DIFF(DPC_STAT_PACKET_SENT, 0), 0, true);
+	TS_VALUE("retransmitted", TS_STAT_DIFF(DPC_STAT_PACKET_RETR, 0), 0, true);
+	TS_VALUE("lost", TS_STAT_DIFF(DPC_STAT_PACKET_LOST, 0), 0, true);
+	TS_VALUE("received", TS_STAT_DIFF(DPC_STAT_PACKET_RECV, 0), 0, true);
+	TS_VALUE("offer", TS_STAT_DIFF(DPC_STAT_PACKET_RECV, FR_DHCP_OFFER), 0, true);
+	TS_VALUE("ack", TS_STAT_DIFF(DPC_STAT_PACKET_RECV, FR_DHCP_ACK), 0, true);
+	TS_VALUE("nak", TS_STAT_DIFF(DPC_STAT_PACKET_RECV, FR_DHCP_NAK), 0, true);
+	TS_VALUE("rate", interval > 0 ? sessions / interval : 0, 3, interval > 0);
+	TS_VALUE("rate_target", target_rate, 3, with_target);
+	TS_VALUE("rtt_num", rtt_num, 0, true);
+	for (j = 0; j < NUM_RTT_PERCENTILES; j++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "rtt_p%g", rtt_percentiles[j]);
+		TS_VALUE(name, 1000 * ncc_fr_time_to_float(values[j]), 3, rtt_num > 0);
+	}
+
+	fprintf(fp_ts, "%s\n", (ECTX.ts_format == DPC_TS_FORMAT_JSON) ? "}" : "");
+	fflush(fp_ts);
+
+	if (!header) ts_prev = cur;
+}
+
+/*
+ *	Event callback: write a time-series statistics record.
+ */
+static void dpc_ts_stats(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, UNUSED void *ctx)
+{
+	dpc_ts_record(fr_time(), false);
+
+	/* ... and schedule next time. */
+	dpc_event_add_ts_stats();
+}
 
-	/* If there is an active event timer for this session, clear it before arming a new one. */
-	if (session->event) {
-		fr_event_timer_delete(event_list, &session->event);
-		session->event = NULL;
+/*
+ *	Add timer event: time-series statistics.
+ */
+static void dpc_event_add_ts_stats(void)
+{
+	if (!fp_ts || !ECTX.ftd_ts_interval) return;
+
+	/* Schedule relatively to the expected trigger of previous event, so records are evenly spaced out. */
+	fr_time_t now = fr_time();
+
+	if (!fte_ts_stat) {
+		fte_ts_stat = fte_job_start;
 	}
 
-	if (fr_event_timer_at(session, event_list, &session->event,
-	                      fte_event, dpc_request_timeout, session) < 0) {
+	do {
+		fte_ts_stat += ECTX.ftd_ts_interval;
+	} while (fte_ts_stat < now);
+
+	if (fr_event_timer_at(global_ctx, event_list, &ev_ts_stats,
+	                      fte_ts_stat, dpc_ts_stats, NULL) < 0) {
 		/* Should never happen. */
-		PERROR("Failed inserting request timeout event");
+		PERROR("Failed inserting time-series statistics event");
 	}
 }
 
 /*
- *	Send one packet.
- *	Grab a socket, insert packet in the packet list (and obtain an id), encode DHCP packet, and send it.
- *	Returns: 0 = success, -1 = error.
+ *	Start the saturation search (if requested).
+ *	The initial rate is set when parsing options. Each step starts with a warm-up, so the server (and our own
+ *	queues) can settle with the new rate before we measure anything.
  */
-static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_p)
-// note: we need a 'DHCP_PACKET **' for dpc_packet_list_id_alloc.
+static void dpc_search_init(void)
 {
-	DHCP_PACKET *packet = *packet_p;
-	int my_sockfd;
-	int ret;
+	if (!ECTX.search_rate || !start_sessions_flag) return;
 
-	DEBUG_TRACE("Preparing to send one packet");
+	search_rate = ECTX.search_rate;
+	search_measuring = false;
+	fte_search = fr_time() + ncc_float_to_fr_time(ECTX.search_step * DPC_SEARCH_WARMUP);
+	dpc_event_add_search();
+
+	INFO("Saturation search: starting at %.3f sessions/s, held %.1f s per step", search_rate, ECTX.search_step);
+}
+
+/*
+ *	Measure the step which has just been completed, and check it against the SLA.
+ */
+static void dpc_search_step_eval(fr_time_t now)
+{
+	static dpc_histogram_t histo; /* Step histogram. Static so we don't need it on the stack. */
+	dpc_ts_snapshot_t cur;
+	dpc_search_step_t *step;
+	double percentiles[2] = { 50, ECTX.sla_rtt_percentile };
+	fr_time_delta_t values[2];
+	double interval;
+	uint32_t lost;
+
+	dpc_ts_snapshot_take(&cur, now);
+
+	TALLOC_REALLOC_ZERO(global_ctx, search_steps, dpc_search_step_t, search_num_steps, search_num_steps + 1);
+	step = &search_steps[search_num_steps++];
+
+	interval = ncc_fr_time_to_float(now - search_snap.fte);
+
+	step->rate = search_rate;
+	step->rate_achieved = (interval > 0) ? (cur.session_num_in - search_snap.session_num_in) / interval : 0;
+	step->sent = cur.dpc_stat[DPC_STAT_PACKET_SENT][0] - search_snap.dpc_stat[DPC_STAT_PACKET_SENT][0];
+	lost = cur.dpc_stat[DPC_STAT_PACKET_LOST][0] - search_snap.dpc_stat[DPC_STAT_PACKET_LOST][0];
+	step->loss = step->sent ? 100.0 * lost / step->sent : 0;
+
+	step->rtt_num = cur.rtt_num - search_snap.rtt_num;
+	dpc_histogram_diff(&histo, &cur.rtt_histo, &search_snap.rtt_histo);
+	dpc_histogram_percentiles(values, &histo, step->rtt_num, percentiles, 2);
+	step->rtt_median = values[0];
+	step->rtt_sla = values[1];
 
 	/*
-	 *	Get a socket to send this over.
+	 *	A rate is sustained if we could actually start sessions at that rate (i.e. we're not held back by the
+	 *	max number of sessions in parallel), and the server replied within the SLA.
 	 */
-#ifdef HAVE_LIBPCAP
-	if (session->input->ext.with_pcap) {
-		my_sockfd = pcap->fd;
-	} else
-#endif
-	{
-		my_sockfd = dpc_socket_provide(pl, &packet->src_ipaddr, packet->src_port);
-	}
-	if (my_sockfd < 0) {
-		SPERROR("Failed to provide a suitable socket");
-		return -1;
-	}
+	step->pass = (step->rate_achieved >= step->rate * DPC_SEARCH_ACHIEVED_MIN)
+		&& (step->loss <= ECTX.sla_loss)
+		&& (!ECTX.sla_rtt || (step->rtt_num > 0 && ncc_fr_time_to_float(step->rtt_sla) <= ECTX.sla_rtt));
+
+	INFO("Saturation search: rate %.3f/s (achieved: %.3f/s), loss: %.2f%%, RTT p%g: %.3f ms => %s",
+	     step->rate, step->rate_achieved, step->loss, ECTX.sla_rtt_percentile,
+	     1000 * ncc_fr_time_to_float(step->rtt_sla), step->pass ? "pass" : "fail");
+}
+
+/*
+ *	Figure out the rate of the next step: double the rate until the SLA is not met anymore (or halve it, if even
+ *	the initial rate does not meet the SLA), then bisect between the highest rate which passed and the lowest which
+ *	failed.
+ *	Returns false if the search is over.
+ */
+static bool dpc_search_next(void)
+{
+	dpc_search_step_t *step = &search_steps[search_num_steps - 1];
+
+	if (step->pass) {
+		if (step->rate > search_low) search_low = step->rate;
+	} else {
+		if (!search_high || step->rate < search_high) search_high = step->rate;
+	}
+
+	if (search_num_steps >= DPC_SEARCH_STEPS_MAX) return false;
+
+	if (!search_high) {
+		search_rate = search_low * 2;
+
+	} else if (!search_low) {
+		search_rate = search_high / 2;
+		if (search_rate < 1) return false; /* Don't bother. */
+
+	} else {
+		if (search_high - search_low <= search_low * DPC_SEARCH_PRECISION) return false;
+		search_rate = (search_low + search_high) / 2;
+	}
+	return true;
+}
+
+/*
+ *	Event callback: saturation search, end of warm-up or end of step.
+ */
+static void dpc_search_event(UNUSED fr_event_list_t *el, UNUSED fr_time_t now, UNUSED void *ctx)
+{
+	fr_time_t fte_now = fr_time();
+
+	/* If we're not starting sessions anymore (e.g. max duration reached), the search is cut short. */
+	if (!start_sessions_flag) return;
+
+	if (!search_measuring) {
+		/* Warm-up is over, now measure. */
+		dpc_ts_snapshot_take(&search_snap, fte_now);
+		search_measuring = true;
+		fte_search = fte_now + ncc_float_to_fr_time(ECTX.search_step * (1 - DPC_SEARCH_WARMUP));
+
+	} else {
+		dpc_search_step_eval(fte_now);
+
+		if (!dpc_search_next()) {
+			INFO("Saturation search done: will not start any new session.");
+			dpc_end_start_sessions();
+			return;
+		}
+
+		/*
+		 *	Restart the rate schedule with the new rate. Sessions which were due but could not be started are
+		 *	forgotten: we don't want to catch up with them at the next step.
+		 */
+		dpc_rate_profile_restart(rate_profile, dpc_start_sessions_elapsed_time_get(), search_rate, session_num);
+		fte_pacing_next = 0;
+
+		search_measuring = false;
+		fte_search = fte_now + ncc_float_to_fr_time(ECTX.search_step * DPC_SEARCH_WARMUP);
+	}
+
+	dpc_event_add_search();
+}
+
+/*
+ *	Add timer event: saturation search.
+ */
+static void dpc_event_add_search(void)
+{
+	if (fr_event_timer_at(global_ctx, event_list, &ev_search, fte_search, dpc_search_event, NULL) < 0) {
+		/* Should never happen. */
+		PERROR("Failed inserting saturation search event");
+	}
+}
+
+/*
+ *	Print the outcome of the saturation search: the curve of rate vs. latency and loss, and the knee point (i.e.
+ *	the highest rate sustained within the SLA).
+ */
+static void dpc_search_fprint(FILE *fp)
+{
+	uint32_t i;
+
+	fprintf(fp, "*** Saturation search (SLA: loss <= %.2f%%", ECTX.sla_loss);
+	if (ECTX.sla_rtt) fprintf(fp, ", RTT p%g <= %.3f ms", ECTX.sla_rtt_percentile, 1000 * ECTX.sla_rtt);
+	fprintf(fp, "):\n");
+
+	fprintf(fp, "\t%12s %12s %10s %8s %12s %12s %s\n", "Rate (/s)", "Achieved", "Sent", "Loss (%)",
+	        "RTT p50 (ms)", "RTT SLA (ms)", "Verdict");
+	for (i = 0; i < search_num_steps; i++) {
+		dpc_search_step_t *step = &search_steps[i];
+
+		fprintf(fp, "\t%12.3f %12.3f %10u %8.2f %12.3f %12.3f %s\n", step->rate, step->rate_achieved, step->sent,
+		        step->loss, 1000 * ncc_fr_time_to_float(step->rtt_median), 1000 * ncc_fr_time_to_float(step->rtt_sla),
+		        step->pass ? "pass" : "fail");
+	}
+
+	if (search_low) {
+		fprintf(fp, "\t%-*.*s: %.3f", LG_PAD_STATS, LG_PAD_STATS, "Max rate in SLA (/s)", search_low);
+		if (search_high) fprintf(fp, " (fails at: %.3f)", search_high);
+		else fprintf(fp, " (search cut short before saturation)");
+		fprintf(fp, "\n");
+	} else {
+		fprintf(fp, "\t%-*.*s: none (no rate tested is within SLA)\n", LG_PAD_STATS, LG_PAD_STATS, "Max rate in SLA (/s)");
+	}
+}
+
+/*
+ *	One request timed-out, but maybe we can retransmit.
+ */
+static bool dpc_retransmit(dpc_session_ctx_t *session)
+{
+	if (session->retransmit >= ECTX.retransmit_max) {
+		/* Give up. */
+		return false;
+	}
+
+	/* Try again. */
+	retr_breakdown[session->retransmit] ++;
+	session->retransmit ++;
+
+	if (dpc_send_one_packet(session, &session->request, false) < 0) {
+		/* Caller will finish session. */
+		return false;
+	}
+
+	/*
+	 *	Arm request timeout.
+	 */
+	dpc_request_timeout_arm(session);
+	return true;
+}
+
+/*
+ *	A request has timed out.
+ */
+static void dpc_request_timeout(dpc_session_ctx_t *session)
+{
+	if (session->state == DPC_STATE_WAIT_OTHER_REPLIES) {
+		/*
+		 *	We have received at least one reply. We've been waiting for more from other DHCP servers.
+		 *	So do not track this as "packet lost".
+		 */
+		DEBUG_TRACE("Stop waiting for more replies");
+	} else {
+		DEBUG_TRACE("Request timed out (retransmissions so far: %u)", session->retransmit);
+
+		if (!signal_done && dpc_retransmit(session)) {
+			/* Packet has been successfully retransmitted. */
+			STAT_INCR_PACKET_RETR(session->request);
+			return;
+		}
+
+		if (packet_trace_lvl >= 1) dpc_packet_digest_fprint(fr_log_fp, session, session->request, DPC_PACKET_TIMEOUT);
+
+		/* Statistics. */
+		STAT_INCR_PACKET_LOST(session->request);
+	}
+
+	/* Finish the session. */
+	dpc_session_finish(session);
+}
+
+/*
+ *	Arm request timeout.
+ *	Note: even if timeout = 0 we do arm it (in this case it will be triggered immediately).
+ *
+ *	All requests share the same timeout, so deadlines are monotonic: the list of sessions with an armed timeout is
+ *	a FIFO, ordered by deadline. Arming, cancelling and expiring are all O(1).
+ */
+static void dpc_request_timeout_arm(dpc_session_ctx_t *session)
+{
+	/* If the timeout is already armed for this session, clear it before arming it again. */
+	NCC_LIST_DRAW(session);
+
+	session->fte_timeout = fr_time() + ECTX.ftd_request_timeout;
+	NCC_LIST_ENQUEUE(&timeout_list, session);
+}
+
+/*
+ *	Get the deadline of the next request timeout.
+ *	Returns false if there is none.
+ */
+static bool dpc_request_timeout_next(fr_time_t *when)
+{
+	dpc_session_ctx_t *session = (dpc_session_ctx_t *)timeout_list.head;
+
+	if (!session) return false;
+
+	*when = session->fte_timeout;
+	return true;
+}
+
+/*
+ *	Trigger all the request timeouts which have expired.
+ */
+static void dpc_request_timeout_run(fr_time_t now)
+{
+	dpc_session_ctx_t *session;
+
+	while ((session = (dpc_session_ctx_t *)timeout_list.head) && session->fte_timeout <= now) {
+		NCC_LIST_DRAW(session);
+		dpc_request_timeout(session); /* This may arm the timeout again (retransmission). */
+	}
+}
+
+/*
+ *	Send one packet.
+ *	Grab a socket, insert packet in the packet list (and obtain an id), encode DHCP packet, and send it.
+ *	If defer is true, and batched transmission is enabled, the packet is only queued (it will be sent later
+ *	along with other packets). This is possible only if the session will not be terminated before then.
+ *	Returns: 0 = success, -1 = error.
+ */
+static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_p, bool defer)
+// note: we need a 'DHCP_PACKET **' for dpc_packet_list_id_alloc.
+{
+	DHCP_PACKET *packet = *packet_p;
+	int my_sockfd;
+	int ret;
+
+	DEBUG_TRACE("Preparing to send one packet");
+
+	/*
+	 *	Get a socket to send this over.
+	 */
+#ifdef HAVE_LIBPCAP
+	if (session->input->ext.with_pcap) {
+		my_sockfd = pcap->fd;
+	} else
+#endif
+	{
+		my_sockfd = dpc_socket_provide(pl, &packet->src_ipaddr, packet->src_port);
+	}
+	if (my_sockfd < 0) {
+		SPERROR("Failed to provide a suitable socket");
+		return -1;
+	}
 
 	if (packet->id == DPC_PACKET_ID_UNASSIGNED) {
 		/* Need to assign an xid to this packet. */
@@ -941,7 +1792,8 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
 		/*
 		 *	Allocate an id, and prepare the packet (socket fd, src addr)
 		 */
-		rcode = dpc_packet_list_id_alloc(pl, my_sockfd, packet_p);
+		rcode = dpc_packet_list_id_alloc(pl, my_sockfd, packet_p, session->xid_reuse);
+		session->xid_reuse = false;
 		if (!rcode) {
 			SERROR("Failed to allocate packet xid");
 			return -1;
@@ -949,7 +1801,6 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
 	}
 
 	dpc_assert(packet->id != DPC_PACKET_ID_UNASSIGNED);
-	dpc_assert(packet->data == NULL);
 
 	/*
 	 *	Encode the packet.
@@ -960,6 +1811,38 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
 		exit(EXIT_FAILURE);
 	}
 
+	/*
+	 *	In template mode, compile a template from the first session initial request built from this input,
+	 *	so that we don't have to build and encode the next ones from scratch.
+	 */
+	if (with_template && !session->input->templ_done && session->num_send == 1 && session->retransmit == 0) {
+		session->input->templ = dpc_templ_compile(session->input, session->input, packet, (session->gateway != NULL));
+		session->input->templ_done = true;
+	}
+
+	packet->sockfd = my_sockfd;
+
+	/*
+	 *	Queue the packet if we can, it will be sent along with others.
+	 *	The send timestamp will be set when it actually goes out.
+	 */
+	if (defer && ECTX.send_batch && session->reply_expected && ECTX.request_timeout
+#ifdef HAVE_LIBPCAP
+	    && !session->input->ext.with_pcap
+#endif
+	    ) {
+		ret = dpc_packet_list_send_enqueue(pl, packet_p);
+		if (ret < 0) {
+			SPERROR("Failed to queue packet");
+			return -1;
+		}
+		if (ret == 0) return 0; /* Queued. */
+
+		/* Sent right away (batched transmission is not supported on this system). */
+		dpc_packet_sent(session, packet);
+		return 0;
+	}
+
 	/*
 	 *	Send the packet.
 	 */
@@ -969,8 +1852,6 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
 	// on receive, reply timestamp is set by fr_dhcpv4_udp_packet_recv
 	// - actual value is set in recvfromto right before returning
 
-	packet->sockfd = my_sockfd;
-
 #ifdef HAVE_LIBPCAP
 	if (session->input->ext.with_pcap) {
 		/* Send using pcap raw socket. */
@@ -989,18 +1870,65 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
 		ret = fr_dhcpv4_udp_packet_send(packet);
 	}
 	if (ret < 0) {
+		dpc_send_error_count(errno);
 		SPERROR("Failed to send packet");
 		return -1;
 	}
 
+	dpc_packet_sent(session, packet);
+
+	return 0;
+}
+
+/*
+ *	A packet has been sent: trace it, and update statistics.
+ */
+static void dpc_packet_sent(dpc_session_ctx_t *session, DHCP_PACKET *packet)
+{
+	/* Keep track of this send, so we can later retrieve its transmit timestamp. */
+	if (ECTX.timestamping) {
+		session->with_tx_key = dpc_packet_list_tx_key(pl, packet->sockfd, &session->tx_key);
+	}
+
 	dpc_packet_fprint(fr_log_fp, session, packet, DPC_PACKET_SENT, packet_trace_lvl); /* Print request packet. */
 
 	/* Statistics. */
 	if (session->retransmit == 0) {
 		STAT_INCR_PACKET_SENT(packet);
 	}
+}
 
-	return 0;
+/*
+ *	A queued packet has been sent (or has failed to be).
+ *	Invoked from the packet list when flushing the send queues.
+ */
+static void dpc_packet_sent_deferred(DHCP_PACKET **packet_p, bool sent)
+{
+	dpc_session_ctx_t *session = fr_packet2myptr(dpc_session_ctx_t, request, packet_p);
+	DHCP_PACKET *packet = *packet_p;
+
+	if (!sent) {
+		dpc_send_error_count(errno);
+		SPERROR("Failed to send packet");
+		dpc_session_finish(session);
+		return;
+	}
+
+	/*
+	 *	The request was initialized before being queued.
+	 *	Measure response time from when it actually went out, so queuing is not accounted for.
+	 */
+	if (session->retransmit == 0) session->fte_init = packet->timestamp;
+
+	dpc_packet_sent(session, packet);
+}
+
+/*
+ *	Keep track of packets which could not be sent because the socket send buffer was full.
+ */
+static void dpc_send_error_count(int err)
+{
+	if (err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS) stat_ctx.loop.num_send_full ++;
 }
 
 /*
@@ -1011,40 +1939,45 @@ static int dpc_send_one_packet(dpc_session_ctx_t *session, DHCP_PACKET **packet_
  */
 static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time)
 {
-	fd_set set;
-	struct timeval tvi_wait = { 0 };
 	DHCP_PACKET *packet = NULL, **packet_p;
 	VALUE_PAIR *vp;
+	dpc_reply_info_t reply_info;
 	dpc_session_ctx_t *session;
-	int max_fd;
+	int num_ready;
 	char from_to_buf[DPC_FROM_TO_STRLEN] = "";
 
-	/* Wait for packet, timing out as necessary */
-	FD_ZERO(&set);
+	/*
+	 *	Wait for sockets to be ready, timing out as necessary.
+	 *	If some sockets have not been drained yet, this returns immediately (without a system call).
+	 */
+	if (loop_sampled && *ftd_wait_time > 0) {
+		fr_time_t fte_wait = fr_time();
 
-	max_fd = dpc_packet_list_fd_set(pl, &set);
-	if (max_fd < 0) {
-		/* no sockets to listen on! */
-		return 0;
+		num_ready = dpc_packet_list_wait(pl, ftd_wait_time);
+		ftd_loop_idle += fr_time() - fte_wait;
+	} else {
+		num_ready = dpc_packet_list_wait(pl, ftd_wait_time);
 	}
-
-	if (ftd_wait_time) {
-		tvi_wait = fr_time_delta_to_timeval(*ftd_wait_time);
-		DEBUG_TRACE("Max wait time: %.6f", ncc_timeval_to_float(&tvi_wait));
+	if (num_ready < 0) {
+		PERROR("Failed waiting for packets");
+		return -1;
 	}
 
 	/*
 	 *	No packet was received.
 	 */
-	if (select(max_fd, &set, NULL, NULL, &tvi_wait) <= 0) {
+	if (num_ready == 0) {
 		return 0;
 	}
 
 	/*
 	 *	Fetch one incoming packet.
 	 */
-	packet = dpc_packet_list_recv(pl, &set); // warning: packet is allocated on NULL context.
+	packet = dpc_packet_list_recv(pl, &stat_ctx.num_packet_recv_unexpected); // warning: packet is allocated on NULL context.
 	if (!packet) {
+		/* All ready sockets have been drained: nothing more to receive for now. */
+		if (dpc_packet_list_num_ready(pl) == 0) return 0;
+
 		PERROR("Received bad packet");
 		return -1;
 	}
@@ -1106,10 +2039,10 @@ static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time)
 	}
 
 	/*
-	 *	Decode the reply packet.
+	 *	Extract what we need to handle the reply straight from the packet data.
 	 */
-	if (fr_dhcpv4_packet_decode(packet) < 0) {
-		SPERROR("Failed to decode reply packet (id: %u)", packet->id);
+	if (dpc_reply_info_extract(&reply_info, packet) < 0) {
+		SPERROR("Failed to parse reply packet (id: %u)", packet->id);
 		fr_radius_packet_free(&packet);
 		/*
 		 *	Don't give hope and kill the session now. Maybe we'll receive something better.
@@ -1117,6 +2050,16 @@ static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time)
 		 */
 		return -1;
 	}
+	packet->code = reply_info.code;
+
+	/*
+	 *	Fully decode the reply packet only if we need the value pairs (i.e. to print them).
+	 */
+	if (packet_trace_lvl >= 2 && fr_dhcpv4_packet_decode(packet) < 0) {
+		SPERROR("Failed to decode reply packet (id: %u)", packet->id);
+		fr_radius_packet_free(&packet);
+		return -1;
+	}
 
 	/* Statistics. */
 	STAT_INCR_PACKET_RECV(packet);
@@ -1124,7 +2067,7 @@ static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time)
 	/*
 	 *	Handle the reply, and decide if the session is finished or not yet.
 	 */
-	if (!dpc_session_handle_reply(session, packet)) {
+	if (!dpc_session_handle_reply(session, packet, &reply_info)) {
 		dpc_session_finish(session);
 	}
 
@@ -1135,7 +2078,7 @@ static int dpc_recv_one_packet(fr_time_delta_t *ftd_wait_time)
  *	Handle a reply which belongs to a given ongoing session.
  *	Returns true if we're not done with the session (so it should not be terminated yet), false otherwise.
  */
-static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *reply)
+static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *reply, dpc_reply_info_t *reply_info)
 {
 	if (!session || !reply) return false;
 
@@ -1155,7 +2098,8 @@ static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *re
 	}
 
 	session->reply = reply;
-	talloc_steal(session, reply); /* Reparent reply packet (allocated on NULL context) so we don't leak. */
+	session->reply_info = *reply_info;
+	talloc_steal(session, reply); /* Reparent reply packet (unless already allocated from the session pool) so we don't leak. */
 
 	/* Compute rtt.
 	 * Relative to initial request so we get the real rtt (regardless of retransmissions).
@@ -1163,11 +2107,35 @@ static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *re
 	session->ftd_rtt = session->reply->timestamp - session->fte_init;
 	DEBUG_TRACE("Packet response time: %.6f", ncc_fr_time_to_float(session->ftd_rtt));
 
+	/* Also get the wire rtt (from kernel or NIC timestamps) if we can. */
+	session->ftd_rtt_wire = 0;
+	if (session->with_tx_key) {
+		dpc_packet_list_wire_rtt(pl, session->request->sockfd, session->tx_key, &session->ftd_rtt_wire);
+	}
+
 	dpc_packet_fprint(fr_log_fp, session, reply, DPC_PACKET_RECEIVED, packet_trace_lvl); /* print reply packet. */
 
 	/* Update statistics. */
 	dpc_statistics_update(session, session->request, session->reply);
 
+	/*
+	 *	A simulated client has been granted a lease (or an extension of its lease), or has been refused one.
+	 *	The reply must be for this client (found from the reply chaddr), otherwise it is not taken into account.
+	 */
+	if (population && session->client != DPC_CLIENT_NONE) {
+		uint32_t client = dpc_lease_store_lookup(dpc_population_store(population), reply_info->chaddr);
+
+		if (client != session->client) {
+			SDEBUG2("Reply chaddr does not match client (slot: %u, expected: %u), ignoring it",
+			        client, session->client);
+
+		} else if (session->reply->code == FR_DHCP_ACK) {
+			dpc_population_client_ack(population, session->client, reply_info);
+		} else if (session->reply->code == FR_DHCP_NAK) {
+			dpc_population_client_nak(population, session->client);
+		}
+	}
+
 	/*
 	 *	If dealing with a DORA transaction, after a valid Offer we need to send a Request.
 	 */
@@ -1182,9 +2150,10 @@ static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *re
 		/*
 		 *	Update statistics for DORA workflows.
 		 */
-		fr_time_delta_t rtt;
+		fr_time_delta_t rtt, rtt_co = 0;
 		rtt = session->reply->timestamp - session->fte_start;
-		dpc_tr_stats_update(DPC_TR_DORA, rtt);
+		if (with_co_correct) rtt_co = session->reply->timestamp - session->fte_intended;
+		dpc_tr_stats_update(DPC_TR_DORA, rtt, 0, rtt_co); /* No wire rtt for a workflow. */
 
 		/*
 		 *	Maybe send a Decline or Release now.
@@ -1212,6 +2181,21 @@ static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *re
 	return false; /* Session is done. */
 }
 
+/*
+ *	Add an IPv4 address value pair to a packet.
+ */
+static VALUE_PAIR *dpc_pair_ipv4addr_add(DHCP_PACKET *packet, fr_dict_attr_t const *da, uint32_t ipv4addr)
+{
+	VALUE_PAIR *vp;
+
+	vp = ncc_pair_create_by_da(packet, &packet->vps, da);
+	vp->vp_ipv4addr = ipv4addr;
+	vp->vp_ip.af = AF_INET;
+	vp->vp_ip.prefix = 32;
+
+	return vp;
+}
+
 /*
  *	Handling of a DORA workflow. After receiving an Offer, try and build a Request.
  *	Encode and send the packet, then wait for the reply.
@@ -1219,25 +2203,17 @@ static bool dpc_session_handle_reply(dpc_session_ctx_t *session, DHCP_PACKET *re
  */
 static bool dpc_session_dora_request(dpc_session_ctx_t *session)
 {
-	VALUE_PAIR *vp_xid, *vp_yiaddr, *vp_server_id, *vp_requested_ip;
+	dpc_reply_info_t *reply_info = &session->reply_info;
 	DHCP_PACKET *packet;
 
-	/* Get the Offer xid. */
-	vp_xid = fr_pair_find_by_da(session->reply->vps, attr_dhcp_transaction_id, TAG_ANY);
-	if (!vp_xid) { /* Should never happen (DHCP field). */
-		return false;
-	}
-
 	/* Offer must provide yiaddr (DHCP-Your-IP-Address). */
-	vp_yiaddr = fr_pair_find_by_da(session->reply->vps, attr_dhcp_your_ip_address, TAG_ANY);
-	if (!vp_yiaddr || vp_yiaddr->vp_ipv4addr == 0) {
+	if (reply_info->yiaddr == 0) {
 		DEBUG2("Session DORA: no yiaddr provided in Offer reply");
 		return false;
 	}
 
 	/* Offer must contain option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	vp_server_id = fr_pair_find_by_da(session->reply->vps, attr_dhcp_server_identifier, TAG_ANY);
-	if (!vp_server_id || vp_server_id->vp_ipv4addr == 0) {
+	if (reply_info->server_id == 0) {
 		DEBUG2("Session DORA: no option 54 (server id) provided in Offer reply");
 		return false;
 	}
@@ -1262,14 +2238,14 @@ static bool dpc_session_dora_request(dpc_session_ctx_t *session)
 	 *	First remove previous option 50 if one was provided (server may have offered a different lease).
 	 */
 	fr_pair_delete_by_da(&packet->vps, attr_dhcp_requested_ip_address);
-	vp_requested_ip = ncc_pair_create_by_da(packet, &packet->vps, attr_dhcp_requested_ip_address);
-	ncc_pair_copy_value(vp_requested_ip, vp_yiaddr);
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_requested_ip_address, reply_info->yiaddr);
 
 	/* Add option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	fr_pair_add(&packet->vps, fr_pair_copy(packet, vp_server_id));
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_server_identifier, reply_info->server_id);
 
 	/* Reset input xid to value obtained from the Offer reply. */
-	session->input->ext.xid = vp_xid->vp_uint32;
+	session->input->ext.xid = reply_info->xid;
+	session->xid_reuse = true;
 
 	/*
 	 *	New packet is ready. Free old packet and its reply. Then use the new packet.
@@ -1295,14 +2271,14 @@ static bool dpc_session_dora_request(dpc_session_ctx_t *session)
 	/*
 	 *	Encode and send packet.
 	 */
-	if (dpc_send_one_packet(session, &session->request) < 0) {
+	if (dpc_send_one_packet(session, &session->request, false) < 0) {
 		return false;
 	}
 
 	/*
 	 *	Arm request timeout.
 	 */
-	dpc_event_add_request_timeout(session, NULL);
+	dpc_request_timeout_arm(session);
 
 	return true; /* Session is not finished. */
 }
@@ -1313,19 +2289,17 @@ static bool dpc_session_dora_request(dpc_session_ctx_t *session)
  */
 static bool dpc_session_dora_release(dpc_session_ctx_t *session)
 {
-	VALUE_PAIR *vp_yiaddr, *vp_server_id, *vp_ciaddr;
+	dpc_reply_info_t *reply_info = &session->reply_info;
 	DHCP_PACKET *packet;
 
 	/* Ack provides IP address assigned to client in field yiaddr (DHCP-Your-IP-Address). */
-	vp_yiaddr = fr_pair_find_by_da(session->reply->vps, attr_dhcp_your_ip_address, TAG_ANY);
-	if (!vp_yiaddr || vp_yiaddr->vp_ipv4addr == 0) {
+	if (reply_info->yiaddr == 0) {
 		DEBUG2("Session DORA-Release: no yiaddr provided in Ack reply");
 		return false;
 	}
 
 	/* Ack must contain option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	vp_server_id = fr_pair_find_by_da(session->reply->vps, attr_dhcp_server_identifier, TAG_ANY);
-	if (!vp_server_id || vp_server_id->vp_ipv4addr == 0) {
+	if (reply_info->server_id == 0) {
 		DEBUG2("Session DORA-Release: no option 54 (server id) provided in Ack reply");
 		return false;
 	}
@@ -1346,8 +2320,7 @@ static bool dpc_session_dora_release(dpc_session_ctx_t *session)
 	 */
 
 	/* Add field ciaddr (DHCP-Client-IP-Address) = yiaddr */
-	vp_ciaddr = ncc_pair_create_by_da(packet, &packet->vps, attr_dhcp_client_ip_address);
-	ncc_pair_copy_value(vp_ciaddr, vp_yiaddr);
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_client_ip_address, reply_info->yiaddr);
 
 	/*
 	 *	Remove eventual option 50 Requested IP Address.
@@ -1356,7 +2329,7 @@ static bool dpc_session_dora_release(dpc_session_ctx_t *session)
 	fr_pair_delete_by_da(&packet->vps, attr_dhcp_requested_ip_address);
 
 	/* Add option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	fr_pair_add(&packet->vps, fr_pair_copy(packet, vp_server_id));
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_server_identifier, reply_info->server_id);
 
 	/* xid is supposed to be selected by client. Let the program pick a new one. */
 	session->input->ext.xid = DPC_PACKET_ID_UNASSIGNED;
@@ -1385,7 +2358,7 @@ static bool dpc_session_dora_release(dpc_session_ctx_t *session)
 	/*
 	 *	Encode and send packet.
 	 */
-	if (dpc_send_one_packet(session, &session->request) < 0) {
+	if (dpc_send_one_packet(session, &session->request, false) < 0) {
 		return false;
 	}
 	// Note: if the DORA was broadcast, we're also broadcasting the Release. It works. But...
@@ -1401,19 +2374,17 @@ static bool dpc_session_dora_release(dpc_session_ctx_t *session)
  */
 static bool dpc_session_dora_decline(dpc_session_ctx_t *session)
 {
-	VALUE_PAIR *vp_yiaddr, *vp_server_id, *vp_ciaddr, *vp_requested_ip;
+	dpc_reply_info_t *reply_info = &session->reply_info;
 	DHCP_PACKET *packet;
 
 	/* Ack provides IP address assigned to client in field yiaddr (DHCP-Your-IP-Address). */
-	vp_yiaddr = fr_pair_find_by_da(session->reply->vps, attr_dhcp_your_ip_address, TAG_ANY);
-	if (!vp_yiaddr || vp_yiaddr->vp_ipv4addr == 0) {
+	if (reply_info->yiaddr == 0) {
 		DEBUG2("Session DORA-Decline: no yiaddr provided in Ack reply");
 		return false;
 	}
 
 	/* Ack must contain option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	vp_server_id = fr_pair_find_by_da(session->reply->vps, attr_dhcp_server_identifier, TAG_ANY);
-	if (!vp_server_id || vp_server_id->vp_ipv4addr == 0) {
+	if (reply_info->server_id == 0) {
 		DEBUG2("Session DORA-Decline: no option 54 (server id) provided in Ack reply");
 		return false;
 	}
@@ -1434,19 +2405,17 @@ static bool dpc_session_dora_decline(dpc_session_ctx_t *session)
 	 */
 
 	/* Add field ciaddr (DHCP-Client-IP-Address) = yiaddr */
-	vp_ciaddr = ncc_pair_create_by_da(packet, &packet->vps, attr_dhcp_client_ip_address);
-	ncc_pair_copy_value(vp_ciaddr, vp_yiaddr);
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_client_ip_address, reply_info->yiaddr);
 
 	/*
 	 *	Add option 50 Requested IP Address (DHCP-Requested-IP-Address) = yiaddr
 	 *	First remove previous option 50 if one was provided (server may have offered a different lease).
 	 */
 	fr_pair_delete_by_da(&packet->vps, attr_dhcp_requested_ip_address);
-	vp_requested_ip = ncc_pair_create_by_da(packet, &packet->vps, attr_dhcp_requested_ip_address);
-	ncc_pair_copy_value(vp_requested_ip, vp_yiaddr);
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_requested_ip_address, reply_info->yiaddr);
 
 	/* Add option 54 Server Identifier (DHCP-DHCP-Server-Identifier). */
-	fr_pair_add(&packet->vps, fr_pair_copy(packet, vp_server_id));
+	dpc_pair_ipv4addr_add(packet, attr_dhcp_server_identifier, reply_info->server_id);
 
 	/* xid is supposed to be selected by client. Let the program pick a new one. */
 	session->input->ext.xid = DPC_PACKET_ID_UNASSIGNED;
@@ -1468,7 +2437,7 @@ static bool dpc_session_dora_decline(dpc_session_ctx_t *session)
 	/*
 	 *	Encode and send packet.
 	 */
-	if (dpc_send_one_packet(session, &session->request) < 0) {
+	if (dpc_send_one_packet(session, &session->request, false) < 0) {
 		return false;
 	}
 
@@ -1524,10 +2493,28 @@ static DHCP_PACKET *dpc_request_init(TALLOC_CTX *ctx, dpc_session_ctx_t *session
 
 	session->retransmit = 0;
 	session->ftd_rtt = 0;
+	session->ftd_rtt_wire = 0;
+	session->with_tx_key = false;
 
 	/* Store request initial time. */
 	session->fte_init = fr_time();
 
+	/*
+	 *	If we have a compiled template for this input, use it to build the session initial request.
+	 *	Packet value pairs are not needed then (unless we have to print them).
+	 */
+	if (input->templ && session->num_send == 0 && packet_trace_lvl < 2) {
+		int ret = dpc_templ_instantiate(request, input->templ, input, session->gateway);
+		if (ret < 0) {
+			talloc_free(request);
+			return NULL;
+		}
+		if (ret == 1) goto done;
+
+		/* Otherwise value pairs have been built (and expanded), which we'll encode. */
+		goto gateway;
+	}
+
 	/* Fill in the packet value pairs. */
 	ncc_pair_list_append(request, &request->vps, input->vps);
 
@@ -1535,7 +2522,7 @@ static DHCP_PACKET *dpc_request_init(TALLOC_CTX *ctx, dpc_session_ctx_t *session
 		/*
 		 *	Perform xlat expansions as required.
 		 */
-		ncc_xlat_set_num(input->id); /* Initialize xlat context for processing this input. */
+		ncc_xlat_set_num(input->xlat_set); /* Initialize xlat context for processing this input. */
 
 		if (dpc_pair_list_xlat(request, request->vps) < 0) {
 			talloc_free(request);
@@ -1543,9 +2530,20 @@ static DHCP_PACKET *dpc_request_init(TALLOC_CTX *ctx, dpc_session_ctx_t *session
 		}
 	}
 
+	/* A simulated client (population mode) uses its own hardware address. */
+	if (population && session->client != DPC_CLIENT_NONE) {
+		VALUE_PAIR *vp;
+
+		fr_pair_delete_by_da(&request->vps, attr_dhcp_client_hardware_address);
+		vp = ncc_pair_create_by_da(request, &request->vps, attr_dhcp_client_hardware_address);
+		memcpy(vp->vp_ether, dpc_population_store(population)->chaddr[session->client], 6);
+	}
+
+gateway:
 	/* Prepare gateway handling. */
 	dpc_request_gateway_handle(request, session->gateway);
 
+done:
 	/*
 	 *	Use values prepared earlier.
 	 */
@@ -1563,13 +2561,33 @@ static DHCP_PACKET *dpc_request_init(TALLOC_CTX *ctx, dpc_session_ctx_t *session
 }
 
 /*
- *	Encode a DHCP packet.
+ *	Overwrite xid in packet data with id allocated.
  */
-static int dpc_dhcp_encode(DHCP_PACKET *packet)
+static void dpc_dhcp_xid_write(DHCP_PACKET *packet)
 {
-	int r;
-	VALUE_PAIR *vp;
-
+	if (packet->data_len >= 8) {
+		uint32_t lvalue = htonl(packet->id);
+		uint8_t *p = packet->data + 4;
+		memcpy(p, &lvalue, 4);
+	}
+}
+
+/*
+ *	Encode a DHCP packet.
+ */
+static int dpc_dhcp_encode(DHCP_PACKET *packet)
+{
+	int r;
+	VALUE_PAIR *vp;
+
+	/*
+	 *	Packet instantiated from a template is already encoded. Just set the xid.
+	 */
+	if (packet->data) {
+		dpc_dhcp_xid_write(packet);
+		return 0;
+	}
+
 	/*
 	 *	If DHCP encoded data is provided, use it as is. Do not call fr_dhcpv4_packet_encode.
 	 */
@@ -1578,12 +2596,7 @@ static int dpc_dhcp_encode(DHCP_PACKET *packet)
 		packet->data = talloc_zero_array(packet, uint8_t, packet->data_len);
 		memcpy(packet->data, vp->vp_octets, vp->vp_length);
 
-		/* Overwrite xid in packet data with id allocated. */
-		if (packet->data_len >= 8) {
-			uint32_t lvalue = htonl(packet->id);
-			uint8_t *p = packet->data + 4;
-			memcpy(p, &lvalue, 4);
-		}
+		dpc_dhcp_xid_write(packet);
 		return 0;
 	}
 
@@ -1701,12 +2714,12 @@ static bool dpc_item_get_rate(double *input_rate, dpc_input_t *input)
  */
 static bool dpc_item_rate_limited(dpc_input_t *input)
 {
-	if (!input->rate_limit) return false; /* No rate limit applies to this input. */
+	if (!input->rate_limit && !input->rate_profile) return false; /* No rate limit applies to this input. */
 
 	float elapsed_ref = dpc_item_get_elapsed(input);
 	uint32_t max_new_sessions = 0;
 
-	dpc_rate_limit_calc_gen(&max_new_sessions, input->rate_limit, elapsed_ref, input->num_use);
+	dpc_rate_limit_calc_gen(&max_new_sessions, input->rate_limit, input->rate_profile, elapsed_ref, input->num_use);
 	return (max_new_sessions == 0);
 }
 
@@ -1764,12 +2777,95 @@ static dpc_input_t *dpc_get_input_from_template(TALLOC_CTX *ctx)
 static dpc_input_t *dpc_get_input()
 {
 	if (!with_template) {
+		/* Top up the lookahead of streamed input items. */
+		if (input_stream_fp) dpc_input_stream_read(global_ctx);
+
 		return NCC_LIST_DEQUEUE(&vps_list_in);
 	} else {
 		return dpc_get_input_from_template(global_ctx);
 	}
 }
 
+/*
+ *	Get a session context, from the free list if there is one available, otherwise allocate a new one.
+ *	In a steady state, this (and everything allocated for the session) does not require any heap allocation.
+ */
+static dpc_session_ctx_t *dpc_session_alloc(TALLOC_CTX *ctx)
+{
+	dpc_session_ctx_t *session = session_free_list;
+
+	if (session) {
+		session_free_list = session->next_free;
+		session_free_num --;
+	} else {
+		MEM(session = talloc_pooled_object(ctx, dpc_session_ctx_t,
+		                                   DPC_SESSION_POOL_NUM_OBJECTS, DPC_SESSION_POOL_SIZE));
+	}
+
+	memset(session, 0, sizeof(*session));
+	session->client = DPC_CLIENT_NONE;
+	return session;
+}
+
+/*
+ *	Release a session context which is not used anymore.
+ *	Everything which was allocated from its pool is freed (the pool memory itself is kept), and the context is
+ *	put back in the free list. We retain at most twice the number of sessions allowed to be started in parallel
+ *	(sessions past their initial request, e.g. in a DORA workflow, are not accounted for in that limit).
+ */
+static void dpc_session_release(dpc_session_ctx_t *session)
+{
+	if (session_free_num >= 2 * ECTX.session_max_active) {
+		talloc_free(session);
+		return;
+	}
+
+	talloc_free_children(session);
+
+	session->next_free = session_free_list;
+	session_free_list = session;
+	session_free_num ++;
+}
+
+/*
+ *	Get the time at which a new session should have been started, according to the rate limit schedule (global
+ *	rate limit, or else the input rate limit). This is never later than the actual session start.
+ *	With pacing, this is when the pacing scheduler planned to start it (which, with Poisson pacing, is not the same
+ *	as the rate limit schedule).
+ *	Without a rate limit, sessions are started as soon as possible, so the intended start is the actual start.
+ */
+static fr_time_t dpc_session_intended_start(dpc_session_ctx_t *session, dpc_input_t *input)
+{
+	fr_time_t fte_intended;
+	double t;
+
+	if (dpc_pacing_active() && fte_pacing_next) {
+		/* Not yet advanced to the next session (cf. dpc_pacing_update). */
+		fte_intended = fte_pacing_next;
+	} else if (rate_profile) {
+		/* Sessions are numbered from 0, which is the first one started. */
+		t = dpc_rate_profile_time(rate_profile, session->id);
+		if (t < 0) return session->fte_start;
+		fte_intended = fte_sessions_ini_start + ncc_float_to_fr_time(t);
+	} else if (ECTX.rate_limit) {
+		fte_intended = fte_sessions_ini_start + ncc_float_to_fr_time(session->id / ECTX.rate_limit);
+	} else if (input->rate_profile) {
+		/* Input use count has already been incremented for this session. */
+		t = dpc_rate_profile_time(input->rate_profile, input->num_use - 1);
+		if (t < 0) return session->fte_start;
+		fte_intended = input->fte_start + ncc_float_to_fr_time(t);
+	} else if (input->rate_limit) {
+		fte_intended = input->fte_start + ncc_float_to_fr_time((input->num_use - 1) / input->rate_limit);
+	} else {
+		return session->fte_start;
+	}
+
+	/* We may start sessions slightly ahead of schedule (cf. rate limit lookahead). */
+	if (fte_intended > session->fte_start) fte_intended = session->fte_start;
+
+	return fte_intended;
+}
+
 /*
  *	Initialize a new session.
  */
@@ -1820,6 +2916,8 @@ static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx)
 		            input->id, input->num_use, input->max_use);
 		dpc_input_t *input_dup = dpc_input_item_copy(ctx, input);
 		if (input_dup) {
+			if (ECTX.input_stream) dpc_input_stream_hold(input_dup);
+
 			/*
 			 *	Add it to the list of input items.
 			 */
@@ -1830,18 +2928,18 @@ static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx)
 	/*
 	 *	Initialize the new session.
 	 */
-	MEM(session = talloc_zero(ctx, dpc_session_ctx_t));
+	session = dpc_session_alloc(ctx);
 	dpc_session_set_transport(session, input);
 
 	/*
-	 *	Prepare a DHCP packet to send for this session.
+	 *	Prepare a DHCP packet to send for this session (allocated from the session pool).
 	 */
-	packet = dpc_request_init(ctx, session, input);
+	packet = dpc_request_init(session, session, input);
 	if (!packet) {
 		/* Free this input now if we could not initialize a session from it. */
 		PERROR("Failed to initialize session from input (id: %u)", input->id);
 
-		talloc_free(session);
+		dpc_session_release(session);
 
 		/* Remove item from list before freeing. */
 		NCC_LIST_DRAW(input);
@@ -1852,7 +2950,6 @@ static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx)
 	session->id = session_num ++;
 
 	session->request = packet;
-	talloc_steal(session, packet);
 
 	session->input = input; /* Reference to the input (note: it doesn't belong to us). */
 
@@ -1869,6 +2966,7 @@ static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx)
 
 	/* Store session start time. */
 	session->fte_start = fr_time();
+	if (with_co_correct) session->fte_intended = dpc_session_intended_start(session, input);
 
 	session_num_in ++;
 	session_num_active ++;
@@ -1882,6 +2980,164 @@ static dpc_session_ctx_t *dpc_session_init_from_input(TALLOC_CTX *ctx)
 	return session;
 }
 
+/*
+ *	Initialize a new session on behalf of a simulated client (population mode), to send either a Discover (to
+ *	acquire a lease), a Request (to renew or rebind it), or a Release.
+ *	All simulated clients use the first input item (which is never consumed), with their own hardware address.
+ *	If the client holds a lease, ciaddr is its address. If a server is provided, the request is unicast to it
+ *	(renewing, or releasing). Otherwise it goes where the input says (discovering, or rebinding).
+ */
+static dpc_session_ctx_t *dpc_client_session_init(TALLOC_CTX *ctx, uint32_t idx, unsigned int code,
+                                                  uint32_t ciaddr, uint32_t server_id)
+{
+	dpc_input_t *input = (dpc_input_t *)vps_list_in.head;
+	dpc_session_ctx_t *session = NULL;
+	DHCP_PACKET *packet = NULL;
+
+	if (!input) return NULL;
+
+	DEBUG_TRACE("Initializing a new session (id: %u) for client %u", session_num, idx);
+
+	if (!fte_sessions_ini_start) {
+		fte_sessions_ini_start = fr_time();
+	}
+	if (input->num_use == 0) input->fte_start = fr_time();
+	input->num_use ++;
+
+	/* xid is supposed to be selected by client. Let the program pick a new one. */
+	input->ext.xid = DPC_PACKET_ID_UNASSIGNED;
+
+	session = dpc_session_alloc(ctx);
+	dpc_session_set_transport(session, input);
+	session->client = idx;
+
+	if (server_id) session->dst.ipaddr.addr.v4.s_addr = server_id;
+
+	packet = dpc_request_init(session, session, input);
+	if (!packet) {
+		PERROR("Failed to initialize session for client %u", idx);
+		dpc_session_release(session);
+		return NULL;
+	}
+
+	packet->code = code;
+
+	switch (code) {
+	case FR_DHCP_DISCOVER:
+		session->state = DPC_STATE_DORA_EXPECT_OFFER;
+		break;
+
+	case FR_DHCP_REQUEST:
+	case FR_DHCP_RELEASE:
+		/*
+		 *	The client has a lease: set field ciaddr (DHCP-Client-IP-Address), and no option 50.
+		 *	Option 54 is only provided in a Release (RFC 2131, section 4.3.2).
+		 */
+		fr_pair_delete_by_da(&packet->vps, attr_dhcp_requested_ip_address);
+		fr_pair_delete_by_da(&packet->vps, attr_dhcp_server_identifier);
+		fr_pair_delete_by_da(&packet->vps, attr_dhcp_client_ip_address);
+		dpc_pair_ipv4addr_add(packet, attr_dhcp_client_ip_address, ciaddr);
+
+		if (code == FR_DHCP_RELEASE) {
+			dpc_pair_ipv4addr_add(packet, attr_dhcp_server_identifier, server_id);
+			session->state = DPC_STATE_NO_REPLY;
+		} else {
+			session->state = DPC_STATE_EXPECT_REPLY;
+		}
+		break;
+	}
+
+	session->id = session_num ++;
+	session->request = packet;
+	session->input = input; /* Reference to the input (note: it doesn't belong to us). */
+	session->reply_expected = is_dhcp_reply_expected(code);
+
+	session->fte_start = fr_time();
+	if (with_co_correct) session->fte_intended = dpc_session_intended_start(session, input);
+
+	session_num_in ++;
+	session_num_active ++;
+	session_num_in_active ++;
+	session_num_parallel ++;
+	fte_last_session_in = fr_time();
+
+	SDEBUG2("New session initialized for client %u - active sessions: %u (in: %u), parallel: %u",
+	        idx, session_num_active, session_num_in_active, session_num_parallel);
+
+	return session;
+}
+
+/*
+ *	Initialize a new session for the next simulated client which is due to act (population mode): acquire a
+ *	lease, or renew it (at T1), or rebind it (after T2).
+ */
+static dpc_session_ctx_t *dpc_session_init_from_population(TALLOC_CTX *ctx)
+{
+	dpc_session_ctx_t *session;
+	dpc_lease_store_t *store = dpc_population_store(population);
+	uint32_t idx;
+
+	idx = dpc_population_ready_get(population);
+	if (idx == DPC_CLIENT_NONE) return NULL; /* No client has anything to do right now. */
+
+	switch (dpc_population_client_start(population, idx)) {
+	case DPC_CLIENT_RENEWING:
+		session = dpc_client_session_init(ctx, idx, FR_DHCP_REQUEST, store->yiaddr[idx], store->server_id[idx]);
+		break;
+
+	case DPC_CLIENT_REBINDING:
+		session = dpc_client_session_init(ctx, idx, FR_DHCP_REQUEST, store->yiaddr[idx], 0);
+		break;
+
+	default:
+		session = dpc_client_session_init(ctx, idx, FR_DHCP_DISCOVER, 0, 0);
+		break;
+	}
+
+	/* If we couldn't, the client will try again later. */
+	if (!session) dpc_population_client_end(population, idx);
+
+	return session;
+}
+
+/*
+ *	Release the leases held by simulated clients (population mode), once we're done with them.
+ *	No reply is expected. Releases are sent no faster than the current target rate (if any), and a lease is
+ *	only considered released once its DHCP Release has been sent.
+ */
+static void dpc_population_release_all(void)
+{
+	uint32_t i, num = dpc_population_num(population);
+	uint32_t yiaddr, server_id;
+	uint32_t num_sent = 0;
+	double rate = dpc_rate_limit_get();
+	fr_time_t fte_start = fr_time();
+
+	for (i = 0; i < num; i++) {
+		dpc_session_ctx_t *session;
+
+		if (!dpc_population_client_lease(population, i, &yiaddr, &server_id)) continue;
+
+		/* Wait until this release is due. */
+		if (rate > 0) {
+			fr_time_t fte_due = fte_start + (fr_time_t)(num_sent / rate * NSEC);
+			fr_time_t now = fr_time();
+
+			if (fte_due > now) usleep((fte_due - now) / 1000);
+		}
+
+		session = dpc_client_session_init(global_ctx, i, FR_DHCP_RELEASE, yiaddr, server_id);
+		if (!session) continue;
+
+		session->num_send = 1;
+		if (dpc_send_one_packet(session, &session->request, false) == 0) {
+			dpc_population_client_release(population, i);
+			num_sent ++;
+		}
+		dpc_session_finish(session);
+	}
+}
+
 /*
  *	One session is finished.
  */
@@ -1898,11 +3154,8 @@ static void dpc_session_finish(dpc_session_ctx_t *session)
 		}
 	}
 
-	/* Clear the event timer if it is armed. */
-	if (session->event) {
-		fr_event_timer_delete(event_list, &session->event);
-		session->event = NULL;
-	}
+	/* Clear the request timeout if it is armed. */
+	NCC_LIST_DRAW(session);
 
 	/* Update counters. */
 	session_num_active --;
@@ -1910,11 +3163,48 @@ static void dpc_session_finish(dpc_session_ctx_t *session)
 		session_num_in_active --;
 		if (session->num_send == 1) session_num_parallel --; /* This was a session "initial request". */
 		//gettimeofday(&tve_last_session_in, NULL); // why ?? zzz
+
+		/* A streamed input item is not needed anymore (a copy was made if it has to be used again). */
+		if (ECTX.input_stream) talloc_free(session->input);
+	}
+
+	/* A simulated client which did not get what it asked for will try again later. */
+	if (population && session->client != DPC_CLIENT_NONE) {
+		dpc_population_client_end(population, session->client);
 	}
 
 	SDEBUG2("Session terminated - active sessions: %u (in: %u), parallel: %u",
 	         session_num_active, session_num_in_active, session_num_parallel);
-	talloc_free(session);
+	dpc_session_release(session);
+}
+
+/*
+ *	Get the time of the next scheduled event: either a request timeout, or the progress statistics.
+ *	Or, in population mode, when simulated clients are next due to act.
+ *	Returns false if there is none.
+ */
+static bool dpc_next_event_time(fr_time_t *when)
+{
+	bool found = dpc_request_timeout_next(when);
+	fr_time_t fte_client = population ? dpc_population_next_event(population) : 0;
+
+	if (ev_progress_stats && (!found || fte_progress_stat < *when)) {
+		*when = fte_progress_stat;
+		found = true;
+	}
+	if (ev_ts_stats && (!found || fte_ts_stat < *when)) {
+		*when = fte_ts_stat;
+		found = true;
+	}
+	if (ev_search && (!found || fte_search < *when)) {
+		*when = fte_search;
+		found = true;
+	}
+	if (fte_client && (!found || fte_client < *when)) {
+		*when = fte_client;
+		found = true;
+	}
+	return found;
 }
 
 /*
@@ -1931,10 +3221,24 @@ static void dpc_loop_recv(void)
 		 */
 		fr_time_t now, when;
 		fr_time_delta_t wait_max = 0;
+		bool found = dpc_next_event_time(&when);
+
+		/* In population mode, we can also wait if no client has anything to do right now. */
+		bool clients_idle = (population && start_sessions_flag && !dpc_population_num_ready(population));
+		bool pacing = (dpc_pacing_active() && session_num_parallel < ECTX.session_max_active && !clients_idle);
 
-		if (session_num_active >= ECTX.session_max_active && ncc_fr_event_timer_peek(event_list, &when)) {
+		/* With pacing, we can also wait until the next session is due to be started. */
+		if (pacing && (!found || fte_pacing_next < when)) {
+			when = fte_pacing_next;
+			found = true;
+		}
+
+		if ((pacing || clients_idle || session_num_active >= ECTX.session_max_active) && found) {
 			now = fr_time();
 			if (when > now) wait_max = when - now; /* No negative. */
+
+			/* Don't oversleep if we're pacing: busy-wait for the remaining time. */
+			if (pacing) wait_max = (wait_max > ftd_pacing_spin) ? wait_max - ftd_pacing_spin : 0;
 		}
 
 		/*
@@ -1950,7 +3254,8 @@ static void dpc_loop_recv(void)
  *
  *	Returns: true if a limit has to be enforced at the moment, false otherwise.
  */
-static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit_ref, float elapsed_ref, uint32_t cur_num_started)
+static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit_ref, dpc_rate_profile_t const *profile,
+                                    float elapsed_ref, uint32_t cur_num_started)
 {
 	if (elapsed_ref < ECTX.min_ref_time_rate_limit) {
 		/*
@@ -1963,7 +3268,10 @@ static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit
 	/* Allow to start a bit more right now to compensate for server delay and our own internal tasks. */
 	elapsed_ref += ECTX.rate_limit_time_lookahead;
 
-	uint32_t session_limit = rate_limit_ref * elapsed_ref + 1; /* + 1 so we always start at least one at the beginning. */
+	/* Number of sessions due so far, either at a fixed rate, or according to a rate schedule. */
+	double due = profile ? dpc_rate_profile_due(profile, elapsed_ref) : rate_limit_ref * elapsed_ref;
+
+	uint32_t session_limit = due + 1; /* + 1 so we always start at least one at the beginning. */
 
 	if (cur_num_started >= session_limit) {
 		/* Already beyond limit, don't start new sessions for now. */
@@ -1979,12 +3287,142 @@ static bool dpc_rate_limit_calc_gen(uint32_t *max_new_sessions, float rate_limit
  */
 static bool dpc_rate_limit_calc(uint32_t *max_new_sessions)
 {
-	if (!ECTX.rate_limit) return false;
+	if (!dpc_with_rate_limit()) return false;
 
 	float elapsed_ref = dpc_start_sessions_elapsed_time_get();
-	return dpc_rate_limit_calc_gen(max_new_sessions, ECTX.rate_limit, elapsed_ref, session_num);
+
+	/*
+	 *	In population mode, clients may have nothing to do for a long time (e.g. until T1 is reached). Sessions
+	 *	which were due meanwhile are forgotten: the rate limit only applies from the last time clients were idle,
+	 *	so that sessions which then fall due are not started in a burst to catch up.
+	 */
+	if (population) {
+		uint32_t session_limit, num_started;
+
+		if (!dpc_population_num_ready(population)) {
+			rate_idle_elapsed = elapsed_ref;
+			rate_idle_num = session_num;
+		}
+
+		/* + 1 so we can start one as soon as a client is ready. */
+		session_limit = dpc_rate_due(elapsed_ref + ECTX.rate_limit_time_lookahead) - dpc_rate_due(rate_idle_elapsed) + 1;
+		num_started = session_num - rate_idle_num;
+
+		*max_new_sessions = (num_started >= session_limit) ? 0 : session_limit - num_started;
+		return true;
+	}
+
+	return dpc_rate_limit_calc_gen(max_new_sessions, ECTX.rate_limit, rate_profile, elapsed_ref, session_num);
+}
+
+/*
+ *	Check if a global rate limit (fixed, or from a rate schedule) is applicable.
+ */
+static bool dpc_with_rate_limit(void)
+{
+	return (ECTX.rate_limit || rate_profile);
+}
+
+/*
+ *	Get the current global target rate (0 if there is none).
+ */
+static double dpc_rate_limit_get(void)
+{
+	if (rate_profile) return dpc_rate_profile_rate(rate_profile, dpc_start_sessions_elapsed_time_get());
+	return ECTX.rate_limit;
+}
+
+/*
+ *	Get the number of sessions due at a given elapsed time, according to the global rate limit (fixed, or from a
+ *	rate schedule).
+ */
+static double dpc_rate_due(double elapsed)
+{
+	if (rate_profile) return dpc_rate_profile_due(rate_profile, elapsed);
+	return ECTX.rate_limit * elapsed;
+}
+
+/*
+ *	Get the current target rate of an input item (0 if there is none).
+ */
+static double dpc_item_rate_limit_get(dpc_input_t *input)
+{
+	if (input->rate_profile) return dpc_rate_profile_rate(input->rate_profile, dpc_item_get_elapsed(input));
+	return input->rate_limit;
+}
+
+/*
+ *	Check if sessions are started by the pacing scheduler (which requires a global rate limit).
+ */
+static bool dpc_pacing_active(void)
+{
+	return (ECTX.pacing != DPC_PACING_BURST && dpc_with_rate_limit() && start_sessions_flag);
+}
+
+/*
+ *	Schedule the next session to be started by the pacing scheduler: at the time when the rate schedule (fixed rate,
+ *	or rate profile) has pacing_due sessions due. So a change of rate takes effect right away, and no session is
+ *	started while the target rate is 0.
+ *	Returns false if this never happens (the rate profile ends with a rate of 0).
+ */
+static bool dpc_pacing_schedule(fr_time_t now)
+{
+	fr_time_t fte_origin = fte_sessions_ini_start ? fte_sessions_ini_start : now; /* No session started yet. */
+	double t;
+
+	if (rate_profile) {
+		t = dpc_rate_profile_time(rate_profile, pacing_due);
+		if (t < 0) return false;
+	} else {
+		t = pacing_due / ECTX.rate_limit;
+	}
+
+	fte_pacing_next = fte_origin + ncc_float_to_fr_time(t);
+	return true;
 }
 
+/*
+ *	A session has just been started by the pacing scheduler: update pacing statistics, and schedule the next one.
+ *	The schedule is open-loop: it does not depend on when sessions are actually started. If we're late (e.g. because
+ *	too many sessions are active), sessions are started as fast as possible until we're back on schedule.
+ */
+static void dpc_pacing_update(fr_time_t fte_started)
+{
+	dpc_pacing_stats_t *my_stats = &stat_ctx.pacing;
+	fr_time_delta_t late = (fte_started > fte_pacing_next) ? fte_started - fte_pacing_next : 0;
+
+	if (late > my_stats->late_max) my_stats->late_max = late;
+	my_stats->late_cumul += late;
+	dpc_histogram_add(&my_stats->late_histo, late);
+	my_stats->num ++;
+
+	if (fte_pacing_prev) {
+		fr_time_delta_t gap = fte_started - fte_pacing_prev;
+		double gap_f = ncc_fr_time_to_float(gap);
+
+		if (my_stats->num_gap == 0 || gap < my_stats->gap_min) my_stats->gap_min = gap;
+		if (my_stats->num_gap == 0 || gap > my_stats->gap_max) my_stats->gap_max = gap;
+
+		my_stats->gap_cumul += gap_f;
+		my_stats->gap_sq_cumul += gap_f * gap_f;
+		my_stats->num_gap ++;
+	}
+	fte_pacing_prev = fte_started;
+
+	if (ECTX.pacing == DPC_PACING_POISSON) {
+		/*
+		 *	Exponentially distributed number of sessions (with a mean of 1) between two starts, which makes for
+		 *	exponentially distributed intervals at the current rate. (Random value in ]0..1], so log is defined.)
+		 */
+		double rnd = ((double)fr_rand() + 1) / ((double)UINT32_MAX + 1);
+		pacing_due += -log(rnd);
+	} else {
+		pacing_due += 1;
+	}
+
+	/* If no session will ever be due, this is handled when trying to start the next one. */
+	if (!dpc_pacing_schedule(fte_started)) fte_pacing_next = 0;
+}
 
 /*
  *	Stop starting new sessions.
@@ -2020,7 +3458,8 @@ static uint32_t dpc_loop_start_sessions(void)
 	if (!start_sessions_flag) return 0;
 
 	uint32_t limit_new_sessions = 0;
-	bool do_limit = dpc_rate_limit_calc(&limit_new_sessions);
+	bool do_pacing = dpc_pacing_active();
+	bool do_limit = do_pacing ? false : dpc_rate_limit_calc(&limit_new_sessions);
 
 	/* Set a max allowed loop time - don't loop forever in case of packets not expecting replies. */
 	fr_time_delta_t fte_loop_max = fr_time() + ftd_loop_max_time;
@@ -2029,6 +3468,12 @@ static uint32_t dpc_loop_start_sessions(void)
 	if (fte_progress_stat && fte_loop_max > fte_progress_stat) {
 		fte_loop_max = fte_progress_stat;
 	}
+	if (fte_ts_stat && fte_loop_max > fte_ts_stat) {
+		fte_loop_max = fte_ts_stat;
+	}
+	if (ev_search && fte_loop_max > fte_search) {
+		fte_loop_max = fte_search;
+	}
 
 	while (!done) {
 		/* Max loop time limit reached. */
@@ -2053,7 +3498,7 @@ static uint32_t dpc_loop_start_sessions(void)
 		}
 
 		/* No more input. */
-		if (!with_template && vps_list_in.size == 0) {
+		if (!with_template && vps_list_in.size == 0 && !input_stream_fp) {
 			start_sessions_flag = false;
 			break;
 		}
@@ -2066,10 +3511,27 @@ static uint32_t dpc_loop_start_sessions(void)
 		/* Rate limit enforced and we've already started as many sessions as allowed for now. */
 		if (do_limit && num_started >= limit_new_sessions) break;
 
+		/* Pacing, and next session is not due yet. */
+		if (do_pacing) {
+			/* In population mode, sessions which were due while clients had nothing to do are forgotten. */
+			if (population && !dpc_population_num_ready(population)) {
+				fte_pacing_next = 0;
+				break;
+			}
+			if (!fte_pacing_next) pacing_due = dpc_rate_due(dpc_start_sessions_elapsed_time_get());
+			if (!fte_pacing_next && !dpc_pacing_schedule(now)) {
+				INFO("Rate profile ends with a rate of 0: will not start any new session.");
+				start_sessions_flag = false;
+				break;
+			}
+			if (now < fte_pacing_next) break;
+		}
+
 		/*
 		 *	Initialize a new session, if possible.
 		 */
-		dpc_session_ctx_t *session = dpc_session_init_from_input(global_ctx);
+		dpc_session_ctx_t *session = population ? dpc_session_init_from_population(global_ctx)
+		                                        : dpc_session_init_from_input(global_ctx);
 		if (!session) {
 			/* There is no input available at this point. */
 
@@ -2078,8 +3540,10 @@ static uint32_t dpc_loop_start_sessions(void)
 
 		session->num_send = 1;
 
-		/* Send the packet. */
-		if (dpc_send_one_packet(session, &session->request) < 0
+		if (do_pacing) dpc_pacing_update(session->fte_start);
+
+		/* Send the packet. (With pacing, don't defer sending, this would defeat the purpose.) */
+		if (dpc_send_one_packet(session, &session->request, !do_pacing) < 0
 		    || !session->reply_expected /* No reply is expected to this kind of packet (e.g. Release). */
 		    || !ECTX.request_timeout /* Do not wait for a reply. */
 		    ) {
@@ -2088,12 +3552,15 @@ static uint32_t dpc_loop_start_sessions(void)
 			/*
 			 *	Arm request timeout.
 			 */
-			dpc_event_add_request_timeout(session, NULL);
+			dpc_request_timeout_arm(session);
 		}
 
 		num_started ++;
 	}
 
+	/* Send whatever we've queued. */
+	dpc_packet_list_send_flush(pl);
+
 	return num_started;
 }
 
@@ -2103,11 +3570,11 @@ static uint32_t dpc_loop_start_sessions(void)
 static void dpc_loop_timer_events(void)
 {
 	int num_processed = 0; /* Number of timers events triggered. */
-	fr_time_t now;
+	fr_time_t now = fr_time();
 
-	if (fr_event_list_num_timers(event_list) <= 0) return;
+	dpc_request_timeout_run(now);
 
-	now = fr_time();
+	if (fr_event_list_num_timers(event_list) <= 0) return;
 
 	while (fr_event_timer_run(event_list, &now)) {
 		num_processed ++;
@@ -2125,8 +3592,15 @@ static bool dpc_loop_check_done(void)
 	/* There are still active sessions. */
 	if (session_num_active > 0) return false;
 
-	/* There are still events to process (ignoring the progress statistics event if it is armed). */
-	if (fr_event_list_num_timers(event_list) - ((ev_progress_stats != NULL) ? 1 : 0) > 0) return false;
+	/* There are still request timeouts armed. */
+	if (timeout_list.size > 0) return false;
+
+	/*
+	 *	There are still events to process (ignoring the statistics events if they are armed, and the search
+	 *	event: it only adjusts the rate of sessions we start).
+	 */
+	if (fr_event_list_num_timers(event_list) - ((ev_progress_stats != NULL) ? 1 : 0)
+	    - ((ev_ts_stats != NULL) ? 1 : 0) - ((ev_search != NULL) ? 1 : 0) > 0) return false;
 
 	/* We still have sessions to start. */
 	if (start_sessions_flag) return false;
@@ -2141,21 +3615,48 @@ static bool dpc_loop_check_done(void)
  */
 static void dpc_main_loop(void)
 {
+	dpc_loop_stats_t *loop = &stat_ctx.loop;
+	fr_time_t fte_loop_start = 0, fte_recv = 0, fte_timers = 0;
+
 	job_done = false;
 
 	while (!job_done) {
+		/*
+		 *	Time only some of the iterations, so this costs (almost) nothing.
+		 */
+		loop_sampled = (loop->num_iter % DPC_LOOP_SAMPLE_RATE == 0);
+		loop->num_iter ++;
+
+		if (loop_sampled) {
+			ftd_loop_idle = 0;
+			fte_loop_start = fr_time();
+		}
+
 		/* Start new sessions. */
-		dpc_loop_start_sessions();
+		loop->num_started += dpc_loop_start_sessions();
+
+		if (loop_sampled) fte_recv = fr_time();
 
 		/* Receive and process reply packets. */
 		dpc_loop_recv();
 
+		if (loop_sampled) fte_timers = fr_time();
+
 		/* Handle timer events. */
 		dpc_loop_timer_events();
 
 		/* Check if we're done. */
 		dpc_loop_check_done();
+
+		if (loop_sampled) {
+			loop->phase[DPC_LOOP_START] += fte_recv - fte_loop_start;
+			loop->phase[DPC_LOOP_RECV] += fte_timers - fte_recv - ftd_loop_idle;
+			loop->phase[DPC_LOOP_IDLE] += ftd_loop_idle;
+			loop->phase[DPC_LOOP_TIMERS] += fr_time() - fte_timers;
+			loop->num_sampled ++;
+		}
 	}
+	loop_sampled = false;
 }
 
 /*
@@ -2182,7 +3683,7 @@ static void dpc_input_socket_allocate(dpc_input_t *input)
 	/*
 	 *	Allocate the socket now. If we can't, stop.
 	 */
-	if (dpc_socket_provide(pl, &input->ext.src.ipaddr, input->ext.src.port) < 0) {
+	if (dpc_socket_preallocate(&input->ext.src.ipaddr, input->ext.src.port) < 0) {
 		char src_ipaddr_buf[FR_IPADDR_STRLEN] = "";
 		PERROR("Failed to provide a suitable socket (input id: %u, requested socket src: %s:%u)", input->id,
 		       fr_inet_ntop(src_ipaddr_buf, sizeof(src_ipaddr_buf), &input->ext.src.ipaddr), input->ext.src.port);
@@ -2250,6 +3751,7 @@ static bool dpc_parse_input(dpc_input_t *input)
 		if (vp->type == VT_XLAT) {
 
 			if (with_xlat) {
+				if (!input->do_xlat) input->xlat_set = ncc_xlat_frame_set_alloc();
 				input->do_xlat = true;
 
 				xlat_exp_t *xlat = NULL;
@@ -2285,10 +3787,25 @@ static bool dpc_parse_input(dpc_input_t *input)
 				talloc_free(value);
 
 				/*
-				 *	Store the compiled xlat (xlat_exp_t).
+				 *	Store the compiled xlat (xlat_exp_t), and a native generator if the whole value can be
+				 *	produced without the xlat engine (e.g. "%{ethaddr.range:...}").
 				 *	For this we use the "generic pointer" vp_ptr (data.datum.ptr)
 				 */
-				vp->vp_ptr = xlat;
+				dpc_xlat_compiled_t *compiled;
+				MEM(compiled = talloc_zero(global_ctx, dpc_xlat_compiled_t));
+				compiled->xlat = xlat;
+				compiled->gen = ncc_xlat_gen_compile(compiled, vp->xlat, vp->da->type);
+				if (compiled->gen) {
+					DEBUG_TRACE("Native generator for '%s' (input id: %u)", vp->da->name, input->id);
+				}
+
+				vp->vp_ptr = compiled;
+
+				/* Streamed input items are freed once used: the compiled xlat goes with the last copy. */
+				if (ECTX.input_stream) {
+					compiled->refs = 1;
+					talloc_steal(compiled, xlat);
+				}
 
 			} else {
 				/*
@@ -2356,6 +3873,12 @@ static bool dpc_parse_input(dpc_input_t *input)
 
 		} else if (vp->da == attr_request_label) { /* Request-Label = <string> */
 			input->request_label = talloc_strdup(input, vp->vp_strvalue);
+
+		} else if (vp->da == attr_rate_profile) { /* Rate-Profile = "<time>:<rate>, ..." */
+			input->rate_profile = dpc_rate_profile_parse(input, vp->vp_strvalue);
+			if (!input->rate_profile) {
+				PWARN("Invalid value for attribute %s", vp->da->name);
+			}
 		}
 
 	} /* loop over the input vps */
@@ -2450,27 +3973,110 @@ static void dpc_input_debug(dpc_input_t *input)
 }
 
 /*
- *	Handle a list of input vps we've just read.
+ *	Free a streamed input item. The compiled xlat expressions it shares with its copies (if any), and its xlat frames,
+ *	are freed along with the last of these.
  */
-static void dpc_handle_input(dpc_input_t *input, ncc_list_t *list)
+static int _dpc_input_stream_free(dpc_input_t *input)
 {
-	input->id = input_num ++;
+	fr_cursor_t cursor;
+	VALUE_PAIR *vp;
+	dpc_xlat_compiled_t *compiled;
+	bool last = false;
 
-	if (!dpc_parse_input(input)) {
-		/*
-		 *	Invalid item. Discard.
-		 */
-		talloc_free(input);
-		return;
+	for (vp = fr_cursor_init(&cursor, &input->vps); vp; vp = fr_cursor_next(&cursor)) {
+		if (vp->type != VT_XLAT || !vp->vp_ptr) continue;
+
+		compiled = vp->vp_ptr;
+		if (--compiled->refs == 0) {
+			talloc_free(compiled);
+			last = true;
+		}
 	}
 
-	/* Trace what we've read. */
-	dpc_input_debug(input);
+	if (last) ncc_xlat_frame_set_free(input->xlat_set);
 
-	/*
-	 *	Add it to the list of input items.
-	 */
-	NCC_LIST_ENQUEUE(list, input);
+	return 0;
+}
+
+/*
+ *	Hold a streamed input item (or a copy), so that what it shares with other copies is not freed before it is.
+ */
+static void dpc_input_stream_hold(dpc_input_t *input)
+{
+	fr_cursor_t cursor;
+	VALUE_PAIR *vp;
+	dpc_xlat_compiled_t *compiled;
+
+	for (vp = fr_cursor_init(&cursor, &input->vps); vp; vp = fr_cursor_next(&cursor)) {
+		if (vp->type != VT_XLAT || !vp->vp_ptr) continue;
+
+		compiled = vp->vp_ptr;
+		compiled->refs ++;
+	}
+
+	talloc_set_destructor(input, _dpc_input_stream_free);
+}
+
+/*
+ *	Handle a list of input vps we've just read.
+ *	Return true if the input item is valid (and added to the list), false if it was discarded.
+ */
+static bool dpc_handle_input(dpc_input_t *input, ncc_list_t *list)
+{
+	input->id = input_num ++;
+
+	if (!dpc_parse_input(input)) {
+		/*
+		 *	Invalid item. Discard.
+		 */
+		if (input->do_xlat) ncc_xlat_frame_set_free(input->xlat_set);
+		talloc_free(input);
+		return false;
+	}
+
+	/* Trace what we've read. */
+	dpc_input_debug(input);
+
+	/* The compiled xlat expressions of a streamed input item have been created with one reference already. */
+	if (ECTX.input_stream) talloc_set_destructor(input, _dpc_input_stream_free);
+
+	/*
+	 *	Add it to the list of input items.
+	 */
+	NCC_LIST_ENQUEUE(list, input);
+	return true;
+}
+
+/*
+ *	Read one input item (a list of vps) from a file.
+ *	Return NULL if there is nothing left to read.
+ */
+static dpc_input_t *dpc_input_read(TALLOC_CTX *ctx, FILE *file_in, char const *filename, bool *file_done)
+{
+	dpc_input_t *input;
+
+	MEM(input = talloc_zero(ctx, dpc_input_t));
+	input->ext.xid = DPC_PACKET_ID_UNASSIGNED;
+
+	if (fr_pair_list_afrom_file(input, dict_dhcpv4, &input->vps, file_in, file_done) < 0) {
+		PERROR("Failed to read input items from %s", filename);
+		exit(EXIT_FAILURE); /* Be unforgiving. */
+	}
+	if (!input->vps) {
+		/* Last line might be empty, in this case we will obtain a NULL vps pointer. Silently ignore this. */
+		talloc_free(input);
+		*file_done = true;
+		return NULL;
+	}
+	fr_strerror(); /* Clear the error buffer */
+	/*
+	 *	After calling fr_pair_list_afrom_file we get weird things in FreeRADIUS error buffer, e.g.:
+	 *	"Invalid character ':' in attribute name".
+	 *	This happens apparently when handling an ethernet address (which is a value, not an attribute name).
+	 *	Just ignore this.
+	*/
+
+	return input;
 }
 
 /*
@@ -2485,26 +4091,8 @@ static void dpc_input_load_from_fd(TALLOC_CTX *ctx, FILE *file_in, ncc_list_t *l
 	 *	Loop until the file is done.
 	 */
 	do {
-		MEM(input = talloc_zero(ctx, dpc_input_t));
-		input->ext.xid = DPC_PACKET_ID_UNASSIGNED;
-
-		if (fr_pair_list_afrom_file(input, dict_dhcpv4, &input->vps, file_in, &file_done) < 0) {
-			PERROR("Failed to read input items from %s", filename);
-			exit(EXIT_FAILURE); /* Be unforgiving. */
-			break;
-		}
-		if (!input->vps) {
-			/* Last line might be empty, in this case we will obtain a NULL vps pointer. Silently ignore this. */
-			talloc_free(input);
-			break;
-		}
-		fr_strerror(); /* Clear the error buffer */
-		/*
-		 *	After calling fr_pair_list_afrom_file we get weird things in FreeRADIUS error buffer, e.g.:
-		 *	"Invalid character ':' in attribute name".
-		 *	This happens apparently when handling an ethernet address (which is a value, not an attribute name).
-		 *	Just ignore this.
-		*/
+		input = dpc_input_read(ctx, file_in, filename, &file_done);
+		if (!input) break;
 
 		dpc_handle_input(input, list);
 
@@ -2515,6 +4103,64 @@ static void dpc_input_load_from_fd(TALLOC_CTX *ctx, FILE *file_in, ncc_list_t *l
 
 }
 
+/*
+ *	Move on to the next source of streamed input: stdin (if there's something on it), then the input file.
+ *	Return false if there is none left.
+ */
+static bool dpc_input_stream_next_source(void)
+{
+	bool from_stdin = (input_stream_fp == stdin);
+
+	if (input_stream_fp && !from_stdin) fclose(input_stream_fp);
+	input_stream_fp = NULL;
+
+	if (!input_stream_name && with_stdin_input) {
+		DEBUG("Streaming input from stdin");
+		input_stream_fp = stdin;
+		input_stream_name = "stdin";
+		return true;
+	}
+
+	if ((!input_stream_name || from_stdin) && file_vps_in && strcmp(file_vps_in, "-") != 0) {
+		DEBUG("Streaming input from file: %s", file_vps_in);
+
+		input_stream_fp = fopen(file_vps_in, "r");
+		if (!input_stream_fp) {
+			ERROR("Error opening %s: %s", file_vps_in, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		input_stream_name = file_vps_in;
+		return true;
+	}
+
+	DEBUG("Done streaming input, valid items read: %u", input_stream_num);
+	return false;
+}
+
+/*
+ *	Read streamed input items, until we have enough ahead of us (or there is nothing more to read).
+ */
+static void dpc_input_stream_read(TALLOC_CTX *ctx)
+{
+	bool file_done;
+	dpc_input_t *input;
+
+	while (input_stream_fp && vps_list_in.size < ECTX.input_stream) {
+		/* Stop reading if we know we won't need it. */
+		if (ECTX.session_max_num && input_stream_num >= ECTX.session_max_num) {
+			if (input_stream_fp != stdin) fclose(input_stream_fp);
+			input_stream_fp = NULL;
+			break;
+		}
+
+		file_done = false;
+		input = dpc_input_read(ctx, input_stream_fp, input_stream_name, &file_done);
+		if (input && dpc_handle_input(input, &vps_list_in)) input_stream_num ++;
+
+		if (file_done) dpc_input_stream_next_source();
+	}
+}
+
 /*
  *	Load input vps, either from a file if specified, or stdin otherwise.
  */
@@ -2522,11 +4168,20 @@ static int dpc_input_load(TALLOC_CTX *ctx)
 {
 	FILE *file_in = NULL;
 
+	if (ncc_stdin_peek()) with_stdin_input = true;
+
+	/*
+	 *	When streaming, only read the first input items. Others are read as we go.
+	 */
+	if (ECTX.input_stream) {
+		if (dpc_input_stream_next_source()) dpc_input_stream_read(ctx);
+		return 0;
+	}
+
 	/*
 	 *	If there's something on stdin, read it.
 	 */
-	if (ncc_stdin_peek()) {
-		with_stdin_input = true;
+	if (with_stdin_input) {
 
 		DEBUG("Reading input from stdin");
 		dpc_input_load_from_fd(ctx, stdin, &vps_list_in, "stdin");
@@ -2566,8 +4221,6 @@ static int dpc_pair_list_xlat(DHCP_PACKET *packet, VALUE_PAIR *vps)
 {
 	fr_cursor_t cursor;
 	VALUE_PAIR *vp;
-	ssize_t len;
-	char buffer[DPC_XLAT_MAX_LEN];
 
 	for (vp = fr_cursor_init(&cursor, &vps); vp; vp = fr_cursor_next(&cursor)) {
 		/*
@@ -2575,25 +4228,14 @@ static int dpc_pair_list_xlat(DHCP_PACKET *packet, VALUE_PAIR *vps)
 		 *	Allow any data type. Value will be cast by FreeRADIUS (if possible).
 		 */
 		if (vp->type == VT_XLAT) {
-			/* Retrieve pre-compiled xlat, and use it to perform expansion. */
-			xlat_exp_t *xlat = vp->vp_ptr;
-			if (!xlat) {
+			/* Retrieve pre-compiled xlat, and use it to obtain the value. */
+			dpc_xlat_compiled_t *compiled = vp->vp_ptr;
+			if (!compiled) {
 				fr_strerror_printf("Cannot xlat %s = [%s]: expression was not compiled", vp->da->name, vp->xlat);
 				return -1;
 			}
 
-			len = dpc_xlat_eval_compiled(buffer, sizeof(buffer), xlat, packet);
-			if (len <= 0) { /* Consider empty string as failed expansion. */
-				fr_strerror_printf("Failed to expand xlat '%s': %s", vp->da->name, fr_strerror());
-				return -1;
-			}
-
-			vp->vp_ptr = NULL; /* Otherwise fr_pair_value_strcpy would free our compiled xlat! */
-
-			DEBUG_TRACE("xlat %s = [%s] => (len: %u) [%s]", vp->da->name, vp->xlat, len, buffer);
-
-			/* Convert the xlat'ed string to the appropriate type. */
-			if (ncc_pair_value_from_str(vp, buffer) < 0) {
+			if (dpc_xlat_pair_eval(vp, compiled, packet) < 0) {
 				return -1;
 			}
 		}
@@ -2748,6 +4390,24 @@ static void dpc_packet_list_init(TALLOC_CTX *ctx)
 		ERROR("Failed to create packet list");
 		exit(EXIT_FAILURE);
 	}
+
+	/* Receive timestamps are obtained through the receive ring. */
+	if (ECTX.timestamping && !ECTX.recv_batch) ECTX.recv_batch = 1;
+
+	if (dpc_packet_list_set_recv_batch(pl, ECTX.recv_batch) < 0) {
+		PERROR("Failed to enable batched reception");
+		exit(EXIT_FAILURE);
+	}
+
+	if (dpc_packet_list_set_send_batch(pl, ECTX.send_batch, dpc_packet_sent_deferred) < 0) {
+		PERROR("Failed to enable batched transmission");
+		exit(EXIT_FAILURE);
+	}
+
+	if (dpc_packet_list_set_timestamping(pl, ECTX.timestamping) < 0) {
+		PERROR("Failed to enable packet timestamping");
+		exit(EXIT_FAILURE);
+	}
 }
 
 /*
@@ -2825,6 +4485,29 @@ static struct option long_options[] = {
 	/* Long options with no short option equivalent. */
 	{ "retransmit",             required_argument, NULL, 1 },
 	{ "xlat-file",              required_argument, NULL, 1 },
+	{ "recv-batch",             required_argument, NULL, 1 },
+	{ "send-batch",             required_argument, NULL, 1 },
+	{ "timestamping",           required_argument, NULL, 1 },
+	{ "workers",                required_argument, NULL, 1 },
+	{ "ts-file",                required_argument, NULL, 1 },
+	{ "ts-format",              required_argument, NULL, 1 },
+	{ "ts-interval",            required_argument, NULL, 1 },
+	{ "pacing",                 required_argument, NULL, 1 },
+	{ "rate-profile",           required_argument, NULL, 1 },
+	{ "rate-profile-file",      required_argument, NULL, 1 },
+	{ "search",                 required_argument, NULL, 1 },
+	{ "search-step",            required_argument, NULL, 1 },
+	{ "sla-loss",               required_argument, NULL, 1 },
+	{ "sla-rtt",                required_argument, NULL, 1 },
+	{ "input-stream",           required_argument, NULL, 1 },
+	{ "responder",              required_argument, NULL, 1 },
+	{ "responder-latency",      required_argument, NULL, 1 },
+	{ "responder-jitter",       required_argument, NULL, 1 },
+	{ "responder-drop",         required_argument, NULL, 1 },
+	{ "bench",                  required_argument, NULL, 1 },
+	{ "bench-filter",           required_argument, NULL, 1 },
+	{ "population",             required_argument, NULL, 1 },
+	{ "lease-file",             required_argument, NULL, 1 },
 
 	/* Long options with short option equivalent. */
 	{ "dict-dir",               required_argument, NULL, 'D' },
@@ -2840,6 +4523,8 @@ static struct option long_options[] = {
 	{ "debug",                  no_argument, &with_debug_dev, 1 },
 	{ "template",               no_argument, &with_template, 1 },
 	{ "xlat",                   no_argument, &with_xlat, 1 },
+	{ "co-correct",             no_argument, &with_co_correct, 1 },
+	{ "population-release",     no_argument, &ECTX.population_release, 1 },
 
 	{ 0, 0, 0, 0 }
 };
@@ -2850,8 +4535,53 @@ typedef enum {
 	 */
 	LONGOPT_IDX_RETRANSMIT = 0,
 	LONGOPT_IDX_XLAT_FILE,
+	LONGOPT_IDX_RECV_BATCH,
+	LONGOPT_IDX_SEND_BATCH,
+	LONGOPT_IDX_TIMESTAMPING,
+	LONGOPT_IDX_WORKERS,
+	LONGOPT_IDX_TS_FILE,
+	LONGOPT_IDX_TS_FORMAT,
+	LONGOPT_IDX_TS_INTERVAL,
+	LONGOPT_IDX_PACING,
+	LONGOPT_IDX_RATE_PROFILE,
+	LONGOPT_IDX_RATE_PROFILE_FILE,
+	LONGOPT_IDX_SEARCH,
+	LONGOPT_IDX_SEARCH_STEP,
+	LONGOPT_IDX_SLA_LOSS,
+	LONGOPT_IDX_SLA_RTT,
+	LONGOPT_IDX_INPUT_STREAM,
+	LONGOPT_IDX_RESPONDER,
+	LONGOPT_IDX_RESPONDER_LATENCY,
+	LONGOPT_IDX_RESPONDER_JITTER,
+	LONGOPT_IDX_RESPONDER_DROP,
+	LONGOPT_IDX_BENCH,
+	LONGOPT_IDX_BENCH_FILTER,
+	LONGOPT_IDX_POPULATION,
+	LONGOPT_IDX_LEASE_FILE,
 } longopt_index_t;
 
+/*
+ *	Parse the rtt condition of the SLA checked by the saturation search: [<percentile>:]<max rtt (ms)>
+ */
+static bool dpc_sla_rtt_parse(char const *in)
+{
+	char const *p = strchr(in, ':');
+	char buf[32];
+	double percentile = ECTX.sla_rtt_percentile, rtt;
+
+	if (p) {
+		if ((size_t)(p - in) >= sizeof(buf)) return false;
+		strlcpy(buf, in, p - in + 1);
+		if (!ncc_str_to_float(&percentile, buf, false) || percentile <= 0 || percentile >= 100) return false;
+		in = p + 1;
+	}
+	if (!ncc_str_to_float(&rtt, in, false) || rtt <= 0) return false;
+
+	ECTX.sla_rtt_percentile = percentile;
+	ECTX.sla_rtt = rtt / 1000;
+	return true;
+}
+
 /*
  *	Process command line options and arguments.
  */
@@ -3025,6 +4755,163 @@ static void dpc_options_parse(int argc, char **argv)
 				}
 				break;
 
+			case LONGOPT_IDX_RECV_BATCH: // --recv-batch
+				if (!is_integer(optarg) || atoi(optarg) < 0 || atoi(optarg) > DPC_BATCH_MAX) {
+					ERROR("Invalid value for option --%s (expected: integer, max: %u)",
+					      long_options[opt_index].name, DPC_BATCH_MAX);
+					usage(1);
+				}
+				ECTX.recv_batch = atoi(optarg);
+				break;
+
+			case LONGOPT_IDX_SEND_BATCH: // --send-batch
+				if (!is_integer(optarg) || atoi(optarg) < 0 || atoi(optarg) > DPC_BATCH_MAX) {
+					ERROR("Invalid value for option --%s (expected: integer, max: %u)",
+					      long_options[opt_index].name, DPC_BATCH_MAX);
+					usage(1);
+				}
+				ECTX.send_batch = atoi(optarg);
+				break;
+
+			case LONGOPT_IDX_TIMESTAMPING: // --timestamping
+				if (strcmp(optarg, "software") == 0) {
+					ECTX.timestamping = DPC_TIMESTAMPING_SOFTWARE;
+				} else if (strcmp(optarg, "hardware") == 0) {
+					ECTX.timestamping = DPC_TIMESTAMPING_HARDWARE;
+				} else {
+					ERROR_LONGOPT_VALUE("software or hardware");
+				}
+				break;
+
+			case LONGOPT_IDX_WORKERS: // --workers
+				if (!is_integer(optarg)) ERROR_LONGOPT_VALUE("integer");
+				ECTX.num_workers = atoi(optarg);
+				break;
+
+			case LONGOPT_IDX_TS_FILE: // --ts-file
+				file_ts_out = optarg;
+				break;
+
+			case LONGOPT_IDX_TS_FORMAT: // --ts-format
+				if (strcmp(optarg, "csv") == 0) {
+					ECTX.ts_format = DPC_TS_FORMAT_CSV;
+				} else if (strcmp(optarg, "json") == 0) {
+					ECTX.ts_format = DPC_TS_FORMAT_JSON;
+				} else {
+					ERROR_LONGOPT_VALUE("csv or json");
+				}
+				break;
+
+			case LONGOPT_IDX_TS_INTERVAL: // --ts-interval
+				if (!ncc_str_to_float(&ECTX.ts_interval, optarg, false)) ERROR_LONGOPT_VALUE("positive floating point number");
+				if (ECTX.ts_interval < 0.01) ECTX.ts_interval = 0.01; /* Don't allow absurdly low values. */
+				break;
+
+			case LONGOPT_IDX_PACING: // --pacing
+				if (strcmp(optarg, "burst") == 0) {
+					ECTX.pacing = DPC_PACING_BURST;
+				} else if (strcmp(optarg, "even") == 0) {
+					ECTX.pacing = DPC_PACING_EVEN;
+				} else if (strcmp(optarg, "poisson") == 0) {
+					ECTX.pacing = DPC_PACING_POISSON;
+				} else {
+					ERROR_LONGOPT_VALUE("burst, even or poisson");
+				}
+				break;
+
+			case LONGOPT_IDX_RATE_PROFILE: // --rate-profile
+				rate_profile = dpc_rate_profile_parse(global_ctx, optarg);
+				if (!rate_profile) {
+					PERROR("Invalid value for option --%s", long_options[opt_index].name);
+					usage(1);
+				}
+				break;
+
+			case LONGOPT_IDX_RATE_PROFILE_FILE: // --rate-profile-file
+				rate_profile = dpc_rate_profile_load(global_ctx, optarg);
+				if (!rate_profile) {
+					PERROR("Failed to read rate profile");
+					exit(EXIT_FAILURE);
+				}
+				break;
+
+			case LONGOPT_IDX_SEARCH: // --search
+				if (!ncc_str_to_float(&ECTX.search_rate, optarg, false) || ECTX.search_rate < 1) {
+					ERROR_LONGOPT_VALUE("floating point number (at least 1)");
+				}
+				break;
+
+			case LONGOPT_IDX_SEARCH_STEP: // --search-step
+				if (!ncc_str_to_float(&ECTX.search_step, optarg, false)) ERROR_LONGOPT_VALUE("positive floating point number");
+				if (ECTX.search_step < 1) ECTX.search_step = 1; /* We need enough time to measure something. */
+				break;
+
+			case LONGOPT_IDX_SLA_LOSS: // --sla-loss
+				if (!ncc_str_to_float(&ECTX.sla_loss, optarg, false) || ECTX.sla_loss > 100) {
+					ERROR_LONGOPT_VALUE("percentage (0 to 100)");
+				}
+				break;
+
+			case LONGOPT_IDX_SLA_RTT: // --sla-rtt
+				if (!dpc_sla_rtt_parse(optarg)) {
+					ERROR_LONGOPT_VALUE("[<percentile>:]<max rtt (ms)>, with a percentile strictly between 0 and 100");
+				}
+				break;
+
+			case LONGOPT_IDX_INPUT_STREAM: // --input-stream
+				if (!is_integer(optarg) || atoi(optarg) <= 0) ERROR_LONGOPT_VALUE("positive integer");
+				ECTX.input_stream = atoi(optarg);
+				break;
+
+			case LONGOPT_IDX_RESPONDER: // --responder
+				if (ncc_host_addr_resolve(&responder_ep, optarg) != 0) {
+					PERROR("Failed to parse responder address");
+					ERROR_LONGOPT_VALUE("<ipaddr>[:<port>]");
+				}
+				with_responder = true;
+				break;
+
+			case LONGOPT_IDX_RESPONDER_LATENCY: // --responder-latency
+				if (!ncc_str_to_float(&ECTX.responder_latency, optarg, false)) ERROR_LONGOPT_VALUE("floating point number");
+				ECTX.responder_latency /= 1000;
+				break;
+
+			case LONGOPT_IDX_RESPONDER_JITTER: // --responder-jitter
+				if (!ncc_str_to_float(&ECTX.responder_jitter, optarg, false)) ERROR_LONGOPT_VALUE("floating point number");
+				ECTX.responder_jitter /= 1000;
+				break;
+
+			case LONGOPT_IDX_RESPONDER_DROP: // --responder-drop
+				if (!ncc_str_to_float(&ECTX.responder_drop, optarg, false) || ECTX.responder_drop > 100) {
+					ERROR_LONGOPT_VALUE("percentage (0 to 100)");
+				}
+				break;
+
+			case LONGOPT_IDX_BENCH: // --bench
+				if (strcmp(optarg, "text") == 0) {
+					bench_format = DPC_BENCH_FORMAT_TEXT;
+				} else if (strcmp(optarg, "csv") == 0) {
+					bench_format = DPC_BENCH_FORMAT_CSV;
+				} else if (strcmp(optarg, "json") == 0) {
+					bench_format = DPC_BENCH_FORMAT_JSON;
+				} else {
+					ERROR_LONGOPT_VALUE("text, csv or json");
+				}
+				break;
+
+			case LONGOPT_IDX_BENCH_FILTER: // --bench-filter
+				bench_filter = optarg;
+				break;
+
+			case LONGOPT_IDX_POPULATION: // --population
+				if (!is_integer(optarg) || atoi(optarg) <= 0) ERROR_LONGOPT_VALUE("positive integer");
+				ECTX.population = atoi(optarg);
+				break;
+
+			case LONGOPT_IDX_LEASE_FILE: // --lease-file
+				lease_file = optarg;
+				break;
+
 			default:
 				printf("Error: Unexpected 'option index': %d\n", opt_index);
 				usage(1);
@@ -3069,49 +4956,992 @@ static void dpc_options_parse(int argc, char **argv)
 	if (ECTX.session_max_active == 0) ECTX.session_max_active = 1;
 	ECTX.ftd_request_timeout = ncc_float_to_fr_time(ECTX.request_timeout);
 	ECTX.ftd_progress_interval = ncc_float_to_fr_time(ECTX.progress_interval);
+	ECTX.ftd_ts_interval = ncc_float_to_fr_time(ECTX.ts_interval);
 
 	/* Xlat is automatically enabled in template mode. */
 	if (with_template) with_xlat = 1;
 
 	if (!with_template && ECTX.input_num_use == 0) ECTX.input_num_use = 1;
 
+	if (rate_profile && ECTX.rate_limit) {
+		ERROR("Options -r and --rate-profile cannot be used together");
+		exit(EXIT_FAILURE);
+	}
+
+	if (ECTX.search_rate) {
+		if (rate_profile || ECTX.rate_limit) {
+			ERROR("Option --search cannot be used with a rate limit (options -r and --rate-profile)");
+			exit(EXIT_FAILURE);
+		}
+		if (ECTX.num_workers > 1) {
+			ERROR("Option --search cannot be used with workers");
+			exit(EXIT_FAILURE);
+		}
+
+		/* The search drives a rate schedule, which it restarts with a new rate at each step. */
+		MEM(rate_profile = talloc_zero(global_ctx, dpc_rate_profile_t));
+		dpc_rate_profile_restart(rate_profile, 0, ECTX.search_rate, 0);
+	}
+
+	if (ECTX.input_stream) {
+		if (with_template) {
+			ERROR("Option --input-stream cannot be used in template mode");
+			exit(EXIT_FAILURE);
+		}
+		if (ECTX.num_workers > 1) {
+			ERROR("Option --input-stream cannot be used with workers");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (bench_format && ECTX.num_workers > 1) {
+		ERROR("Option --bench cannot be used with workers");
+		exit(EXIT_FAILURE);
+	}
+
+	if (ECTX.population) {
+		if (with_template || ECTX.input_stream) {
+			ERROR("Option --population cannot be used in template mode, or with --input-stream");
+			exit(EXIT_FAILURE);
+		}
+		if (packet_code != FR_CODE_UNDEFINED || (workflow_code && workflow_code != DPC_WORKFLOW_DORA)) {
+			ERROR("Option --population requires the dora workflow");
+			exit(EXIT_FAILURE);
+		}
+		/* Simulated clients acquire their lease through a DORA. */
+		workflow_code = DPC_WORKFLOW_DORA;
+	}
+	if (ECTX.population && with_co_correct) {
+		/* Clients start sessions when they are due, not according to the rate limit schedule. */
+		ERROR("Option --co-correct cannot be used with --population");
+		exit(EXIT_FAILURE);
+	}
+	if (ECTX.population_release && !ECTX.population) {
+		ERROR("Option --population-release requires --population");
+		exit(EXIT_FAILURE);
+	}
+	if (lease_file && !ECTX.population) {
+		ERROR("Option --lease-file requires --population");
+		exit(EXIT_FAILURE);
+	}
+	if (lease_file && ECTX.num_workers > 1) {
+		/* Workers would each overwrite the file with their own share of leases. */
+		ERROR("Option --lease-file cannot be used with workers");
+		exit(EXIT_FAILURE);
+	}
+
+	if (ECTX.pacing && !dpc_with_rate_limit()) {
+		ERROR("Pacing requires a rate limit (option -r, --rate-profile or --search)");
+		exit(EXIT_FAILURE);
+	}
+
+	if (ECTX.num_workers > 1) {
+		if (ECTX.num_workers > DPC_WORKERS_MAX) {
+			ERROR("Number of workers cannot exceed %u", DPC_WORKERS_MAX);
+			exit(EXIT_FAILURE);
+		}
+#ifdef HAVE_LIBPCAP
+		if (iface) {
+			ERROR("Workers cannot share a pcap raw socket (option -i)");
+			exit(EXIT_FAILURE);
+		}
+#endif
+	}
+
 	retr_breakdown = talloc_zero_array(global_ctx, uint32_t, ECTX.retransmit_max);
 }
 
 /*
- *	Signal handler.
+ *	Provide a group of sockets (one for each worker) for a given source IP address and port, if we don't have one
+ *	already.
  */
-static void dpc_signal(int sig)
+static int dpc_worker_socket_provide(fr_ipaddr_t *src_ipaddr, uint16_t src_port)
 {
-	if (!signal_done) {
-		/* Allow ongoing sessions to be finished gracefully. */
-		INFO("Received signal [%d] (%s): will not start any new session.", sig, strsignal(sig));
-		INFO("Send another signal if you wish to terminate immediately.");
-		signal_done = true;
-		start_sessions_flag = false;
-	} else {
-		/* ... unless someone's getting really impatient. */
-		INFO("Received signal [%d] (%s): Aborting.", sig, strsignal(sig));
-		dpc_end();
+	uint32_t i;
+	dpc_worker_sockets_t *this;
+
+	for (i = 0; i < num_worker_sockets; i++) {
+		this = &worker_sockets[i];
+		if (this->src.port == src_port && fr_ipaddr_cmp(&this->src.ipaddr, src_ipaddr) == 0) return 0;
 	}
+
+	TALLOC_REALLOC_ZERO(global_ctx, worker_sockets, dpc_worker_sockets_t, num_worker_sockets, num_worker_sockets + 1);
+	this = &worker_sockets[num_worker_sockets];
+
+	this->src.ipaddr = *src_ipaddr;
+	this->src.port = src_port;
+	MEM(this->fds = talloc_zero_array(global_ctx, int, ECTX.num_workers));
+
+	if (dpc_socket_group_open(src_ipaddr, src_port, ECTX.num_workers, this->fds) < 0) return -1;
+
+	num_worker_sockets ++;
+	return 0;
 }
 
 /*
- *	The end.
+ *	Pre-allocate a socket for a given source IP address and port.
+ *	With workers, this is a group of sockets (which will be shared out once the workers are started).
  */
-static void dpc_end(void)
+static int dpc_socket_preallocate(fr_ipaddr_t *src_ipaddr, uint16_t src_port)
 {
-	/* Job end timestamp. */
-	fte_job_end = fr_time();
+	if (ECTX.num_workers > 1 && !worker_stats) return dpc_worker_socket_provide(src_ipaddr, src_port);
 
-	/* If we're producing progress statistics, do it one last time. */
-	if (ECTX.ftd_progress_interval) dpc_progress_stats_fprint(stdout, true);
+	return dpc_socket_provide(pl, src_ipaddr, src_port);
+}
 
-	/* Statistics report. */
-	dpc_stats_fprint(stdout);
-	dpc_tr_stats_fprint(stdout);
+/*
+ *	Start the worker processes.
+ *	Each one does a share of the job, with its own event list, packet list, shard of the xid space, sockets and
+ *	sessions. This process merely reports statistics for all of them (periodically, and when they're all done).
+ *	This function only returns in the worker processes.
+ */
+static void dpc_workers_start(void)
+{
+	uint32_t i;
+	size_t size = ECTX.num_workers * sizeof(dpc_worker_stats_t);
 
-	/* Free memory. */
+	worker_stats_shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (worker_stats_shm == MAP_FAILED) {
+		ERROR("Failed to allocate memory shared with workers: %s", fr_syserror(errno));
+		exit(EXIT_FAILURE);
+	}
+	memset(worker_stats_shm, 0, size);
+	for (i = 0; i < ECTX.num_workers; i++) {
+		worker_stats_shm[i].start_sessions_flag = true;
+	}
+
+	fflush(NULL); /* Workers must not inherit pending output. */
+
+	for (i = 0; i < ECTX.num_workers; i++) {
+		pid_t pid = fork();
+
+		if (pid < 0) {
+			ERROR("Failed to start worker process: %s", fr_syserror(errno));
+			dpc_signal(SIGTERM); /* Stop the workers we've already started. */
+			exit(EXIT_FAILURE);
+		}
+
+		if (pid == 0) {
+			/* This is the worker. */
+			worker_id = i;
+			worker_stats = &worker_stats_shm[i];
+			worker_stats->pid = getpid();
+			return;
+		}
+
+		worker_stats_shm[i].pid = pid;
+		num_workers_running ++;
+	}
+
+	DEBUG("Started %u workers", ECTX.num_workers);
+
+	/*
+	 *	We keep the sockets opened until all the workers are done: closing one would alter the group,
+	 *	and replies could be delivered to the wrong worker.
+	 */
+	ECTX.pr_stat_per_input = 0; /* Inputs are handled by the workers. */
+	dpc_workers_wait();
+
+	dpc_workers_stats_merge();
+	dpc_end();
+}
+
+/*
+ *	Get the share of a worker from a given total, which is split evenly between all the workers.
+ */
+static uint32_t dpc_worker_share(uint32_t total)
+{
+	return (total / ECTX.num_workers) + (worker_id < (total % ECTX.num_workers) ? 1 : 0);
+}
+
+/*
+ *	Initialize a worker process: get our own resources, and figure out our share of the job.
+ */
+static void dpc_worker_init(void)
+{
+	uint32_t i, j;
+	ncc_list_item_t *list_item;
+
+	dpc_event_list_init(global_ctx);
+	dpc_packet_list_init(global_ctx);
+
+	if (dpc_packet_list_set_xid_shard(pl, worker_id, ECTX.num_workers) < 0) {
+		PERROR("Failed to set worker xid shard");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Workers share xlat files (mapped read-only), but each uses its own lines. */
+	ncc_xlat_file_shard(worker_id, ECTX.num_workers);
+
+	/*
+	 *	Take our own socket from each group, and close those of the other workers.
+	 */
+	for (i = 0; i < num_worker_sockets; i++) {
+		dpc_worker_sockets_t *this = &worker_sockets[i];
+
+		for (j = 0; j < ECTX.num_workers; j++) {
+			if (j != worker_id) close(this->fds[j]);
+		}
+
+		if (dpc_socket_adopt(pl, this->fds[worker_id], &this->src.ipaddr, this->src.port) < 0) {
+			PERROR("Failed to add worker socket");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/*
+	 *	Split limits between workers.
+	 */
+	ECTX.rate_limit /= ECTX.num_workers;
+	if (rate_profile) dpc_rate_profile_scale(rate_profile, 1.0 / ECTX.num_workers);
+	ECTX.session_max_active = (ECTX.session_max_active + ECTX.num_workers - 1) / ECTX.num_workers;
+
+	if (ECTX.session_max_num) {
+		ECTX.session_max_num = dpc_worker_share(ECTX.session_max_num);
+		if (!ECTX.session_max_num) start_sessions_flag = false; /* Nothing for us to do. */
+	}
+
+	/*
+	 *	In template mode, input items are shared by all workers (with split limits).
+	 *	Likewise in population mode, in which each worker has its own share of the simulated clients.
+	 *	Otherwise, they are partitioned.
+	 */
+	list_item = vps_list_in.head;
+	i = 0;
+	while (list_item) {
+		dpc_input_t *input = (dpc_input_t *)list_item;
+		list_item = list_item->next;
+
+		if (with_template) {
+			input->rate_limit /= ECTX.num_workers;
+			if (input->rate_profile) dpc_rate_profile_scale(input->rate_profile, 1.0 / ECTX.num_workers);
+			if (input->max_use) {
+				input->max_use = dpc_worker_share(input->max_use);
+				if (!input->max_use) input->done = true;
+			}
+		} else if (!ECTX.population && (i % ECTX.num_workers) != worker_id) {
+			NCC_LIST_DRAW(input);
+			talloc_free(input);
+		}
+		i++;
+	}
+
+	/*
+	 *	Statistics are published periodically for the parent, using the progress statistics timer.
+	 *	Time-series statistics are written by the parent, so they must be published at least as often.
+	 */
+	if (!ECTX.ftd_progress_interval || ECTX.ftd_progress_interval > DPC_WORKER_PUBLISH_INTERVAL) {
+		ECTX.ftd_progress_interval = DPC_WORKER_PUBLISH_INTERVAL;
+	}
+	if (fp_ts) {
+		if (ECTX.ftd_progress_interval > ECTX.ftd_ts_interval) ECTX.ftd_progress_interval = ECTX.ftd_ts_interval;
+		fclose(fp_ts);
+		fp_ts = NULL;
+	}
+}
+
+/*
+ *	Create the simulated clients (population mode).
+ *	With workers, each one handles its own share of them, with distinct hardware addresses.
+ */
+static void dpc_population_init(void)
+{
+	uint32_t first = 0, num = ECTX.population;
+
+	if (worker_stats) {
+		uint32_t rest = ECTX.population % ECTX.num_workers;
+
+		num = dpc_worker_share(ECTX.population);
+		first = worker_id * (ECTX.population / ECTX.num_workers) + (worker_id < rest ? worker_id : rest);
+	}
+
+	if (!num) { /* Nothing for us to do. */
+		start_sessions_flag = false;
+		return;
+	}
+
+	population = dpc_population_create(global_ctx, first, num);
+	if (!population) {
+		PERROR("Failed to create population of %u clients", num);
+		exit(EXIT_FAILURE);
+	}
+	DEBUG("Created population of %u clients (first: %u)", num, first);
+
+	/* Start from the leases obtained by a previous run, if we have them. */
+	if (lease_file && access(lease_file, F_OK) == 0) {
+		int ret = dpc_population_load(population, lease_file);
+
+		if (ret < 0) {
+			PERROR("Failed to load leases");
+			exit(EXIT_FAILURE);
+		}
+		INFO("Loaded %d leases from file \"%s\"", ret, lease_file);
+	}
+}
+
+/*
+ *	Save the leases held by simulated clients (population mode), so that a later run can renew or release them.
+ */
+static void dpc_population_save_leases(void)
+{
+	int ret = dpc_population_save(population, lease_file);
+
+	if (ret < 0) {
+		PERROR("Failed to save leases");
+		return;
+	}
+	INFO("Saved %d leases to file \"%s\"", ret, lease_file);
+}
+
+/*
+ *	Publish the statistics of this worker, so the parent process can merge them with those of the other workers.
+ */
+static void dpc_worker_stats_publish(void)
+{
+	uint32_t i, num;
+
+	worker_stats->session_num = session_num;
+	worker_stats->session_num_in = session_num_in;
+	worker_stats->session_num_active = session_num_active;
+	worker_stats->start_sessions_flag = start_sessions_flag;
+
+	worker_stats->fte_sessions_ini_start = fte_sessions_ini_start;
+	worker_stats->fte_sessions_ini_end = fte_sessions_ini_end;
+	worker_stats->fte_last_session_in = fte_last_session_in;
+
+	dpc_population_stats_sync();
+	worker_stats->stats = stat_ctx;
+	worker_stats->stats.dyn_tr_stats = NULL;
+
+	num = stat_ctx.num_transaction_type;
+	if (num > DPC_WORKER_TR_TYPES_MAX) {
+		/* Only the first ones can be merged by the parent process. Let the user know, once. */
+		if (!worker_tr_types_truncated) {
+			WARN("Too many transaction types (max: %u), statistics of the others are not reported",
+			     DPC_WORKER_TR_TYPES_MAX);
+			worker_tr_types_truncated = true;
+		}
+		num = DPC_WORKER_TR_TYPES_MAX;
+	}
+
+	for (i = 0; i < num; i++) {
+		worker_stats->dyn_tr_stats[i] = stat_ctx.dyn_tr_stats[i];
+		strlcpy(worker_stats->dyn_tr_names[i], arr_tr_types->strings[i], DPC_WORKER_TR_NAME_LEN);
+	}
+	worker_stats->stats.num_transaction_type = num;
+
+	for (i = 0; i < ECTX.retransmit_max && i < DPC_WORKER_RETR_MAX; i++) {
+		worker_stats->retr_breakdown[i] = retr_breakdown[i];
+	}
+}
+
+/*
+ *	Merge the statistics published by all the workers into our own (which are otherwise unused in this process).
+ *	Note: the statistics of a worker may be read while it is updating them. This is not an issue for progress
+ *	statistics. Final statistics are merged once all the workers are done.
+ */
+static void dpc_workers_stats_merge(void)
+{
+	uint32_t i, j, k;
+
+	session_num = session_num_in = session_num_active = 0;
+	start_sessions_flag = false;
+	fte_sessions_ini_start = fte_sessions_ini_end = fte_last_session_in = 0;
+
+	memset(stat_ctx.tr_stats, 0, sizeof(stat_ctx.tr_stats));
+	memset(stat_ctx.dpc_stat, 0, sizeof(stat_ctx.dpc_stat));
+	stat_ctx.num_packet_recv_unexpected = 0;
+	memset(&stat_ctx.pacing, 0, sizeof(stat_ctx.pacing));
+	memset(&stat_ctx.loop, 0, sizeof(stat_ctx.loop));
+	memset(&stat_ctx.population, 0, sizeof(stat_ctx.population));
+	if (stat_ctx.dyn_tr_stats) {
+		memset(stat_ctx.dyn_tr_stats, 0, stat_ctx.num_transaction_type * sizeof(dpc_transaction_stats_t));
+	}
+	if (retr_breakdown) memset(retr_breakdown, 0, ECTX.retransmit_max * sizeof(uint32_t));
+
+	for (i = 0; i < ECTX.num_workers; i++) {
+		dpc_worker_stats_t *ws = &worker_stats_shm[i];
+
+		session_num += ws->session_num;
+		session_num_in += ws->session_num_in;
+		session_num_active += ws->session_num_active;
+		if (ws->start_sessions_flag) start_sessions_flag = true;
+
+		if (ws->fte_sessions_ini_start
+		    && (!fte_sessions_ini_start || ws->fte_sessions_ini_start < fte_sessions_ini_start)) {
+			fte_sessions_ini_start = ws->fte_sessions_ini_start;
+		}
+		if (ws->fte_sessions_ini_end > fte_sessions_ini_end) fte_sessions_ini_end = ws->fte_sessions_ini_end;
+		if (ws->fte_last_session_in > fte_last_session_in) fte_last_session_in = ws->fte_last_session_in;
+
+		for (j = 0; j < DPC_TR_MAX; j++) {
+			dpc_tr_stats_merge(&stat_ctx.tr_stats[j], &ws->stats.tr_stats[j]);
+		}
+
+		for (j = 0; j < ws->stats.num_transaction_type && j < DPC_WORKER_TR_TYPES_MAX; j++) {
+			k = ncc_str_array_index(global_ctx, &arr_tr_types, ws->dyn_tr_names[j]);
+
+			if (k >= stat_ctx.num_transaction_type) {
+				TALLOC_REALLOC_ZERO(global_ctx, stat_ctx.dyn_tr_stats,
+				                    dpc_transaction_stats_t, stat_ctx.num_transaction_type, k + 1);
+				stat_ctx.num_transaction_type = k + 1;
+			}
+			dpc_tr_stats_merge(&stat_ctx.dyn_tr_stats[k], &ws->dyn_tr_stats[j]);
+		}
+
+		for (j = 0; j <= DPC_STAT_MAX_TYPE; j++) {
+			for (k = 0; k <= DHCP_MAX_MESSAGE_TYPE; k++) {
+				stat_ctx.dpc_stat[j][k] += ws->stats.dpc_stat[j][k];
+			}
+		}
+		stat_ctx.num_packet_recv_unexpected += ws->stats.num_packet_recv_unexpected;
+		dpc_pacing_stats_merge(&stat_ctx.pacing, &ws->stats.pacing);
+		dpc_loop_stats_merge(&stat_ctx.loop, &ws->stats.loop);
+		dpc_population_stats_merge(&stat_ctx.population, &ws->stats.population);
+
+		for (j = 0; j < ECTX.retransmit_max && j < DPC_WORKER_RETR_MAX; j++) {
+			retr_breakdown[j] += ws->retr_breakdown[j];
+		}
+	}
+}
+
+/*
+ *	Wait for all the workers to be done. Meanwhile, produce progress statistics for all of them.
+ */
+static void dpc_workers_wait(void)
+{
+	while (num_workers_running > 0) {
+		int status;
+		pid_t pid = waitpid(-1, &status, WNOHANG);
+
+		if (pid > 0) {
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+				WARN("Worker (pid: %d) terminated abnormally", pid);
+			}
+			num_workers_running --;
+			continue;
+		}
+		if (pid < 0 && errno != EINTR) {
+			ERROR("Failed to wait for workers: %s", fr_syserror(errno));
+			break;
+		}
+
+		if (ECTX.ftd_progress_interval) {
+			fr_time_t now = fr_time();
+
+			if (!fte_progress_stat) fte_progress_stat = now + ECTX.ftd_progress_interval;
+
+			if (now >= fte_progress_stat) {
+				dpc_workers_stats_merge();
+				dpc_progress_stats_fprint(stdout, false);
+
+				do {
+					fte_progress_stat += ECTX.ftd_progress_interval;
+				} while (fte_progress_stat < now);
+			}
+		}
+
+		if (fp_ts) {
+			fr_time_t now = fr_time();
+
+			if (!fte_ts_stat) fte_ts_stat = fte_job_start + ECTX.ftd_ts_interval;
+
+			if (now >= fte_ts_stat) {
+				dpc_workers_stats_merge();
+				dpc_ts_record(now, false);
+
+				do {
+					fte_ts_stat += ECTX.ftd_ts_interval;
+				} while (fte_ts_stat < now);
+			}
+		}
+
+		usleep(DPC_WORKER_WAIT_INTERVAL);
+	}
+}
+
+/*
+ *	Run as a loopback responder: answer requests, until interrupted. Then report and exit.
+ */
+static void NEVER_RETURNS dpc_responder_main(void)
+{
+	char ep_buf[NCC_ENDPOINT_STRLEN] = "";
+
+	responder = dpc_responder_create(global_ctx, &responder_ep,
+	                                 ECTX.responder_latency, ECTX.responder_jitter, ECTX.responder_drop);
+	if (!responder) {
+		PERROR("Failed to start responder");
+		exit(EXIT_FAILURE);
+	}
+
+	if ( (fr_set_signal(SIGHUP, dpc_signal) < 0) ||
+	     (fr_set_signal(SIGINT, dpc_signal) < 0) ||
+	     (fr_set_signal(SIGTERM, dpc_signal) < 0))
+	{
+		PERROR("Failed installing signal handler");
+		exit(EXIT_FAILURE);
+	}
+
+	INFO("Responder listening on %s", ncc_endpoint_sprint(ep_buf, &responder_ep));
+
+	if (dpc_responder_run(responder) < 0) {
+		PERROR("Responder failed");
+		exit(EXIT_FAILURE);
+	}
+
+	dpc_responder_stats_fprint(stdout, responder);
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ *	State of a benchmark case (what is needed to run its operation).
+ */
+typedef struct dpc_bench_case {
+	dpc_session_ctx_t session;
+	dpc_input_t *input;
+	DHCP_PACKET *packet;         //!< Packet worked on (request, or reply).
+	uint8_t *data;               //!< Canned reply data.
+
+	dpc_packet_list_t *pl;
+	int sockfd;
+	DHCP_PACKET **requests;      //!< Outstanding requests in the packet list.
+	DHCP_PACKET *replies;        //!< A reply to each outstanding request.
+	uint32_t num;
+	uint32_t cur;
+
+	VALUE_PAIR *vp;              //!< Holds the value expanded.
+	dpc_xlat_compiled_t *compiled;
+	uint32_t xlat_set;           //!< Set of xlat frames for xlat evaluation.
+} dpc_bench_case_t;
+
+/*
+ *	Xlat functions benchmarked, with an expression using each, and an attribute which can hold the value.
+ */
+static struct {
+	char const *name;
+	char const *fmt;
+	fr_dict_attr_t const **da;
+} dpc_bench_xlats[] = {
+	{ "num.range",     "%{num.range:1-1000000}",                                &attr_dhcp_transaction_id },
+	{ "num.rand",      "%{num.rand:1-1000000}",                                 &attr_dhcp_transaction_id },
+	{ "ipaddr.range",  "%{ipaddr.range:10.0.0.1-10.255.255.254}",               &attr_dhcp_your_ip_address },
+	{ "ipaddr.rand",   "%{ipaddr.rand:10.0.0.1-10.255.255.254}",                &attr_dhcp_your_ip_address },
+	{ "ethaddr.range", "%{ethaddr.range:50:41:4e:44:00:00-50:41:4e:44:ff:ff}",  &attr_dhcp_client_hardware_address },
+	{ "ethaddr.rand",  "%{ethaddr.rand:50:41:4e:44:00:00-50:41:4e:44:ff:ff}",   &attr_dhcp_client_hardware_address },
+	{ "randstr",       "%{randstr:cccccccc}",                                   &attr_request_label },
+	{ "file",          "%{file:0}",                                             &attr_request_label },
+	{ "file.rand",     "%{file.rand:0}",                                        &attr_request_label },
+
+	{ NULL }
+};
+
+/*
+ *	Input items used to build requests.
+ */
+#define DPC_BENCH_INPUT_COMMON \
+	"Packet-Src-IP-Address = 127.0.0.1\n" \
+	"Packet-Dst-IP-Address = 127.0.0.1\n" \
+	"DHCP-Message-Type = DHCP-Discover\n"
+
+static char const *dpc_bench_input_static =
+	DPC_BENCH_INPUT_COMMON
+	"DHCP-Client-Hardware-Address = 50:41:4e:44:41:00\n"
+	"DHCP-Hostname = \"bench.whimsical.org\"\n";
+
+static char const *dpc_bench_input_xlat =
+	DPC_BENCH_INPUT_COMMON
+	"DHCP-Client-Hardware-Address = \"%{ethaddr.range:50:41:4e:44:00:00-50:41:4e:44:ff:ff}\"\n"
+	"DHCP-Hostname = \"host-%{num.range:1-1000000}.whimsical.org\"\n";
+
+static void dpc_bench_request_init(TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+
+	dpc_request_init(ctx, &bc->session, bc->input);
+}
+
+static void dpc_bench_dhcp_encode(TALLOC_CTX *ctx, void *uctx)
+{
+	DHCP_PACKET *packet = ((dpc_bench_case_t *)uctx)->packet;
+
+	dpc_dhcp_encode(packet);
+
+	/* Hand over encoded data, so it is freed with the operation (and the next one has to encode again). */
+	talloc_steal(ctx, packet->data);
+	packet->data = NULL;
+	packet->data_len = 0;
+}
+
+static void dpc_bench_dhcp_decode(TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+	DHCP_PACKET *reply;
+
+	MEM(reply = fr_radius_alloc(ctx, false));
+	reply->data = bc->data; /* Not ours: not freed with the reply. */
+	reply->data_len = DEFAULT_PACKET_SIZE;
+
+	fr_dhcpv4_packet_decode(reply);
+}
+
+static void dpc_bench_reply_info_extract(UNUSED TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+	dpc_reply_info_t reply_info;
+
+	dpc_reply_info_extract(&reply_info, bc->packet);
+}
+
+static void dpc_bench_id_alloc_free(UNUSED TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+
+	bc->packet->id = DPC_PACKET_ID_UNASSIGNED;
+	dpc_packet_list_id_alloc(bc->pl, bc->sockfd, &bc->packet, false);
+	dpc_packet_list_id_free(bc->pl, bc->packet);
+}
+
+static void dpc_bench_find_byreply(UNUSED TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+
+	dpc_packet_list_find_byreply(bc->pl, &bc->replies[bc->cur]);
+	if (++bc->cur == bc->num) bc->cur = 0;
+}
+
+static void dpc_bench_xlat_eval(TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+	DHCP_PACKET xlat_ctx = { 0 };
+	VALUE_PAIR *vp;
+
+	/* Expand into a pair of the operation context, so what its value allocates is accounted for (and freed). */
+	MEM(vp = fr_pair_afrom_da(ctx, bc->vp->da));
+
+	ncc_xlat_set_num(bc->xlat_set);
+	dpc_xlat_pair_eval(vp, bc->compiled, &xlat_ctx);
+}
+
+static void dpc_bench_tr_stats_update(UNUSED TALLOC_CTX *ctx, void *uctx)
+{
+	dpc_bench_case_t *bc = uctx;
+
+	/* Spread rtt values (from 100 us to 100 ms), so they don't all end up in the same histogram bin. */
+	fr_time_delta_t rtt = (100 + (fr_time_delta_t)(bc->cur * 7919) % 100000) * 1000; /* ns */
+	bc->cur ++;
+
+	dpc_tr_stats_update(DPC_TR_DISCOVER_OFFER, rtt, rtt, 0);
+}
+
+/*
+ *	Parse an input item (as if read from a file) for benchmarking.
+ */
+static dpc_input_t *dpc_bench_input_parse(TALLOC_CTX *ctx, char const *text, uint32_t id)
+{
+	FILE *fp;
+	dpc_input_t *input;
+	bool file_done = false;
+
+	fp = fmemopen((void *)text, strlen(text), "r");
+	if (!fp) {
+		ERROR("Failed to open benchmark input: %s", fr_syserror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	input = dpc_input_read(ctx, fp, "benchmark input", &file_done);
+	fclose(fp);
+
+	if (!input) {
+		ERROR("No benchmark input read");
+		exit(EXIT_FAILURE);
+	}
+
+	input->id = id;
+	if (!dpc_parse_input(input)) exit(EXIT_FAILURE);
+
+	return input;
+}
+
+/*
+ *	Build canned reply data: an Offer as a server would send it, padded to the minimum DHCP packet size.
+ */
+static uint8_t *dpc_bench_reply_data(TALLOC_CTX *ctx)
+{
+	uint8_t *data, *p;
+	uint8_t const chaddr[6] = { 0x50, 0x41, 0x4e, 0x44, 0x41, 0x00 };
+	uint8_t const options[] = {
+		53, 1, FR_DHCP_OFFER,           /* Message Type */
+		54, 4, 10, 0, 0, 254,           /* Server Identifier */
+		51, 4, 0, 0, 0x0e, 0x10,        /* Lease Time (3600) */
+		1, 4, 255, 255, 255, 0,         /* Subnet Mask */
+		3, 4, 10, 0, 0, 254,            /* Router */
+		6, 8, 10, 0, 0, 53, 10, 0, 1, 53, /* Domain Name Server */
+		255                             /* End */
+	};
+
+	MEM(data = talloc_zero_array(ctx, uint8_t, DEFAULT_PACKET_SIZE));
+
+	data[0] = 2; /* op: BOOTREPLY */
+	data[1] = 1; /* htype: Ethernet */
+	data[2] = 6; /* hlen */
+	data[4] = 0x00; data[5] = 0x00; data[6] = 0x00; data[7] = 0x2a; /* xid */
+	data[16] = 10; data[17] = 0; data[18] = 0; data[19] = 1; /* yiaddr */
+	memcpy(data + 28, chaddr, sizeof(chaddr));
+
+	p = data + 236;
+	*p++ = 0x63; *p++ = 0x82; *p++ = 0x53; *p++ = 0x63; /* Magic cookie */
+	memcpy(p, options, sizeof(options));
+
+	return data;
+}
+
+/*
+ *	Benchmark packet list operations, with a given number of outstanding requests.
+ */
+static void dpc_bench_packet_list(dpc_bench_t *bench, TALLOC_CTX *ctx, uint32_t num)
+{
+	dpc_bench_case_t bc = { .num = num };
+	fr_ipaddr_t ipaddr = { .af = AF_INET, .prefix = 32, .addr.v4.s_addr = htonl(INADDR_LOOPBACK) };
+	char name[64];
+	uint32_t i;
+
+	bc.pl = dpc_packet_list_create(ctx, 0);
+	if (!bc.pl) {
+		PERROR("Failed to create packet list");
+		exit(EXIT_FAILURE);
+	}
+
+	bc.sockfd = dpc_socket_provide(bc.pl, &ipaddr, 0);
+	if (bc.sockfd < 0) {
+		PERROR("Failed to provide a socket");
+		exit(EXIT_FAILURE);
+	}
+
+	MEM(bc.requests = talloc_zero_array(ctx, DHCP_PACKET *, num));
+	MEM(bc.replies = talloc_zero_array(ctx, DHCP_PACKET, num));
+	MEM(bc.packet = talloc_zero(ctx, DHCP_PACKET));
+	bc.packet->dst_ipaddr = ipaddr;
+	bc.packet->dst_port = DHCP_PORT_SERVER;
+
+	for (i = 0; i < num; i++) {
+		DHCP_PACKET *request;
+
+		MEM(request = talloc_zero(bc.requests, DHCP_PACKET));
+		request->id = DPC_PACKET_ID_UNASSIGNED;
+		request->dst_ipaddr = ipaddr;
+		request->dst_port = DHCP_PORT_SERVER;
+		bc.requests[i] = request;
+
+		if (!dpc_packet_list_id_alloc(bc.pl, bc.sockfd, &bc.requests[i], false)) {
+			PERROR("Failed to allocate packet id");
+			exit(EXIT_FAILURE);
+		}
+
+		bc.replies[i].sockfd = bc.sockfd;
+		bc.replies[i].id = request->id;
+		bc.replies[i].src_ipaddr = ipaddr;
+		bc.replies[i].src_port = DHCP_PORT_SERVER;
+		bc.replies[i].dst_ipaddr = ipaddr;
+	}
+
+	snprintf(name, sizeof(name), "packet_list.id_alloc_free/%u", num);
+	dpc_bench_run(bench, name, dpc_bench_id_alloc_free, &bc);
+
+	snprintf(name, sizeof(name), "packet_list.find_byreply/%u", num);
+	dpc_bench_run(bench, name, dpc_bench_find_byreply, &bc);
+
+	close(bc.sockfd);
+	dpc_packet_list_free(bc.pl);
+}
+
+/*
+ *	Benchmark an xlat function, through the xlat engine, and with its native generator (if there is one).
+ */
+static void dpc_bench_xlat(dpc_bench_t *bench, TALLOC_CTX *ctx, int i)
+{
+	dpc_bench_case_t bc = { .xlat_set = ncc_xlat_frame_set_alloc() };
+	dpc_xlat_compiled_t *compiled;
+	DHCP_PACKET xlat_ctx = { 0 };
+	char name[64];
+	char *value;
+	fr_dict_attr_t const *da = *dpc_bench_xlats[i].da;
+
+	MEM(bc.vp = fr_pair_afrom_da(ctx, da));
+	bc.vp->xlat = talloc_typed_strdup(bc.vp, dpc_bench_xlats[i].fmt);
+
+	MEM(compiled = talloc_zero(ctx, dpc_xlat_compiled_t));
+	value = talloc_typed_strdup(ctx, dpc_bench_xlats[i].fmt); /* modified by xlat_tokenize */
+	if (xlat_tokenize(ctx, &compiled->xlat, value, NULL) < 0) {
+		PERROR("Failed to parse xlat expression \"%s\"", dpc_bench_xlats[i].fmt);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Some functions need something we may not have (e.g. a xlat file). */
+	ncc_xlat_set_num(bc.xlat_set);
+	if (dpc_xlat_pair_eval(bc.vp, compiled, &xlat_ctx) < 0) {
+		DEBUG("Skipping benchmark of xlat function %s: %s", dpc_bench_xlats[i].name, fr_strerror());
+		return;
+	}
+
+	bc.compiled = compiled;
+	snprintf(name, sizeof(name), "xlat.%s", dpc_bench_xlats[i].name);
+	dpc_bench_run(bench, name, dpc_bench_xlat_eval, &bc);
+
+	MEM(compiled = talloc_zero(ctx, dpc_xlat_compiled_t));
+	compiled->gen = ncc_xlat_gen_compile(compiled, dpc_bench_xlats[i].fmt, da->type);
+	if (!compiled->gen) return;
+
+	bc.compiled = compiled;
+	bc.xlat_set = ncc_xlat_frame_set_alloc(); /* Do not share the state of the xlat engine frame. */
+	snprintf(name, sizeof(name), "xlat.%s.native", dpc_bench_xlats[i].name);
+	dpc_bench_run(bench, name, dpc_bench_xlat_eval, &bc);
+}
+
+/*
+ *	Run microbenchmarks of the per-packet hot path. Then exit.
+ */
+static void NEVER_RETURNS dpc_bench_main(void)
+{
+	TALLOC_CTX *ctx;
+	dpc_bench_t *bench;
+	dpc_bench_case_t bc = { 0 };
+	uint32_t const pl_nums[] = { 1000, 10000, 100000, 0 };
+	size_t i;
+
+	MEM(ctx = talloc_new(global_ctx));
+	bench = dpc_bench_create(ctx, stdout, bench_format, bench_filter);
+
+	/* Inputs are not used to send anything: let the system pick the source port of their socket. */
+	client_ep.port = 0;
+	with_xlat = 1;
+
+	/*
+	 *	Building a request (with, and without xlat expansions).
+	 */
+	bc.input = dpc_bench_input_parse(ctx, dpc_bench_input_static, 0);
+	dpc_session_set_transport(&bc.session, bc.input);
+	dpc_bench_run(bench, "request_init", dpc_bench_request_init, &bc);
+
+	bc.input = dpc_bench_input_parse(ctx, dpc_bench_input_xlat, 1);
+	dpc_session_set_transport(&bc.session, bc.input);
+	dpc_bench_run(bench, "request_init.xlat", dpc_bench_request_init, &bc);
+
+	/*
+	 *	Encoding a request.
+	 */
+	bc.packet = dpc_request_init(ctx, &bc.session, bc.input);
+	if (!bc.packet) {
+		PERROR("Failed to build request");
+		exit(EXIT_FAILURE);
+	}
+	bc.packet->id = 42;
+	dpc_bench_run(bench, "dhcp_encode", dpc_bench_dhcp_encode, &bc);
+
+	/*
+	 *	Handling a reply: full decoding (only done to print packets), and the information we really need.
+	 */
+	bc.data = dpc_bench_reply_data(ctx);
+	dpc_bench_run(bench, "dhcp_decode", dpc_bench_dhcp_decode, &bc);
+
+	MEM(bc.packet = fr_radius_alloc(ctx, false));
+	bc.packet->data = bc.data;
+	bc.packet->data_len = DEFAULT_PACKET_SIZE;
+	dpc_bench_run(bench, "reply_info_extract", dpc_bench_reply_info_extract, &bc);
+
+	/*
+	 *	Packet list operations, with an increasing number of outstanding requests.
+	 */
+	for (i = 0; pl_nums[i]; i++) {
+		dpc_bench_packet_list(bench, ctx, pl_nums[i]);
+	}
+
+	/*
+	 *	Xlat functions (each one has its own sets of xlat frames).
+	 */
+	for (i = 0; dpc_bench_xlats[i].name; i++) {
+		dpc_bench_xlat(bench, ctx, i);
+	}
+
+	/*
+	 *	Updating transaction statistics.
+	 */
+	bc.cur = 0;
+	dpc_bench_run(bench, "tr_stats_update", dpc_bench_tr_stats_update, &bc);
+
+	if (!dpc_bench_num_run(bench)) WARN("No benchmark matching \"%s\"", bench_filter);
+
+	talloc_free(ctx);
+	exit(EXIT_SUCCESS);
+}
+
+/*
+ *	Signal handler.
+ */
+static void dpc_signal(int sig)
+{
+	if (responder) {
+		INFO("Received signal [%d] (%s): stopping responder.", sig, strsignal(sig));
+		dpc_responder_stop(responder);
+		return;
+	}
+
+	if (worker_stats_shm && !worker_stats) {
+		/*
+		 *	Parent of the workers: they do the job, so let them know.
+		 *	(Unless this is an interrupt from the terminal, which they get as well.)
+		 */
+		uint32_t i;
+
+		if (sig == SIGINT) return;
+		for (i = 0; i < ECTX.num_workers; i++) {
+			if (worker_stats_shm[i].pid > 0) kill(worker_stats_shm[i].pid, sig);
+		}
+		return;
+	}
+
+	if (!signal_done) {
+		/* Allow ongoing sessions to be finished gracefully. */
+		INFO("Received signal [%d] (%s): will not start any new session.", sig, strsignal(sig));
+		INFO("Send another signal if you wish to terminate immediately.");
+		signal_done = true;
+		start_sessions_flag = false;
+	} else {
+		/* ... unless someone's getting really impatient. */
+		INFO("Received signal [%d] (%s): Aborting.", sig, strsignal(sig));
+		dpc_end();
+	}
+}
+
+/*
+ *	The end.
+ */
+static void dpc_end(void)
+{
+	/* Job end timestamp. */
+	fte_job_end = fr_time();
+
+	/* A worker process just hands over its final statistics to the parent, which reports for all workers. */
+	if (worker_stats) {
+		dpc_worker_stats_publish();
+		exit(EXIT_SUCCESS);
+	}
+
+	/* If we're producing progress statistics, do it one last time. */
+	if (ECTX.ftd_progress_interval) dpc_progress_stats_fprint(stdout, true);
+
+	/* Likewise for time-series statistics (last interval may be shorter). */
+	if (fp_ts) {
+		if (fte_job_end > ts_prev.fte) dpc_ts_record(fte_job_end, false);
+		fclose(fp_ts);
+		fp_ts = NULL;
+	}
+
+	/* Statistics report. */
+	dpc_stats_fprint(stdout);
+	dpc_tr_stats_fprint(stdout);
+	if (ECTX.search_rate) dpc_search_fprint(stdout);
+
+	/* Free memory. */
 	fr_dhcpv4_global_free();
 	// not working !? stuff allocated when calling fr_dhcpv4_global_init is not freed.
 	fr_dict_autofree(dpc_dict_autoload);
@@ -3182,8 +6012,17 @@ int main(int argc, char **argv)
 
 	dpc_dict_init(global_ctx);
 
-	dpc_event_list_init(global_ctx);
-	dpc_packet_list_init(global_ctx);
+	/* In responder mode, we only answer requests (until interrupted). */
+	if (with_responder) dpc_responder_main();
+
+	/*
+	 *	With workers, each worker process has its own event list and packet list (which are initialized once
+	 *	the workers are started). The sockets they share are allocated now, in this process.
+	 */
+	if (ECTX.num_workers <= 1) {
+		dpc_event_list_init(global_ctx);
+		dpc_packet_list_init(global_ctx);
+	}
 
 	/*
 	 *	Allocate sockets for gateways.
@@ -3192,7 +6031,7 @@ int main(int argc, char **argv)
 		for (i = 0; i < gateway_list->num; i++) {
 			ncc_endpoint_t *this = &gateway_list->eps[i];
 
-			if (dpc_socket_provide(pl, &this->ipaddr, this->port) < 0) {
+			if (dpc_socket_preallocate(&this->ipaddr, this->port) < 0) {
 				char src_ipaddr_buf[FR_IPADDR_STRLEN] = "";
 				PERROR("Failed to provide a suitable socket for gateway \"%s:%u\"",
 				       fr_inet_ntop(src_ipaddr_buf, sizeof(src_ipaddr_buf), &this->ipaddr) ? src_ipaddr_buf : "(undef)",
@@ -3213,6 +6052,9 @@ int main(int argc, char **argv)
 
 	ncc_xlat_register();
 
+	/* In benchmark mode, we only measure the cost of operations involved in handling packets. */
+	if (bench_format) dpc_bench_main();
+
 	/*
 	 *	Set signal handler.
 	 */
@@ -3239,11 +6081,20 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 
+	/*
+	 *	A renewing client sets ciaddr to its leased address. Unless the request is relayed (option -g), the server
+	 *	sends its reply to that address, which is not ours: renewals would all time out (RFC 2131, section 4.1).
+	 */
+	if (ECTX.population && !gateway_list) {
+		WARN("No gateway (option -g): replies to renewals will be sent to the leased addresses, and will not reach us");
+	}
+
 	/*
 	 *	If packet trace level is unspecified, figure out something automatically.
 	 */
 	if (packet_trace_lvl == -1) {
-		if (ECTX.session_max_num == 1 || (!with_template && vps_list_in.size == 1 && ECTX.input_num_use == 1)) {
+		if (ECTX.session_max_num == 1
+		    || (!with_template && !ECTX.population && vps_list_in.size == 1 && ECTX.input_num_use == 1)) {
 			/* Only one request: full packet print. */
 			packet_trace_lvl = 2;
 		} else if (ECTX.session_max_active == 1) {
@@ -3275,16 +6126,37 @@ int main(int argc, char **argv)
 
 	fte_job_start = fr_time(); /* Job start timestamp. */
 
+	dpc_ts_init();
+
+	/*
+	 *	Start the workers. This only returns in the worker processes.
+	 */
+	if (ECTX.num_workers > 1) {
+		dpc_workers_start();
+		dpc_worker_init();
+	}
+
+	/* Create the simulated clients (with workers, each one has its own share of them). */
+	if (ECTX.population) dpc_population_init();
+
 	if (ECTX.duration_start_max) { /* Set timestamp limit for starting new input sessions. */
 		ECTX.fte_start_max = ncc_float_to_fr_time(ECTX.duration_start_max) + fte_job_start;
 	}
 
-	/* Arm a timer to produce periodic statistics. */
+	/* Arm timers to produce periodic statistics. */
 	dpc_event_add_progress_stats();
+	dpc_event_add_ts_stats();
+
+	/* Start the saturation search, if requested. */
+	dpc_search_init();
 
 	/* Execute the main processing loop. */
 	dpc_main_loop();
 
+	/* Simulated clients may give up their lease before we leave. */
+	if (population && ECTX.population_release) dpc_population_release_all();
+	if (population && lease_file) dpc_population_save_leases();
+
 	/* This is the end. */
 	dpc_end();
 }
@@ -29,9 +29,17 @@ struct dpc_context {
 	double progress_interval;        //<! Time interval between periodic progress statistics.
 	fr_time_delta_t ftd_progress_interval;
 
+	double ts_interval;              //<! Time interval between time-series statistics records.
+	fr_time_delta_t ftd_ts_interval;
+	int ts_format;                   //<! Format of time-series statistics records (CSV or JSON lines).
+
 	double request_timeout;          //<! Max time waiting for a reply to a request we've sent.
 	fr_time_delta_t ftd_request_timeout;
 	uint32_t retransmit_max;         //<! Max retransmissions of a request not replied to (not including first packet).
+	uint32_t recv_batch;             //<! Max number of datagrams received with a single system call (0: no batching).
+	uint32_t send_batch;             //<! Max number of packets sent with a single system call (0: no batching).
+	int timestamping;                //<! Packet timestamping mode (SO_TIMESTAMPING): 0 = none, 1 = software, 2 = hardware.
+	uint32_t num_workers;            //<! Number of worker processes (0 or 1: no workers, the job is done by this process).
 
 	uint32_t base_xid;               //<! Base value for xid generated in DHCP packets.
 
@@ -39,10 +47,25 @@ struct dpc_context {
 	fr_time_t fte_start_max;         //<! Time after which no input session is allowed to be started.
 
 	uint32_t input_num_use;          //<! Max number of uses of each input item (default: unlimited in template mode, 1 otherwise).
+	uint32_t input_stream;           //<! Stream input items, parsing at most this many ahead (0: all input is loaded at startup).
 	uint32_t session_max_num;        //<! Limit number of sessions initialized from input items.
 	uint32_t session_max_active;     //<! Max number of session packets sent concurrently (default: 1).
 
 	float rate_limit;                //<! Limit rate/s of sessions initialized from input (all transactions combined).
+	int pacing;                      //<! How sessions are spaced out to enforce the rate limit (dpc_pacing_t).
+
+	double search_rate;              //<! Initial rate of the saturation search (0: no search).
+	double search_step;              //<! How long (s) each rate is held during the saturation search.
+	double sla_loss;                 //<! Max percentage of lost packets allowed by the SLA.
+	double sla_rtt_percentile;       //<! Percentile of rtt checked by the SLA.
+	double sla_rtt;                  //<! Max rtt (s) at that percentile allowed by the SLA (0: not checked).
+
+	double responder_latency;        //<! Delay (s) before the loopback responder sends a reply.
+	double responder_jitter;         //<! Max random variation (s) of this delay.
+	double responder_drop;           //<! Percentage of requests the loopback responder does not reply to.
+
+	uint32_t population;             //<! Number of simulated clients, which acquire and renew leases (0: none).
+	int population_release;          //<! Release the leases held by simulated clients on shutdown.
 
 	int pr_stat_per_input;           //<! Print per-input progress statistics (if multiple input).
 	int pr_stat_per_input_max;       //<! Max number of input items shown in progress statistics.
@@ -69,7 +92,17 @@ struct dpc_context {
 
 extern int dpc_debug_lvl;
 extern fr_dict_attr_t const *attr_encoded_data;
+extern fr_dict_attr_t const *attr_authorized_server;
 extern fr_dict_attr_t const *attr_dhcp_message_type;
+extern fr_dict_attr_t const *attr_dhcp_hop_count;
+extern fr_dict_attr_t const *attr_dhcp_transaction_id;
+extern fr_dict_attr_t const *attr_dhcp_number_of_seconds;
+extern fr_dict_attr_t const *attr_dhcp_flags;
+extern fr_dict_attr_t const *attr_dhcp_client_ip_address;
+extern fr_dict_attr_t const *attr_dhcp_your_ip_address;
+extern fr_dict_attr_t const *attr_dhcp_server_ip_address;
+extern fr_dict_attr_t const *attr_dhcp_gateway_ip_address;
+extern fr_dict_attr_t const *attr_dhcp_client_hardware_address;
 
 extern fr_dict_t *dict_dhcpv4; /* Defined in src/protocols/dhcpv4/base.c */
 
@@ -160,9 +193,19 @@ extern fr_dict_t *dict_dhcpv4; /* Defined in src/protocols/dhcpv4/base.c */
 #define DHCP_PORT_CLIENT  68
 #define DHCP_PORT_RELAY   67
 
+/*
+ *	Each session context is a talloc pool, from which its packets (and their data and value pairs) are allocated.
+ *	This is enough for a full DORA workflow (up to 5 packets), beyond that memory is allocated from the heap.
+ */
+#define DPC_SESSION_POOL_SIZE        (5 * (sizeof(DHCP_PACKET) + 1500) + 4096)
+#define DPC_SESSION_POOL_NUM_OBJECTS (128)
+
+#define DPC_BATCH_MAX  1024 /* Max number of datagrams received or sent with a single system call (UIO_MAXIOV). */
+
 #define DHCP_MAX_MESSAGE_TYPE  (16)
 // DHCP_MAX_MESSAGE_TYPE is defined in protocols/dhcpv4/base.c, we need our own.
 extern char const *dpc_message_types[DHCP_MAX_MESSAGE_TYPE];
+#define LG_PAD_STATS       20 /* Width of statistics labels. */
 #define is_dhcp_message(_x) ((_x > 0) && (_x < DHCP_MAX_MESSAGE_TYPE))
 
 #define is_dhcp_reply_expected(_x) (_x == FR_DHCP_DISCOVER || _x == FR_DHCP_REQUEST || _x == FR_DHCP_INFORM \
@@ -264,6 +307,44 @@ typedef enum {
 } dpc_templ_var_t;
 
 
+/*
+ *	Rate profile: target rate of sessions which changes over time.
+ *	Rate is interpolated linearly between two points, and the rate of the last point holds afterwards.
+ */
+typedef struct dpc_rate_point {
+	double time;              //!< Time (s) from the start of the schedule.
+	double rate;              //!< Target rate (/s) at that time.
+	double due;               //!< Number of sessions due at that time (integral of rate since start).
+} dpc_rate_point_t;
+
+typedef struct dpc_rate_profile {
+	uint32_t num;             //!< Number of points.
+	dpc_rate_point_t *points;
+} dpc_rate_profile_t;
+
+/* Session pacing modes (with a rate limit). */
+typedef enum {
+	DPC_PACING_BURST = 0,      //!< Start as many sessions as allowed so far, whenever we can.
+	DPC_PACING_EVEN,           //!< Start sessions at evenly spaced times.
+	DPC_PACING_POISSON         //!< Start sessions at random times (exponentially distributed intervals).
+} dpc_pacing_t;
+
+/*
+ *	Latency histogram (log-linear, HDR-style), with a fixed memory footprint.
+ *	Values are recorded in microseconds. Each power of two range is split into DPC_HISTO_SUB_BUCKETS linear
+ *	sub-buckets, which gives a relative precision of 1/DPC_HISTO_SUB_BUCKETS (about 1.6 %).
+ *	Values beyond the highest trackable (2^DPC_HISTO_MAX_BITS us, i.e. more than an hour) are counted in the
+ *	last bucket.
+ */
+#define DPC_HISTO_SUB_BITS       6
+#define DPC_HISTO_SUB_BUCKETS    (1 << DPC_HISTO_SUB_BITS)
+#define DPC_HISTO_MAX_BITS       32
+#define DPC_HISTO_NUM_BUCKETS    ((DPC_HISTO_MAX_BITS - DPC_HISTO_SUB_BITS + 1) * DPC_HISTO_SUB_BUCKETS)
+
+typedef struct dpc_histogram {
+	uint32_t buckets[DPC_HISTO_NUM_BUCKETS];
+} dpc_histogram_t;
+
 /*
  *	Holds statistics for a given transaction type.
  */
@@ -272,8 +353,86 @@ typedef struct dpc_transaction_stats {
 	fr_time_delta_t rtt_cumul; //!< Cumulated rtt (request to reply time)
 	fr_time_delta_t rtt_min;   //!< Lowest rtt
 	fr_time_delta_t rtt_max;   //!< Highest rtt (timeout are not included)
+	dpc_histogram_t rtt_histo; //!< Distribution of rtt (for percentiles)
+
+	fr_time_delta_t rtt_co_cumul; //!< Cumulated corrected rtt (from intended start, cf. coordinated omission)
+	fr_time_delta_t rtt_co_min;   //!< Lowest corrected rtt
+	fr_time_delta_t rtt_co_max;   //!< Highest corrected rtt
+	dpc_histogram_t rtt_co_histo; //!< Distribution of corrected rtt
+
+	uint32_t       num_wire;        //!< Number of completed transactions for which wire rtt is known
+	fr_time_delta_t rtt_wire_cumul; //!< Cumulated wire rtt (from kernel or NIC timestamps)
+	fr_time_delta_t rtt_wire_min;   //!< Lowest wire rtt
+	fr_time_delta_t rtt_wire_max;   //!< Highest wire rtt
 } dpc_transaction_stats_t;
 
+/*
+ *	Statistics on the pacing of sessions.
+ */
+typedef struct dpc_pacing_stats {
+	uint32_t num;                 //!< Number of sessions started by the pacing scheduler
+	fr_time_delta_t late_cumul;   //!< Cumulated lateness (actual start compared to scheduled start)
+	fr_time_delta_t late_max;     //!< Highest lateness
+	dpc_histogram_t late_histo;   //!< Distribution of lateness
+
+	uint32_t num_gap;             //!< Number of intervals between two sessions started
+	double gap_cumul;             //!< Cumulated intervals (s)
+	double gap_sq_cumul;          //!< Cumulated squared intervals (for standard deviation, i.e. jitter)
+	fr_time_delta_t gap_min;      //!< Lowest interval
+	fr_time_delta_t gap_max;      //!< Highest interval
+} dpc_pacing_stats_t;
+
+/*
+ *	Phases of the main loop, in which time spent is measured.
+ */
+typedef enum {
+	DPC_LOOP_START = 0,            //<! Starting new sessions
+	DPC_LOOP_RECV,                 //<! Receiving and handling replies (not including time waiting for them)
+	DPC_LOOP_TIMERS,               //<! Handling timer events (request timeouts, statistics, ...)
+	DPC_LOOP_IDLE,                 //<! Blocked waiting for packets, or until the next event is due
+	DPC_LOOP_PHASE_MAX
+} dpc_loop_phase_t;
+
+#define DPC_LOOP_SAMPLE_RATE  16   /* Time one iteration of the main loop out of that many. */
+#define DPC_LOOP_BUSY_WARN    95.0 /* Above that (%), the client is deemed to be saturated. */
+
+/*
+ *	Main loop statistics, to figure out where time goes, and whether the client itself is the bottleneck.
+ */
+typedef struct dpc_loop_stats {
+	uint64_t num_iter;            //!< Number of iterations.
+	uint64_t num_sampled;         //!< Number of iterations which have been timed.
+	fr_time_delta_t phase[DPC_LOOP_PHASE_MAX]; //!< Time spent in each phase (only in iterations timed).
+	uint64_t num_started;         //!< Number of sessions started.
+	uint32_t num_send_full;       //!< Packets which could not be sent because the socket send buffer was full.
+} dpc_loop_stats_t;
+
+/*
+ *	States of a simulated client (population mode).
+ */
+typedef enum {
+	DPC_CLIENT_INIT = 0,           //<! No lease, not trying to get one yet
+	DPC_CLIENT_SELECTING,          //<! Acquiring a lease (DORA)
+	DPC_CLIENT_BOUND,              //<! Holding a lease, until T1
+	DPC_CLIENT_RENEWING,           //<! Renewing the lease (unicast Request to the server which granted it)
+	DPC_CLIENT_REBINDING,          //<! Rebinding the lease (Request to any server), after T2
+	DPC_CLIENT_STATE_MAX
+} dpc_client_state_t;
+
+/*
+ *	Simulated clients statistics.
+ */
+typedef struct dpc_population_stats {
+	uint32_t num;                 //!< Number of clients.
+	uint32_t num_state[DPC_CLIENT_STATE_MAX]; //!< Number of clients in each state.
+	uint32_t num_acquired;        //!< Leases acquired (DORA).
+	uint32_t num_renewed;         //!< Leases renewed.
+	uint32_t num_rebound;         //!< Leases rebound.
+	uint32_t num_expired;         //!< Leases which expired before they could be renewed.
+	uint32_t num_nak;             //!< Leases lost (Nak received).
+	uint32_t num_released;        //!< Leases released.
+} dpc_population_stats_t;
+
 /*
  *	All statistics.
  */
@@ -292,12 +451,109 @@ typedef struct dpc_statistics {
 
 	uint32_t num_packet_recv_unexpected;
 
+	dpc_pacing_stats_t pacing;
+
+	dpc_loop_stats_t loop;
+
+	dpc_population_stats_t population;
+
 } dpc_statistics_t;
 
 
+/*
+ *	Time-series statistics export formats.
+ */
+typedef enum {
+	DPC_TS_FORMAT_CSV = 0,
+	DPC_TS_FORMAT_JSON         //!< JSON lines (one object per record).
+} dpc_ts_format_t;
+
+/*
+ *	State of statistics at the end of previous time-series interval, from which the interval values are obtained.
+ */
+typedef struct dpc_ts_snapshot {
+	fr_time_t fte;                //!< When the snapshot was taken.
+	uint32_t session_num_in;      //!< Number of sessions initialized from input.
+	uint32_t dpc_stat[DPC_STAT_MAX_TYPE + 1][DHCP_MAX_MESSAGE_TYPE + 1];
+	uint32_t rtt_num;             //!< Number of completed transactions (all unitary transactions).
+	dpc_histogram_t rtt_histo;    //!< Distribution of rtt (all unitary transactions).
+} dpc_ts_snapshot_t;
+
+/*
+ *	Saturation search: a rate which has been held for a while, and how the server coped with it.
+ */
+typedef struct dpc_search_step {
+	double rate;                  //!< Target rate (/s).
+	double rate_achieved;         //!< Measured rate of sessions started (/s).
+	uint32_t sent;                //!< Number of packets sent (including retransmissions).
+	double loss;                  //!< Percentage of packets lost.
+	uint32_t rtt_num;             //!< Number of completed transactions.
+	fr_time_delta_t rtt_median;   //!< Median rtt.
+	fr_time_delta_t rtt_sla;      //!< Rtt at the percentile checked by the SLA.
+	bool pass;                    //!< Whether this rate is sustained within the SLA.
+} dpc_search_step_t;
+
+#define DPC_SEARCH_WARMUP        0.25  /* Part of each step which is not measured, so things can settle. */
+#define DPC_SEARCH_ACHIEVED_MIN  0.95  /* A rate is not sustained if we cannot start sessions at least that fast. */
+#define DPC_SEARCH_PRECISION     0.05  /* Search is over when the knee point is known within that relative margin. */
+#define DPC_SEARCH_STEPS_MAX     32
+
+/*
+ *	Statistics published by a worker process, in memory shared with the parent process.
+ *	Dynamically named transaction types are copied along with their names, so the parent can merge them.
+ */
+#define DPC_WORKER_TR_TYPES_MAX  64
+#define DPC_WORKER_TR_NAME_LEN   128
+#define DPC_WORKERS_MAX          64
+#define DPC_WORKER_RETR_MAX      10  /* We don't print a retransmissions breakdown beyond that. */
+#define DPC_WORKER_PUBLISH_INTERVAL (100 * 1000 * 1000) /* Workers publish their statistics every 100 ms. */
+#define DPC_WORKER_WAIT_INTERVAL    (10 * 1000)         /* Parent checks on the workers every 10 ms (in us). */
+
+typedef struct dpc_worker_stats {
+	pid_t pid;                  //!< Pid of the worker process.
+
+	uint32_t session_num;       //!< Worker session counters.
+	uint32_t session_num_in;
+	uint32_t session_num_active;
+	bool start_sessions_flag;   //!< Whether the worker is still starting new sessions.
+
+	fr_time_t fte_sessions_ini_start; //!< Worker timestamps of starting sessions.
+	fr_time_t fte_sessions_ini_end;
+	fr_time_t fte_last_session_in;
+
+	dpc_statistics_t stats;     //!< Worker statistics (except dyn_tr_stats which cannot be shared as is).
+	dpc_transaction_stats_t dyn_tr_stats[DPC_WORKER_TR_TYPES_MAX];
+	char dyn_tr_names[DPC_WORKER_TR_TYPES_MAX][DPC_WORKER_TR_NAME_LEN];
+
+	uint32_t retr_breakdown[DPC_WORKER_RETR_MAX];
+} dpc_worker_stats_t;
+
+/*
+ *	Group of sockets bound to the same source IP address and port, one for each worker process.
+ */
+typedef struct dpc_worker_sockets {
+	ncc_endpoint_t src;         //!< Src IP address and port.
+	int *fds;                   //!< Socket of each worker.
+} dpc_worker_sockets_t;
+
+
 typedef struct dpc_input dpc_input_t;
 typedef struct dpc_session_ctx dpc_session_ctx_t;
 
+/*
+ *	Information extracted from a reply, without decoding it entirely.
+ */
+typedef struct dpc_reply_info {
+	uint8_t code;            //!< Message type (option 53).
+	uint32_t xid;            //!< Transaction ID.
+	uint32_t yiaddr;         //!< Field yiaddr (network byte order).
+	uint8_t chaddr[6];       //!< Field chaddr (Ethernet hardware address).
+	uint32_t server_id;      //!< Option 54 Server Identifier (network byte order), 0 if not provided.
+	uint32_t lease_time;     //!< Option 51 IP Address Lease Time (seconds), 0 if not provided.
+	uint32_t t1;             //!< Option 58 Renewal (T1) Time Value (seconds), 0 if not provided.
+	uint32_t t2;             //!< Option 59 Rebinding (T2) Time Value (seconds), 0 if not provided.
+} dpc_reply_info_t;
+
 /*
  *	Pre-parsed input information.
  */
@@ -328,12 +584,14 @@ struct dpc_input {
 	VALUE_PAIR *vps;          //!< List of input value pairs read.
 
 	bool do_xlat;             //<! If the input contain vp's of type VT_XLAT and we handle xlat expansion.
+	uint32_t xlat_set;        //!< Set of xlat frames used to expand this input (shared with its copies).
 
 	double start_delay;       //!< Delay after which this input can be used to start sessions.
 	fr_time_t fte_start;      //!< Timestamp of first use.
 	fr_time_t fte_end;        //!< Timestamp of last use once input is done.
 
 	double rate_limit;        //<! Limit rate/s of sessions initialized from this input.
+	dpc_rate_profile_t *rate_profile; //<! Or a rate schedule, for sessions initialized from this input.
 
 	uint32_t max_use;         //<! Maximum number of times this input can be used.
 	double max_duration;      //!< Maximum duration of starting sessions with this input (relative to input start use).
@@ -342,16 +600,25 @@ struct dpc_input {
 	char *request_label;      //<! Request custom label.
 
 	dpc_input_ext_t ext;      //!< Input pre-parsed information.
+
+	struct dpc_templ *templ;  //!< Compiled packet template (template mode).
+	bool templ_done;          //!< Whether we've tried compiling a template from this input.
 };
 
 /*
  *	Session context.
  */
 struct dpc_session_ctx {
+	/* Generic chaining (list of sessions with an armed request timeout) */
+	ncc_list_t *list;         //!< The list to which this entry belongs (NULL for an unchained entry).
+	ncc_list_item_t *prev;
+	ncc_list_item_t *next;
+
 	uint32_t id;              //!< Id of session (0 for the first one).
 
 	dpc_input_t *input;       //!< Input data.
 	fr_time_t fte_start;      //<! Session start timestamp.
+	fr_time_t fte_intended;   //!< When the session should have been started, according to the rate limit schedule.
 
 	ncc_endpoint_t *gateway;  //!< If using a gateway as source endpoint.
 	ncc_endpoint_t src;       //!< Src IP address and port.
@@ -359,15 +626,24 @@ struct dpc_session_ctx {
 
 	DHCP_PACKET *request;
 	DHCP_PACKET *reply;
+	dpc_reply_info_t reply_info; //!< Information extracted from the reply.
 
 	uint32_t retransmit;      //!< Number of times we've retransmitted this request.
 	fr_time_t fte_init;       //!< When the packet was (first) initialized. Not altered when retransmitting.
 	fr_time_delta_t ftd_rtt;  //!< Request to reply rtt (round trip time).
+	fr_time_delta_t ftd_rtt_wire; //!< Request to reply rtt from kernel or NIC timestamps (0 if unknown).
+	uint32_t tx_key;          //!< Key of the last request sent, used to retrieve its transmit timestamp.
+	bool with_tx_key;         //!< Whether tx_key is set.
 
 	uint32_t num_send;        //<! Number of requests sent (not including retransmissions).
+	bool xid_reuse;           //!< Whether the next request reuses the xid of the previous one (DORA Request).
 
 	dpc_state_t state;
 	bool reply_expected;      //!< Whether a reply is expected or not.
 
-	fr_event_timer_t const *event; //<! Armed timer event (if any).
+	fr_time_t fte_timeout;    //!< When the armed request timeout expires (if session is in the timeout list).
+
+	uint32_t client;          //!< Simulated client on behalf of which this session is handled (population mode).
+
+	dpc_session_ctx_t *next_free; //!< Next in the free list of session contexts (when not in use).
 };
@@ -1,7 +1,7 @@
 TARGET		:= dhcperfcli
 SOURCES		:= dhcperfcli.c
 SOURCES		+= ncc_util.c ncc_xlat_core.c ncc_xlat_func.c
-SOURCES		+= dpc_packet_list.c dpc_util.c dpc_xlat.c
+SOURCES		+= dpc_packet_list.c dpc_util.c dpc_xlat.c dpc_templ.c dpc_responder.c dpc_bench.c dpc_population.c dpc_lease_store.c
 
 # Using FreeRADIUS libraries:
 # - libfreeradius-util
@@ -11,4 +11,4 @@ SOURCES		+= dpc_packet_list.c dpc_util.c dpc_xlat.c
 TGT_PREREQS	:= libfreeradius-util.a libfreeradius-dhcpv4.a
 TGT_PREREQS	+= libfreeradius-unlang.a libfreeradius-server.a
 
-TGT_LDLIBS	:= $(LIBS)
+TGT_LDLIBS	:= $(LIBS) -lm
@@ -0,0 +1,127 @@
+/**
+ * @file dpc_bench.c
+ * @brief Microbenchmark harness.
+ *
+ * Each operation is run repeatedly, for long enough to get a stable measure, and we report its average cost
+ * (ns/op) and how many talloc blocks it leaves in its context (blocks/op, i.e. what it builds, not counting
+ * temporary allocations it frees itself). Results are printed as a table, or in a machine readable format (CSV, or
+ * JSON lines), so that they can be compared between builds.
+ */
+
+#include "dhcperfcli.h"
+#include "ncc_util.h"
+#include "dpc_bench.h"
+
+
+#define DPC_BENCH_MIN_TIME   0.5       /* Min duration (s) of the measured run of an operation. */
+#define DPC_BENCH_MAX_OPS    (1 << 30) /* Max number of operations in a run. */
+
+struct dpc_bench {
+	FILE *fp;
+	dpc_bench_format_t format;
+	char const *filter;        //!< Only run benchmarks whose name contain this (NULL: all).
+	uint32_t num_run;          //!< Number of benchmarks run.
+};
+
+
+/*
+ *	Allocate a benchmark context, and print the header of results (if any).
+ */
+dpc_bench_t *dpc_bench_create(TALLOC_CTX *ctx, FILE *fp, dpc_bench_format_t format, char const *filter)
+{
+	dpc_bench_t *bench;
+
+	MEM(bench = talloc_zero(ctx, dpc_bench_t));
+	bench->fp = fp;
+	bench->format = format;
+	bench->filter = filter;
+
+	switch (format) {
+	case DPC_BENCH_FORMAT_TEXT:
+		fprintf(fp, "%-44s %12s %12s %12s\n", "Benchmark", "ops", "ns/op", "blocks/op");
+		break;
+
+	case DPC_BENCH_FORMAT_CSV:
+		fprintf(fp, "name,ops,ns_per_op,blocks_per_op\n");
+		break;
+
+	case DPC_BENCH_FORMAT_JSON:
+		break;
+	}
+
+	return bench;
+}
+
+/*
+ *	Run an operation repeatedly, and report its cost.
+ *	A first run (not measured) warms up caches and lazily initialized state, and tells us how many blocks an
+ *	operation leaves in its context (what it allocates elsewhere, or frees itself, is not seen). Then runs are
+ *	repeated with more operations, until one lasts long enough to be measured.
+ */
+void dpc_bench_run(dpc_bench_t *bench, char const *name, dpc_bench_op_t op, void *uctx)
+{
+	TALLOC_CTX *ctx;
+	uint64_t i, num_ops = 1;
+	size_t num_blocks;
+	fr_time_delta_t ftd_elapsed;
+	fr_time_t fte_start;
+	double elapsed, ns_per_op;
+
+	if (bench->filter && !strstr(name, bench->filter)) return;
+
+	MEM(ctx = talloc_new(bench));
+
+	op(ctx, uctx);
+	num_blocks = talloc_total_blocks(ctx) - 1; /* Not counting the context itself. */
+	talloc_free_children(ctx);
+
+	while (1) {
+		fte_start = fr_time();
+		for (i = 0; i < num_ops; i++) {
+			op(ctx, uctx);
+			talloc_free_children(ctx);
+		}
+		ftd_elapsed = fr_time() - fte_start;
+		elapsed = ncc_fr_time_to_float(ftd_elapsed);
+
+		if (elapsed >= DPC_BENCH_MIN_TIME || num_ops >= DPC_BENCH_MAX_OPS) break;
+
+		/* Aim a bit beyond the min duration, but don't grow too fast (first runs are not reliable). */
+		if (elapsed < DPC_BENCH_MIN_TIME / 100) {
+			num_ops *= 10;
+		} else {
+			num_ops = num_ops * (1.2 * DPC_BENCH_MIN_TIME / elapsed) + 1;
+		}
+		if (num_ops > DPC_BENCH_MAX_OPS) num_ops = DPC_BENCH_MAX_OPS;
+	}
+
+	talloc_free(ctx);
+
+	ns_per_op = (double)ftd_elapsed / num_ops;
+
+	switch (bench->format) {
+	case DPC_BENCH_FORMAT_TEXT:
+		fprintf(bench->fp, "%-44s %12"PRIu64" %12.1f %12zu\n", name, num_ops, ns_per_op, num_blocks);
+		break;
+
+	case DPC_BENCH_FORMAT_CSV:
+		fprintf(bench->fp, "%s,%"PRIu64",%.1f,%zu\n", name, num_ops, ns_per_op, num_blocks);
+		break;
+
+	case DPC_BENCH_FORMAT_JSON:
+		fprintf(bench->fp, "{\"name\":\"%s\",\"ops\":%"PRIu64",\"ns_per_op\":%.1f,\"blocks_per_op\":%zu}\n",
+		        name, num_ops, ns_per_op, num_blocks);
+		break;
+	}
+	fflush(bench->fp);
+
+	bench->num_run ++;
+}
+
+/*
+ *	Get the number of benchmarks which have been run.
+ */
+uint32_t dpc_bench_num_run(dpc_bench_t *bench)
+{
+	return bench->num_run;
+}
@@ -0,0 +1,24 @@
+#pragma once
+/*
+ * dpc_bench.h
+ */
+
+/*
+ *	Output formats of benchmark results.
+ */
+typedef enum {
+	DPC_BENCH_FORMAT_TEXT = 1,
+	DPC_BENCH_FORMAT_CSV,
+	DPC_BENCH_FORMAT_JSON      //!< JSON lines (one object per benchmark).
+} dpc_bench_format_t;
+
+/*
+ *	An operation to be benchmarked. Whatever it allocates in ctx is freed after each run.
+ */
+typedef void (*dpc_bench_op_t)(TALLOC_CTX *ctx, void *uctx);
+
+typedef struct dpc_bench dpc_bench_t;
+
+dpc_bench_t *dpc_bench_create(TALLOC_CTX *ctx, FILE *fp, dpc_bench_format_t format, char const *filter);
+void dpc_bench_run(dpc_bench_t *bench, char const *name, dpc_bench_op_t op, void *uctx);
+uint32_t dpc_bench_num_run(dpc_bench_t *bench);
@@ -0,0 +1,286 @@
+/**
+ * @file dpc_lease_store.c
+ * @brief Compact store of client leases.
+ *
+ * What a server handed out to each client (leased address, server identifier, and lease times) is kept in
+ * contiguous arrays, a few bytes per client, rather than in packets and value pairs. Clients are found from their
+ * hardware address through a hash index. Leases can be dumped to a binary file, and loaded back by a later run.
+ *
+ * The file is made of a header, followed by one fixed size record for each lease (all values in network byte
+ * order):
+ * - header: magic "DPCL", version (4 bytes), time origin of the store (8 bytes, seconds since the epoch), and
+ *   number of records (4 bytes).
+ * - record: chaddr (6 bytes), yiaddr, server id, T1, T2, and expiry (4 bytes each, times relative to the origin).
+ */
+
+#include "dhcperfcli.h"
+#include "dpc_lease_store.h"
+
+
+#define DPC_LEASE_FILE_MAGIC      "DPCL"
+#define DPC_LEASE_FILE_VERSION    1
+#define DPC_LEASE_FILE_HDR_LEN    20
+#define DPC_LEASE_FILE_REC_LEN    26
+
+/*
+ *	Each array of the store is a single talloc chunk, and talloc refuses chunks larger than MAX_TALLOC_SIZE
+ *	(256 MB). The largest array is the hash index: its size is a power of 2, which is kept at most 3/4 full.
+ */
+#ifndef MAX_TALLOC_SIZE
+#define MAX_TALLOC_SIZE           0x10000000
+#endif
+#define DPC_LEASE_INDEX_MAX       (MAX_TALLOC_SIZE / sizeof(uint32_t)) /* Max size of the hash index. */
+#define DPC_LEASE_STORE_MAX       ((uint32_t)(DPC_LEASE_INDEX_MAX / 4 * 3 - 1)) /* Max number of clients in a store. */
+
+
+/*
+ *	Hash a hardware address (FNV-1a).
+ */
+static inline uint32_t dpc_lease_chaddr_hash(uint8_t const *chaddr)
+{
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < 6; i++) {
+		hash ^= chaddr[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static inline void dpc_lease_uint32_put(uint8_t *p, uint32_t value)
+{
+	value = htonl(value);
+	memcpy(p, &value, 4);
+}
+
+static inline uint32_t dpc_lease_uint32_get(uint8_t const *p)
+{
+	uint32_t value;
+
+	memcpy(&value, p, 4);
+	return ntohl(value);
+}
+
+/*
+ *	Convert a time offset relative to another origin, into an offset relative to our own.
+ *	Offsets before our origin are brought back to it.
+ */
+static inline uint32_t dpc_lease_offset_rebase(uint32_t offset, int64_t delta)
+{
+	int64_t value;
+
+	if (offset == DPC_LEASE_INFINITE) return offset;
+
+	value = (int64_t)offset + delta;
+	if (value < 0) return 0;
+	if (value >= DPC_LEASE_INFINITE) return DPC_LEASE_INFINITE - 1;
+	return value;
+}
+
+/*
+ *	Allocate a store for a given number of clients. Clients have no lease, and no hardware address yet.
+ */
+dpc_lease_store_t *dpc_lease_store_create(TALLOC_CTX *ctx, uint32_t num)
+{
+	dpc_lease_store_t *store;
+	uint32_t i, size = 1;
+
+	if (!num || num > DPC_LEASE_STORE_MAX) {
+		fr_strerror_printf("Invalid number of clients: %u (max: %u, so that the hash index fits in %u MB)",
+		                   num, DPC_LEASE_STORE_MAX, MAX_TALLOC_SIZE >> 20);
+		return NULL;
+	}
+
+	/* Keep the hash index at most 3/4 full. */
+	while (size < num + num / 3 + 1) size <<= 1;
+
+	store = talloc_zero(ctx, dpc_lease_store_t);
+	if (!store) goto error;
+
+	store->num = num;
+	store->base = time(NULL);
+
+	store->chaddr = talloc_zero_array(store, dpc_chaddr_t, num);
+	store->yiaddr = talloc_zero_array(store, uint32_t, num);
+	store->server_id = talloc_zero_array(store, uint32_t, num);
+	store->t1 = talloc_array(store, uint32_t, num);
+	store->t2 = talloc_array(store, uint32_t, num);
+	store->expiry = talloc_array(store, uint32_t, num);
+	store->index = talloc_array(store, uint32_t, size);
+
+	if (!store->chaddr || !store->yiaddr || !store->server_id || !store->t1 || !store->t2 || !store->expiry
+	    || !store->index) goto error;
+
+	for (i = 0; i < num; i++) {
+		store->t1[i] = store->t2[i] = store->expiry[i] = DPC_LEASE_INFINITE;
+	}
+	for (i = 0; i < size; i++) {
+		store->index[i] = DPC_LEASE_NONE;
+	}
+	store->index_mask = size - 1;
+
+	return store;
+
+error:
+	fr_strerror_printf("Failed to allocate lease store of %u clients", num);
+	talloc_free(store);
+	return NULL;
+}
+
+/*
+ *	Set the hardware address of a client, and index it.
+ *	Returns -1 if another client already has this hardware address, 0 otherwise.
+ */
+int dpc_lease_store_chaddr_set(dpc_lease_store_t *store, uint32_t slot, uint8_t const *chaddr)
+{
+	uint32_t i = dpc_lease_chaddr_hash(chaddr) & store->index_mask;
+
+	while (store->index[i] != DPC_LEASE_NONE) {
+		if (memcmp(store->chaddr[store->index[i]], chaddr, 6) == 0) {
+			fr_strerror_printf("Duplicate hardware address (slots: %u, %u)", store->index[i], slot);
+			return -1;
+		}
+		i = (i + 1) & store->index_mask;
+	}
+
+	memcpy(store->chaddr[slot], chaddr, 6);
+	store->index[i] = slot;
+	return 0;
+}
+
+/*
+ *	Find the client which has a given hardware address.
+ *	Returns its slot, or DPC_LEASE_NONE if there is none.
+ */
+uint32_t dpc_lease_store_lookup(dpc_lease_store_t const *store, uint8_t const *chaddr)
+{
+	uint32_t i = dpc_lease_chaddr_hash(chaddr) & store->index_mask;
+
+	while (store->index[i] != DPC_LEASE_NONE) {
+		if (memcmp(store->chaddr[store->index[i]], chaddr, 6) == 0) return store->index[i];
+		i = (i + 1) & store->index_mask;
+	}
+	return DPC_LEASE_NONE;
+}
+
+/*
+ *	Forget the lease of a client.
+ */
+void dpc_lease_store_clear(dpc_lease_store_t *store, uint32_t slot)
+{
+	store->yiaddr[slot] = 0;
+	store->t1[slot] = store->t2[slot] = store->expiry[slot] = DPC_LEASE_INFINITE;
+}
+
+/*
+ *	Dump to a file the leases which have not expired yet.
+ *	Returns the number of leases written, or -1 on error.
+ */
+int dpc_lease_store_dump(dpc_lease_store_t const *store, char const *filename, uint32_t now)
+{
+	FILE *fp;
+	uint8_t buf[DPC_LEASE_FILE_HDR_LEN > DPC_LEASE_FILE_REC_LEN ? DPC_LEASE_FILE_HDR_LEN : DPC_LEASE_FILE_REC_LEN];
+	uint32_t i, num = 0;
+
+	for (i = 0; i < store->num; i++) {
+		if (store->yiaddr[i] && store->expiry[i] > now) num++;
+	}
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		fr_strerror_printf("Failed to open lease file \"%s\": %s", filename, fr_syserror(errno));
+		return -1;
+	}
+
+	memcpy(buf, DPC_LEASE_FILE_MAGIC, 4);
+	dpc_lease_uint32_put(buf + 4, DPC_LEASE_FILE_VERSION);
+	dpc_lease_uint32_put(buf + 8, (uint64_t)store->base >> 32);
+	dpc_lease_uint32_put(buf + 12, (uint64_t)store->base & 0xffffffff);
+	dpc_lease_uint32_put(buf + 16, num);
+	if (fwrite(buf, DPC_LEASE_FILE_HDR_LEN, 1, fp) != 1) goto error;
+
+	for (i = 0; i < store->num; i++) {
+		if (!store->yiaddr[i] || store->expiry[i] <= now) continue;
+
+		memcpy(buf, store->chaddr[i], 6);
+		memcpy(buf + 6, &store->yiaddr[i], 4);
+		memcpy(buf + 10, &store->server_id[i], 4);
+		dpc_lease_uint32_put(buf + 14, store->t1[i]);
+		dpc_lease_uint32_put(buf + 18, store->t2[i]);
+		dpc_lease_uint32_put(buf + 22, store->expiry[i]);
+		if (fwrite(buf, DPC_LEASE_FILE_REC_LEN, 1, fp) != 1) goto error;
+	}
+
+	if (fclose(fp) != 0) {
+		fr_strerror_printf("Failed to write lease file \"%s\": %s", filename, fr_syserror(errno));
+		return -1;
+	}
+	return num;
+
+error:
+	fr_strerror_printf("Failed to write lease file \"%s\": %s", filename, fr_syserror(errno));
+	fclose(fp);
+	return -1;
+}
+
+/*
+ *	Load leases from a file (produced by a previous run), matching clients by their hardware address.
+ *	Leases of unknown clients, and leases which have expired, are ignored.
+ *	Returns the number of leases loaded, or -1 on error.
+ */
+int dpc_lease_store_load(dpc_lease_store_t *store, char const *filename, uint32_t now)
+{
+	FILE *fp;
+	uint8_t buf[DPC_LEASE_FILE_HDR_LEN > DPC_LEASE_FILE_REC_LEN ? DPC_LEASE_FILE_HDR_LEN : DPC_LEASE_FILE_REC_LEN];
+	uint32_t i, num, slot, expiry;
+	int64_t delta;
+	int loaded = 0;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		fr_strerror_printf("Failed to open lease file \"%s\": %s", filename, fr_syserror(errno));
+		return -1;
+	}
+
+	if (fread(buf, DPC_LEASE_FILE_HDR_LEN, 1, fp) != 1 || memcmp(buf, DPC_LEASE_FILE_MAGIC, 4) != 0) {
+		fr_strerror_printf("Invalid lease file \"%s\"", filename);
+		goto error;
+	}
+	if (dpc_lease_uint32_get(buf + 4) != DPC_LEASE_FILE_VERSION) {
+		fr_strerror_printf("Unsupported lease file \"%s\" (version: %u)", filename, dpc_lease_uint32_get(buf + 4));
+		goto error;
+	}
+
+	/* Times in the file are relative to the origin of the store which was dumped. */
+	delta = (int64_t)(((uint64_t)dpc_lease_uint32_get(buf + 8) << 32) | dpc_lease_uint32_get(buf + 12))
+	        - (int64_t)store->base;
+	num = dpc_lease_uint32_get(buf + 16);
+
+	for (i = 0; i < num; i++) {
+		if (fread(buf, DPC_LEASE_FILE_REC_LEN, 1, fp) != 1) {
+			fr_strerror_printf("Truncated lease file \"%s\" (records: %u, expected: %u)", filename, i, num);
+			goto error;
+		}
+
+		slot = dpc_lease_store_lookup(store, buf);
+		if (slot == DPC_LEASE_NONE || !memcmp(buf + 6, "\0\0\0\0", 4)) continue;
+
+		expiry = dpc_lease_offset_rebase(dpc_lease_uint32_get(buf + 22), delta);
+		if (expiry <= now) continue;
+
+		memcpy(&store->yiaddr[slot], buf + 6, 4);
+		memcpy(&store->server_id[slot], buf + 10, 4);
+		store->t1[slot] = dpc_lease_offset_rebase(dpc_lease_uint32_get(buf + 14), delta);
+		store->t2[slot] = dpc_lease_offset_rebase(dpc_lease_uint32_get(buf + 18), delta);
+		store->expiry[slot] = expiry;
+		loaded++;
+	}
+
+	fclose(fp);
+	return loaded;
+
+error:
+	fclose(fp);
+	return -1;
+}
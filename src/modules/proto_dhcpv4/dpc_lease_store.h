@@ -0,0 +1,37 @@
+#pragma once
+/*
+ * dpc_lease_store.h
+ */
+
+#define DPC_LEASE_NONE      UINT32_MAX /* No slot (client not found). */
+#define DPC_LEASE_INFINITE  UINT32_MAX /* Time offset which is never reached (infinite lease). */
+
+typedef uint8_t dpc_chaddr_t[6];
+
+/*
+ *	Leases of a set of clients, stored as a struct of arrays indexed by client slot: each field of all clients is
+ *	contiguous in memory, so that going through one of them (e.g. expiry) does not load the others in cache.
+ *	Times are offsets (in seconds) from the creation of the store, so they hold on 32 bits.
+ */
+typedef struct dpc_lease_store {
+	uint32_t num;             //!< Number of slots (clients).
+	time_t base;              //!< Origin of time offsets (wall clock).
+
+	dpc_chaddr_t *chaddr;     //!< Client hardware address.
+	uint32_t *yiaddr;         //!< Leased IP address (network byte order), 0 if none.
+	uint32_t *server_id;      //!< Server which granted the lease (network byte order).
+	uint32_t *t1;             //!< When the lease is to be renewed.
+	uint32_t *t2;             //!< When the lease is to be rebound.
+	uint32_t *expiry;         //!< When the lease expires.
+
+	uint32_t *index;          //!< Hash index of hardware addresses (open addressing): slot, or DPC_LEASE_NONE.
+	uint32_t index_mask;      //!< Size of the hash index, minus one (size is a power of 2).
+} dpc_lease_store_t;
+
+dpc_lease_store_t *dpc_lease_store_create(TALLOC_CTX *ctx, uint32_t num);
+int dpc_lease_store_chaddr_set(dpc_lease_store_t *store, uint32_t slot, uint8_t const *chaddr);
+uint32_t dpc_lease_store_lookup(dpc_lease_store_t const *store, uint8_t const *chaddr);
+void dpc_lease_store_clear(dpc_lease_store_t *store, uint32_t slot);
+
+int dpc_lease_store_dump(dpc_lease_store_t const *store, char const *filename, uint32_t now);
+int dpc_lease_store_load(dpc_lease_store_t *store, char const *filename, uint32_t now);
@@ -9,11 +9,73 @@
 #include "dpc_packet_list.h"
 #include "dpc_util.h"
 
+#ifdef __linux__
+#  include <sys/epoll.h>
+#  include <fcntl.h>
+#  define DPC_WITH_EPOLL 1
+#  define DPC_WITH_RECVMMSG 1
+#  define DPC_WITH_SENDMMSG 1
+#  include <linux/net_tstamp.h>
+#  include <linux/errqueue.h>
+#  ifdef SO_TIMESTAMPING
+#    define DPC_WITH_TIMESTAMPING 1
+#  endif
+#  include <linux/filter.h>
+#  if defined(SO_REUSEPORT) && defined(SO_ATTACH_REUSEPORT_CBPF)
+#    define DPC_WITH_REUSEPORT 1
+#  endif
+#endif
+
 
 /* We need as many sockets as source IP / port. In most cases, only one will be used. */
 #define DPC_MAX_SOCKETS         32  // Is this enough ?
 #define DPC_ID_ALLOC_MAX_TRIES  32
 
+#define DPC_RECV_BUF_SIZE       1500 /* Fixed size of buffers in the receive ring (Ethernet MTU). */
+#define DPC_RECV_MIN_LEN        240  /* DHCP fields and magic cookie. Anything shorter is not worth looking at. */
+
+#define DPC_TX_TSTAMP_SLOTS     16384 /* Transmit timestamps kept per socket (power of 2). */
+
+#define DPC_XID_TABLE_SIZE_INIT 1024 /* Initial size of the xid table (power of 2). It grows as needed. */
+
+
+#ifdef DPC_WITH_SENDMMSG
+#define DPC_SEND_CONTROL_LEN    CMSG_SPACE(sizeof(struct in_pktinfo)) /* Ancillary data of a queued packet. */
+
+/*
+ *	Send queue of a socket: encoded packets waiting to be sent in batch through sendmmsg.
+ */
+typedef struct dpc_send_queue {
+	uint32_t num;                  //!< Number of packets currently queued.
+
+	DHCP_PACKET ***packets;        //!< Queued packets (as provided by the caller, i.e. pointers to the packet list entries).
+	struct mmsghdr *msgs;
+	struct iovec *iov;
+	struct sockaddr_storage *dst;
+	uint8_t *control;              //!< Ancillary data (source address) of each packet, DPC_SEND_CONTROL_LEN bytes each.
+} dpc_send_queue_t;
+#endif
+
+#ifdef DPC_WITH_TIMESTAMPING
+/*
+ *	Kernel (software) and NIC (hardware) timestamps of a datagram.
+ *	Either may be unavailable (0). Hardware timestamps are in the time base of the NIC clock, so they can only be
+ *	compared with one another.
+ */
+typedef struct dpc_tstamp {
+	fr_time_t sw;
+	fr_time_t hw;
+} dpc_tstamp_t;
+
+/*
+ *	Transmit timestamp reported by the kernel through the socket error queue, for a given send (key).
+ */
+typedef struct dpc_tx_tstamp {
+	uint32_t key;            //!< Counter of datagrams sent on the socket (SOF_TIMESTAMPING_OPT_ID).
+	bool valid;
+	dpc_tstamp_t ts;
+} dpc_tx_tstamp_t;
+#endif
 
 /*
  *	Keep track of the socket(s) (along with source and destination IP/port)
@@ -31,10 +93,23 @@ typedef struct dpc_packet_socket {
 	fr_ipaddr_t src_ipaddr;
 	uint16_t src_port;
 
+	bool edge_triggered;    //!< Socket is non-blocking, and only reported readable when new data arrives.
+	bool ready;             //!< Socket has been reported readable, and has not been drained yet.
+
 #ifdef HAVE_LIBPCAP
 	fr_pcap_t *pcap;
 #endif
 
+#ifdef DPC_WITH_SENDMMSG
+	dpc_send_queue_t *send_queue; //!< Packets waiting to be sent (if batched transmission is enabled).
+#endif
+
+#ifdef DPC_WITH_TIMESTAMPING
+	bool timestamping;            //!< SO_TIMESTAMPING is enabled on this socket.
+	uint32_t tx_key_next;         //!< Key which the kernel will assign to the next datagram sent.
+	dpc_tx_tstamp_t *tx_tstamps;  //!< Transmit timestamps, indexed by key (modulo number of slots).
+#endif
+
 } dpc_packet_socket_t;
 
 /*
@@ -50,6 +125,49 @@ typedef struct dpc_packet_socket {
  *	socket with 0.0.0.0. It would fail with "Bind failed: EADDRINUSE: Address already in use".
  */
 
+/*
+ *	Note on reception:
+ *
+ *	On Linux, sockets are registered once (when added to the packet list) on an epoll instance owned by
+ *	the packet list. UDP sockets are non-blocking and edge-triggered: once reported readable, a socket is
+ *	flagged "ready" and we keep reading from it until the kernel tells us it's empty (EAGAIN).
+ *	The pcap socket is level-triggered, because the pcap library may consume datagrams which are not DHCP
+ *	replies (and return nothing), so we cannot reliably tell when it's drained.
+ *
+ *	Elsewhere, we fall back to select(), which is limited to FD_SETSIZE.
+ */
+
+
+#ifdef DPC_WITH_RECVMMSG
+/*
+ *	One slot of the receive ring: holds a datagram, and its associated ancillary data.
+ */
+typedef struct dpc_recv_slot {
+	uint8_t data[DPC_RECV_BUF_SIZE];
+	struct sockaddr_storage src;
+	uint8_t control[CMSG_SPACE(sizeof(struct in_pktinfo))
+#ifdef DPC_WITH_TIMESTAMPING
+	                + CMSG_SPACE(sizeof(struct scm_timestamping))
+#endif
+	               ];
+} dpc_recv_slot_t;
+
+/*
+ *	Receive ring: preallocated buffers in which datagrams are received in batch through recvmmsg.
+ *	All datagrams held in the ring at a given time come from the same socket.
+ */
+typedef struct dpc_recv_ring {
+	uint32_t size;           //!< Number of slots (max datagrams received with a single system call).
+	uint32_t num;            //!< Number of datagrams currently held.
+	uint32_t next;           //!< Next datagram to be handled.
+	int sock_idx;            //!< Index of the socket from which the datagrams were received.
+	fr_time_t timestamp;     //!< When the datagrams were received.
+
+	dpc_recv_slot_t *slots;
+	struct mmsghdr *msgs;
+	struct iovec *iov;
+} dpc_recv_ring_t;
+#endif
 
 /*
  *	Structure defining a list of DHCP packets (incoming or outgoing)
@@ -64,10 +182,80 @@ typedef struct dpc_packet_list {
 	int num_sockets;        //!< Number of managed sockets.
 
 	dpc_packet_socket_t sockets[DPC_MAX_SOCKETS];
+	int num_ready;          //!< Number of sockets flagged as ready for reading.
+
+#ifdef DPC_WITH_EPOLL
+	int epfd;               //!< epoll instance on which all managed sockets are registered.
+#endif
+#ifdef DPC_WITH_RECVMMSG
+	dpc_recv_ring_t *ring;  //!< Receive ring (if batched reception is enabled).
+#endif
+
+	uint32_t send_batch;    //!< Max number of packets sent with a single system call (0: no batching).
+	dpc_packet_sent_t send_cb; //!< Called for each queued packet, once it has been sent (or has failed to be).
+	uint32_t num_queued;    //!< Number of packets currently queued, all sockets combined.
+
+#ifdef DPC_WITH_TIMESTAMPING
+	dpc_timestamping_t timestamping; //!< Timestamping mode enabled on UDP sockets.
+	dpc_tstamp_t rx_tstamp; //!< Receive timestamps of the last packet returned by dpc_packet_list_recv.
+#endif
+
+	DHCP_PACKET ***xid_table; //!< Requests with a linearly allocated xid, indexed by (xid & xid_mask).
+	uint32_t xid_mask;      //!< Size of the xid table - 1.
+	uint32_t xid_table_num; //!< Number of requests in the xid table.
 
 	uint32_t prev_id;       //!< Previously allocated xid. Allows to allocate xid's in a linear fashion.
+	uint32_t xid_shard;     //!< Value of the high bits of xid's allocated linearly (if the xid space is sharded).
+	uint32_t xid_shard_bits; //!< Number of high bits of xid's reserved for the shard (0: no sharding).
 } dpc_packet_list_t;
 
+/*
+ *	Note on the packet list:
+ *
+ *	Most requests are assigned an xid in a linear fashion (from prev_id). These are stored in the xid table,
+ *	at index (xid & xid_mask). Consecutive xid's use consecutive slots, so a slot is busy only if the request
+ *	which was assigned an xid "table size" ago is still outstanding. If so we just skip this xid.
+ *	The table grows when it becomes half full, so this is rare. Insert, lookup and removal are O(1).
+ *
+ *	Requests with an xid chosen by the user (which can be anything) are stored in the rbtree.
+ *	An xid which we reuse ourselves (the DORA Request has the xid of the Discover, which has just been freed) goes
+ *	back in the xid table, in the slot which was just freed. Only if that slot is busy does it go in the rbtree.
+ *
+ *	When several worker processes share the same source IP address and port, the xid space is sharded: the high
+ *	bits of an xid allocated linearly identify the worker. A BPF program attached to the SO_REUSEPORT group of
+ *	sockets uses these bits to deliver each reply to the socket of the worker which sent the request.
+ */
+
+/*
+ *	Number of xid high bits needed to identify a shard.
+ */
+static uint32_t dpc_xid_shard_bits(uint32_t num_shards)
+{
+	uint32_t bits = 0;
+
+	while (bits < 16 && (1U << bits) < num_shards) bits++;
+	return bits;
+}
+
+/*
+ *	Map an xid into our shard of the xid space (if it is sharded), by replacing its high bits.
+ */
+static inline uint32_t dpc_xid_to_shard(dpc_packet_list_t *pl, uint32_t xid)
+{
+	if (!pl->xid_shard_bits) return xid;
+	return (pl->xid_shard << (32 - pl->xid_shard_bits)) | (xid & (UINT32_MAX >> pl->xid_shard_bits));
+}
+
+/*
+ *	Get the next xid to be allocated in a linear fashion.
+ */
+static uint32_t dpc_xid_next(dpc_packet_list_t *pl)
+{
+	pl->prev_id ++;
+
+	return dpc_xid_to_shard(pl, pl->prev_id);
+}
+
 
 /*
  *	Check if two packets are identical from the packet list perspective.
@@ -125,10 +313,113 @@ static dpc_packet_socket_t *dpc_socket_find(dpc_packet_list_t *pl, int sockfd)
 	return NULL; /* Socket not found. */
 }
 
+#ifdef DPC_WITH_TIMESTAMPING
+/*
+ *	Enable SO_TIMESTAMPING on a UDP socket.
+ *	Transmit timestamps are tagged with a per-socket counter (OPT_ID), and reported without the datagram (OPT_TSONLY).
+ */
+static int dpc_socket_timestamping_enable(dpc_packet_list_t *pl, dpc_packet_socket_t *ps)
+{
+	int flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE
+	          | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+
+	if (pl->timestamping == DPC_TIMESTAMPING_HARDWARE) {
+		flags |= SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_TX_HARDWARE;
+	}
+
+	if (setsockopt(ps->sockfd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+		fr_strerror_printf("Can't set SO_TIMESTAMPING option: %s", fr_syserror(errno));
+		return -1;
+	}
+
+	if (!ps->tx_tstamps) {
+		MEM(ps->tx_tstamps = talloc_zero_array(pl, dpc_tx_tstamp_t, DPC_TX_TSTAMP_SLOTS));
+	}
+	ps->tx_key_next = 0; /* Counter is (re)started by the kernel when the option is set. */
+	ps->timestamping = true;
+
+	return 0;
+}
+
+/*
+ *	Get timestamps from a control message, if there are any.
+ */
+static bool dpc_cmsg_tstamp_get(dpc_tstamp_t *out, struct cmsghdr *cmsg)
+{
+	struct scm_timestamping *tss;
+
+	if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) return false;
+
+	tss = (struct scm_timestamping *)CMSG_DATA(cmsg);
+
+	/* ts[0] is the software timestamp, ts[2] the raw hardware timestamp. */
+	if (tss->ts[0].tv_sec || tss->ts[0].tv_nsec) out->sw = fr_time_from_timespec(&tss->ts[0]);
+	if (tss->ts[2].tv_sec || tss->ts[2].tv_nsec) out->hw = fr_time_from_timespec(&tss->ts[2]);
+
+	return true;
+}
+
+/*
+ *	Read all transmit timestamps available from the error queue of a socket, and store them.
+ */
+static void dpc_socket_errqueue_drain(dpc_packet_socket_t *ps)
+{
+	uint8_t data[64];
+	uint8_t control[512];
+
+	if (!ps->timestamping) return;
+
+	while (true) {
+		struct iovec iov = { .iov_base = data, .iov_len = sizeof(data) };
+		struct msghdr msg = {
+			.msg_iov = &iov,
+			.msg_iovlen = 1,
+			.msg_control = control,
+			.msg_controllen = sizeof(control)
+		};
+		struct cmsghdr *cmsg;
+		dpc_tstamp_t ts = { 0 };
+		bool with_ts = false, with_key = false;
+		uint32_t key = 0;
+
+		if (recvmsg(ps->sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break; /* Nothing more (EAGAIN). */
+
+		for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+			if (dpc_cmsg_tstamp_get(&ts, cmsg)) {
+				with_ts = true;
+
+			} else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+			           || (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+				struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+
+				if (serr->ee_errno == ENOMSG && serr->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+					key = serr->ee_data;
+					with_key = true;
+				}
+			}
+		}
+		if (!with_ts || !with_key) continue;
+
+		/*
+		 *	Software and hardware timestamps may be reported separately for a given datagram.
+		 */
+		dpc_tx_tstamp_t *slot = &ps->tx_tstamps[key & (DPC_TX_TSTAMP_SLOTS - 1)];
+		if (!slot->valid || slot->key != key) {
+			memset(slot, 0, sizeof(*slot));
+			slot->key = key;
+			slot->valid = true;
+		}
+		if (ts.sw) slot->ts.sw = ts.sw;
+		if (ts.hw) slot->ts.hw = ts.hw;
+	}
+}
+#endif
+
 /*
  *	Add a socket to our list of managed sockets.
  */
-static dpc_packet_socket_t *dpc_socket_add(dpc_packet_list_t *pl, int sockfd, fr_ipaddr_t *src_ipaddr, uint16_t src_port)
+static dpc_packet_socket_t *dpc_socket_add(dpc_packet_list_t *pl, int sockfd, fr_ipaddr_t *src_ipaddr, uint16_t src_port,
+                                           bool edge_triggered)
 {
 	dpc_packet_socket_t *ps;
 
@@ -151,6 +442,42 @@ static dpc_packet_socket_t *dpc_socket_add(dpc_packet_list_t *pl, int sockfd, fr
 	ps->src_ipaddr = *src_ipaddr;
 	ps->src_port = src_port;
 	ps->sockfd = sockfd;
+	ps->edge_triggered = edge_triggered;
+
+#ifdef DPC_WITH_TIMESTAMPING
+	/* Timestamping is only handled on UDP sockets. Enable it first, so we don't leave a registered fd on error. */
+	if (pl->timestamping && edge_triggered && dpc_socket_timestamping_enable(pl, ps) < 0) {
+		ps->sockfd = -1;
+		return NULL;
+	}
+#endif
+
+#ifdef DPC_WITH_EPOLL
+	/*
+	 *	Register the socket on our epoll instance. This is done only once.
+	 *	The index of the socket in our array is stored as event data, so we don't have to look for it.
+	 */
+	struct epoll_event ev = {
+		.events = EPOLLIN | EPOLLERR | (edge_triggered ? EPOLLET : 0),
+		.data.u32 = pl->num_sockets
+	};
+
+	if (edge_triggered) {
+		/* Edge-triggered requires a non-blocking socket, which we'll read until exhaustion. */
+		int flags = fcntl(sockfd, F_GETFL, 0);
+		if (flags < 0 || fcntl(sockfd, F_SETFL, flags | O_NONBLOCK) < 0) {
+			fr_strerror_printf("Can't set socket non-blocking: %s", fr_syserror(errno));
+			ps->sockfd = -1;
+			return NULL;
+		}
+	}
+
+	if (epoll_ctl(pl->epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+		fr_strerror_printf("Failed to register socket with epoll: %s", fr_syserror(errno));
+		ps->sockfd = -1;
+		return NULL;
+	}
+#endif
 
 	pl->num_sockets ++;
 
@@ -215,7 +542,7 @@ int dpc_pcap_socket_add(dpc_packet_list_t *pl, fr_pcap_t *pcap, fr_ipaddr_t *src
 {
 	dpc_packet_socket_t *ps;
 
-	ps = dpc_socket_add(pl, pcap->fd, src_ipaddr, src_port);
+	ps = dpc_socket_add(pl, pcap->fd, src_ipaddr, src_port, false);
 	if (!ps) return -1;
 
 	ps->pcap = pcap; /* Remember this is a pcap socket. */
@@ -223,6 +550,52 @@ int dpc_pcap_socket_add(dpc_packet_list_t *pl, fr_pcap_t *pcap, fr_ipaddr_t *src
 }
 #endif
 
+/*
+ *	Open a connectionless UDP socket for sending and receiving, bound to a source IP address and port.
+ *	If reuseport is true, several sockets may be bound to the same address and port (cf. dpc_socket_group_open).
+ */
+static int dpc_socket_open(fr_ipaddr_t *src_ipaddr, uint16_t src_port, bool reuseport)
+{
+	int on = 1;
+	int sockfd = fr_socket_server_udp(src_ipaddr, &src_port, NULL, false);
+	if (sockfd < 0) {
+		fr_strerror_printf("Error opening socket: %s", fr_strerror());
+		return -1;
+	}
+
+#ifdef DPC_WITH_REUSEPORT
+	if (reuseport && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+		fr_strerror_printf("Can't set reuseport option: %s", fr_syserror(errno));
+		close(sockfd);
+		return -1;
+	}
+#endif
+
+	if (fr_socket_bind(sockfd, src_ipaddr, &src_port, NULL) < 0) {
+		fr_strerror_printf("Error binding socket: %s", fr_strerror());
+		close(sockfd);
+		return -1;
+	}
+
+	/* Allow to use this socket to broadcast. */
+	if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0) {
+		fr_strerror_printf("Can't set broadcast option: %s", fr_syserror(errno));
+		close(sockfd);
+		return -1;
+	}
+
+#ifdef DPC_WITH_RECVMMSG
+	/* Get the destination address of datagrams we receive in batch (the socket may be bound to INADDR_ANY). */
+	if (setsockopt(sockfd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) < 0) {
+		fr_strerror_printf("Can't set IP_PKTINFO option: %s", fr_syserror(errno));
+		close(sockfd);
+		return -1;
+	}
+#endif
+
+	return sockfd;
+}
+
 /*
  *	Provide a suitable socket from our list. If necesary, initialize a new one.
  */
@@ -248,27 +621,63 @@ int dpc_socket_provide(dpc_packet_list_t *pl, fr_ipaddr_t *src_ipaddr, uint16_t
 	/* No socket found, we need a new one. */
 	DEBUG_TRACE("No suitable managed socket found, need a new one...");
 
-	/* Open a connectionless UDP socket for sending and receiving. */
-	int sockfd = fr_socket_server_udp(src_ipaddr, &src_port, NULL, false);
-	if (sockfd < 0) {
-		fr_strerror_printf("Error opening socket: %s", fr_strerror());
+	int sockfd = dpc_socket_open(src_ipaddr, src_port, false);
+	if (sockfd < 0) return -1;
+
+	/* Add the socket to our list of managed sockets. */
+	if (!dpc_socket_add(pl, sockfd, src_ipaddr, src_port, true)) {
 		return -1;
 	}
+	return sockfd;
+}
 
-	if (fr_socket_bind(sockfd, src_ipaddr, &src_port, NULL) < 0) {
-		fr_strerror_printf("Error binding socket: %s", fr_strerror());
-		return -1;
+/*
+ *	Open a group of sockets bound to the same source IP address and port (one for each worker process).
+ *	The kernel delivers each reply to the socket of the group whose index is the xid shard (high bits).
+ *	This requires that sockets are all opened here, in this order, before the workers are started.
+ */
+int dpc_socket_group_open(fr_ipaddr_t *src_ipaddr, uint16_t src_port, uint32_t num, int *fds)
+{
+#ifdef DPC_WITH_REUSEPORT
+	uint32_t i;
+	uint32_t bits = dpc_xid_shard_bits(num);
+
+	/*
+	 *	Load the xid (offset 4 of the UDP payload), and return its high bits as index of the socket.
+	 */
+	struct sock_filter code[] = {
+		{ BPF_LD | BPF_W | BPF_ABS, 0, 0, 4 },
+		{ BPF_ALU | BPF_RSH | BPF_K, 0, 0, 32 - bits },
+		{ BPF_RET | BPF_A, 0, 0, 0 },
+	};
+	struct sock_fprog prog = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+
+	for (i = 0; i < num; i++) {
+		fds[i] = dpc_socket_open(src_ipaddr, src_port, true);
+		if (fds[i] < 0) goto error;
 	}
 
-	/* Allow to use this socket to broadcast. */
-	int on = 1;
-	if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on)) < 0) {
-		fr_strerror_printf("Can't set broadcast option: %s", fr_syserror(errno));
-		return -1;
+	if (setsockopt(fds[0], SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+		fr_strerror_printf("Can't attach reuseport BPF program: %s", fr_syserror(errno));
+		goto error;
 	}
+	return 0;
 
-	/* Add the socket to our list of managed sockets. */
-	if (!dpc_socket_add(pl, sockfd, src_ipaddr, src_port)) {
+error:
+	while (i > 0) close(fds[--i]);
+	return -1;
+#else
+	fr_strerror_printf("Sharing a socket between workers is not supported on this system");
+	return -1;
+#endif
+}
+
+/*
+ *	Add to our list of managed sockets a socket which was opened beforehand (e.g. from a group of sockets).
+ */
+int dpc_socket_adopt(dpc_packet_list_t *pl, int sockfd, fr_ipaddr_t *src_ipaddr, uint16_t src_port)
+{
+	if (!dpc_socket_add(pl, sockfd, src_ipaddr, src_port, true)) {
 		return -1;
 	}
 	return sockfd;
@@ -298,6 +707,18 @@ void dpc_packet_list_free(dpc_packet_list_t *pl)
 	talloc_free(pl);
 }
 
+/*
+ *	Packet list destructor: release the epoll instance.
+ */
+static int _dpc_packet_list_free(dpc_packet_list_t *pl)
+{
+#ifdef DPC_WITH_EPOLL
+	if (pl->epfd >= 0) close(pl->epfd);
+	pl->epfd = -1;
+#endif
+	return 0;
+}
+
 /*
  *	Create the DHCP packet list.
  *	Caller is responsible for managing the packet entries.
@@ -311,6 +732,16 @@ dpc_packet_list_t *dpc_packet_list_create(TALLOC_CTX *ctx, uint32_t base_id)
 	pl = talloc_zero(ctx, dpc_packet_list_t);
 	if (!pl) return NULL;
 
+#ifdef DPC_WITH_EPOLL
+	pl->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (pl->epfd < 0) {
+		fr_strerror_printf("Failed to create epoll instance: %s", fr_syserror(errno));
+		talloc_free(pl);
+		return NULL;
+	}
+#endif
+	talloc_set_destructor(pl, _dpc_packet_list_free);
+
 	pl->tree = rbtree_create(pl, dpc_packet_entry_cmp, NULL, 0);
 	if (!pl->tree) {
 		dpc_packet_list_free(pl);
@@ -321,17 +752,271 @@ dpc_packet_list_t *dpc_packet_list_create(TALLOC_CTX *ctx, uint32_t base_id)
 		pl->sockets[i].sockfd = -1;
 	}
 
+	pl->xid_table = talloc_zero_array(pl, DHCP_PACKET **, DPC_XID_TABLE_SIZE_INIT);
+	if (!pl->xid_table) {
+		dpc_packet_list_free(pl);
+		return NULL;
+	}
+	pl->xid_mask = DPC_XID_TABLE_SIZE_INIT - 1;
+
 	/* Initialize "previously allocated xid", which is used to allocate xid's in a linear fashion. */
 	pl->prev_id = base_id - 1;
 
 	return pl;
 }
 
+/*
+ *	Restrict xid's allocated in a linear fashion to a shard (one out of num_shards) of the xid space.
+ */
+int dpc_packet_list_set_xid_shard(dpc_packet_list_t *pl, uint32_t shard, uint32_t num_shards)
+{
+	dpc_assert(pl != NULL);
+
+	if (num_shards < 2) return 0;
+
+	pl->xid_shard_bits = dpc_xid_shard_bits(num_shards);
+	if (shard >= (1U << pl->xid_shard_bits)) {
+		fr_strerror_printf("Invalid xid shard %u (out of %u)", shard, num_shards);
+		pl->xid_shard_bits = 0;
+		return -1;
+	}
+	pl->xid_shard = shard;
+
+	return 0;
+}
+
+/*
+ *	Enable batched reception: datagrams are received with recvmmsg, up to "num" at once, in a preallocated ring.
+ *	If num is 0 (or if recvmmsg is not available), each datagram is received individually.
+ */
+int dpc_packet_list_set_recv_batch(dpc_packet_list_t *pl, uint32_t num)
+{
+	dpc_assert(pl != NULL);
+
+	if (num == 0) return 0;
+
+#ifdef DPC_WITH_RECVMMSG
+	uint32_t i;
+	dpc_recv_ring_t *ring;
+
+	if (pl->ring) {
+		fr_strerror_printf("Receive ring already allocated");
+		return -1;
+	}
+
+	MEM(ring = talloc_zero(pl, dpc_recv_ring_t));
+	MEM(ring->slots = talloc_array(ring, dpc_recv_slot_t, num));
+	MEM(ring->msgs = talloc_zero_array(ring, struct mmsghdr, num));
+	MEM(ring->iov = talloc_zero_array(ring, struct iovec, num));
+	ring->size = num;
+	ring->sock_idx = -1;
+
+	/* Buffers are tied once and for all to the message headers. */
+	for (i = 0; i < num; i++) {
+		ring->iov[i].iov_base = ring->slots[i].data;
+		ring->iov[i].iov_len = DPC_RECV_BUF_SIZE;
+
+		ring->msgs[i].msg_hdr.msg_iov = &ring->iov[i];
+		ring->msgs[i].msg_hdr.msg_iovlen = 1;
+		ring->msgs[i].msg_hdr.msg_name = &ring->slots[i].src;
+		ring->msgs[i].msg_hdr.msg_control = ring->slots[i].control;
+	}
+
+	pl->ring = ring;
+	DEBUG2("Batched reception enabled (up to %u datagrams per system call)", num);
+	return 0;
+#else
+	WARN("Batched reception is not supported on this system, datagrams will be received individually");
+	return 0;
+#endif
+}
+
+/*
+ *	Enable batched transmission: packets are queued per socket, and sent with sendmmsg, up to "num" at once.
+ *	The callback is invoked for each packet once it has been sent (or when sending failed).
+ *	If num is 0, batched transmission is disabled.
+ */
+int dpc_packet_list_set_send_batch(dpc_packet_list_t *pl, uint32_t num, dpc_packet_sent_t cb)
+{
+	dpc_assert(pl != NULL);
+
+	if (num == 0) return 0;
+
+	if (!cb) {
+		fr_strerror_printf("A callback is required for batched transmission");
+		return -1;
+	}
+
+#ifndef DPC_WITH_SENDMMSG
+	WARN("Batched transmission is not supported on this system, packets will be sent individually");
+#else
+	DEBUG2("Batched transmission enabled (up to %u packets per system call)", num);
+#endif
+
+	pl->send_batch = num;
+	pl->send_cb = cb;
+	return 0;
+}
+
+/*
+ *	Enable SO_TIMESTAMPING on UDP sockets (those already managed, and those added later).
+ *	Receive timestamps are obtained through the receive ring, which therefore must be enabled.
+ */
+int dpc_packet_list_set_timestamping(dpc_packet_list_t *pl, dpc_timestamping_t mode)
+{
+	dpc_assert(pl != NULL);
+
+	if (mode == DPC_TIMESTAMPING_NONE) return 0;
+
+#ifndef DPC_WITH_TIMESTAMPING
+	fr_strerror_printf("Timestamping is not supported on this system");
+	return -1;
+#else
+	int i;
+
+	if (!pl->ring) {
+		fr_strerror_printf("Timestamping requires batched reception");
+		return -1;
+	}
+
+	pl->timestamping = mode;
+
+	for (i = 0; i < pl->num_sockets; i++) {
+		if (!pl->sockets[i].edge_triggered) continue; /* Not UDP. */
+		if (dpc_socket_timestamping_enable(pl, &pl->sockets[i]) < 0) return -1;
+	}
+
+	DEBUG2("Timestamping enabled (%s)", (mode == DPC_TIMESTAMPING_HARDWARE) ? "hardware" : "software");
+	return 0;
+#endif
+}
+
+/*
+ *	A packet has been sent on a socket: get the key the kernel assigned to it, so we can retrieve its
+ *	transmit timestamp later.
+ *	Must be called exactly once for each datagram successfully sent on the socket, in order.
+ *	Returns: true if the key is set (i.e. timestamping is enabled on this socket), false otherwise.
+ */
+bool dpc_packet_list_tx_key(dpc_packet_list_t *pl, int sockfd, uint32_t *key)
+{
+#ifdef DPC_WITH_TIMESTAMPING
+	dpc_packet_socket_t *ps;
+
+	dpc_assert(pl != NULL);
+
+	ps = dpc_socket_find(pl, sockfd);
+	if (!ps || !ps->timestamping) return false;
+
+	*key = ps->tx_key_next ++;
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *	Compute the "wire" round trip time of a request, from its transmit timestamp and the receive timestamp
+ *	of the last packet returned by dpc_packet_list_recv.
+ *	Hardware timestamps are used if both are available, otherwise software timestamps.
+ *	Returns: true if rtt could be computed, false otherwise.
+ */
+bool dpc_packet_list_wire_rtt(dpc_packet_list_t *pl, int sockfd, uint32_t key, fr_time_delta_t *rtt)
+{
+#ifdef DPC_WITH_TIMESTAMPING
+	dpc_packet_socket_t *ps;
+	dpc_tx_tstamp_t *slot;
+
+	dpc_assert(pl != NULL);
+
+	ps = dpc_socket_find(pl, sockfd);
+	if (!ps || !ps->timestamping) return false;
+
+	/* The transmit timestamp is certainly available by now, unless the kernel failed to provide it. */
+	dpc_socket_errqueue_drain(ps);
+
+	slot = &ps->tx_tstamps[key & (DPC_TX_TSTAMP_SLOTS - 1)];
+	if (!slot->valid || slot->key != key) return false; /* Not reported, or overwritten. */
+
+	if (slot->ts.hw && pl->rx_tstamp.hw && pl->rx_tstamp.hw > slot->ts.hw) {
+		*rtt = pl->rx_tstamp.hw - slot->ts.hw;
+		return true;
+	}
+	if (slot->ts.sw && pl->rx_tstamp.sw && pl->rx_tstamp.sw > slot->ts.sw) {
+		*rtt = pl->rx_tstamp.sw - slot->ts.sw;
+		return true;
+	}
+	return false;
+#else
+	return false;
+#endif
+}
+
+/*
+ *	Double the size of the xid table.
+ *	Entries which were in distinct slots remain in distinct slots, since the new mask only has one more bit.
+ */
+static void dpc_xid_table_grow(dpc_packet_list_t *pl)
+{
+	uint32_t i, size = pl->xid_mask + 1;
+	DHCP_PACKET ***table;
+
+	MEM(table = talloc_zero_array(pl, DHCP_PACKET **, size * 2));
+
+	for (i = 0; i < size; i++) {
+		DHCP_PACKET **entry = pl->xid_table[i];
+		if (entry) table[(*entry)->id & (size * 2 - 1)] = entry;
+	}
+
+	talloc_free(pl->xid_table);
+	pl->xid_table = table;
+	pl->xid_mask = size * 2 - 1;
+
+	DEBUG_TRACE("Xid table grown to %u slots (entries: %u)", size * 2, pl->xid_table_num);
+}
+
+/*
+ *	Look in the xid table for a packet identical (from the packet list perspective) to the one provided.
+ */
+static inline DHCP_PACKET **dpc_xid_table_find(dpc_packet_list_t *pl, DHCP_PACKET const *request)
+{
+	DHCP_PACKET **entry = pl->xid_table[request->id & pl->xid_mask];
+
+	if (entry && dpc_packet_cmp(*entry, request) == 0) return entry;
+	return NULL;
+}
+
+/*
+ *	Insert a packet with a linearly allocated xid in the xid table.
+ *	Returns false if the slot is busy, or if an identical packet is in the rbtree.
+ */
+static bool dpc_xid_table_insert(dpc_packet_list_t *pl, DHCP_PACKET **request_p)
+{
+	uint32_t idx;
+
+	if ((pl->xid_table_num + 1) * 2 > pl->xid_mask + 1) dpc_xid_table_grow(pl);
+
+	idx = (*request_p)->id & pl->xid_mask;
+	if (pl->xid_table[idx]) return false;
+
+	if (rbtree_num_elements(pl->tree) > 0 && rbtree_finddata(pl->tree, request_p)) return false;
+
+	pl->xid_table[idx] = request_p;
+	pl->xid_table_num ++;
+
+	char from_to_buf[DPC_FROM_TO_STRLEN] = "";
+	DEBUG_TRACE("Inserted packet in xid table: fd: %d, id: %u, %s", (*request_p)->sockfd, (*request_p)->id,
+	            dpc_packet_from_to_sprint(from_to_buf, *request_p, true));
+
+	return true;
+}
+
 /*
  *	Insert an element in the packet list.
  *	Caller is responsible for allocating an ID before calling this.
  *	Or at least trying to: if the provided ID is already allocated, this will return false.
  *	(ref: function fr_packet_list_insert from protocols/radius/list.c)
+ *
+ *	Note: this is for packets with an xid chosen by the user (linearly allocated xid's go in the xid table).
  */
 bool dpc_packet_list_insert(dpc_packet_list_t *pl, DHCP_PACKET **request_p)
 {
@@ -339,6 +1024,8 @@ bool dpc_packet_list_insert(dpc_packet_list_t *pl, DHCP_PACKET **request_p)
 	dpc_assert(request_p != NULL);
 	dpc_assert(*request_p != NULL);
 
+	if (dpc_xid_table_find(pl, *request_p)) return false;
+
 	bool r = rbtree_insert(pl->tree, request_p);
 	if (r) {
 		char from_to_buf[DPC_FROM_TO_STRLEN] = "";
@@ -410,6 +1097,10 @@ DHCP_PACKET **dpc_packet_list_find_byreply(dpc_packet_list_t *pl, DHCP_PACKET *r
 	DEBUG_TRACE("Searching for packet: fd: %d, id: %u, %s", request->sockfd, request->id,
 	            dpc_packet_from_to_sprint(from_to_buf, request, true));
 
+	DHCP_PACKET **entry = dpc_xid_table_find(pl, request);
+	if (entry) return entry;
+
+	if (rbtree_num_elements(pl->tree) == 0) return NULL;
 	return rbtree_finddata(pl->tree, &request);
 }
 
@@ -422,10 +1113,20 @@ DHCP_PACKET **dpc_packet_list_find_byreply(dpc_packet_list_t *pl, DHCP_PACKET *r
 bool dpc_packet_list_yank(dpc_packet_list_t *pl, DHCP_PACKET *request)
 {
 	rbnode_t *node;
+	uint32_t idx;
 
 	dpc_assert(pl != NULL);
 	dpc_assert(request != NULL);
 
+	idx = request->id & pl->xid_mask;
+	if (pl->xid_table[idx] && *pl->xid_table[idx] == request) {
+		pl->xid_table[idx] = NULL;
+		pl->xid_table_num --;
+		return true;
+	}
+
+	if (rbtree_num_elements(pl->tree) == 0) return false;
+
 	node = rbtree_find(pl->tree, &request);
 	if (!node) return false;
 
@@ -441,7 +1142,7 @@ uint32_t dpc_packet_list_num_elements(dpc_packet_list_t *pl)
 {
 	if (!pl) return 0;
 
-	return rbtree_num_elements(pl->tree);
+	return pl->xid_table_num + rbtree_num_elements(pl->tree);
 }
 
 /*
@@ -455,13 +1156,15 @@ uint32_t dpc_packet_list_num_elements(dpc_packet_list_t *pl)
  *	otherwise) so we're almost certain to get an ID easily.
  *	If caller wants a specific ID, we try to comply, and if it's not available we fall back to
  *	the linear allocation mechanism.
+ *	If the ID is one we're reusing (flag "reuse"), it is put in the xid table if its slot is free.
  */
-bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **request_p)
+bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **request_p, bool reuse)
 {
 	int id;
 	dpc_packet_socket_t *ps;
 	DHCP_PACKET *request;
 	int tries = 0;
+	bool linear, inserted;
 
 	dpc_assert(pl != NULL);
 	dpc_assert(request_p != NULL);
@@ -487,11 +1190,22 @@ bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **r
 	//request->src_port = ps->src_port; /* Keep source port set by requestor. */
 
 	if (request->id == DPC_PACKET_ID_UNASSIGNED) {
-		id = ++ pl->prev_id;
+		id = dpc_xid_next(pl);
 		request->id = id;
+		linear = true;
 	} else {
-		 /* First try with the id they want. */
-		id = request->id;
+		/*
+		 *	First try with the id they want.
+		 *	If the xid space is sharded, it has to be in our shard, otherwise the reply would be delivered to
+		 *	another worker. So we map it into our shard (keeping its low bits).
+		 */
+		id = dpc_xid_to_shard(pl, request->id);
+		if (id != (int)request->id) {
+			DEBUG_TRACE("Requested xid %u (0x%08x) mapped into shard %u: %u (0x%08x)",
+			            request->id, request->id, pl->xid_shard, id, id);
+			request->id = id;
+		}
+		linear = false;
 	}
 
 	/*
@@ -507,8 +1221,12 @@ bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **r
 			/*
 			 *	Try to insert into the packet list. If successful, it means the ID was available.
 			*/
-			if (dpc_packet_list_insert(pl, request_p)) {
+			inserted = (linear || reuse) && dpc_xid_table_insert(pl, request_p);
+			if (!inserted && !linear) inserted = dpc_packet_list_insert(pl, request_p);
+
+			if (inserted) {
 				DEBUG_TRACE("Successful insert into packet list (allocated xid: %d)", request->id);
+				dpc_assert(dpc_xid_to_shard(pl, request->id) == request->id);
 				ps->num_outgoing ++;
 				pl->num_outgoing ++;
 				return true;
@@ -517,8 +1235,9 @@ bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **r
 
 		/* Otherwise, try another ID. */
 		tries ++;
-		id = ++ pl->prev_id;
+		id = dpc_xid_next(pl);
 		request->id = id;
+		linear = true;
 	}
 
 	DEBUG_TRACE("Giving up after %d tries, last xid tried: %d", tries, pl->prev_id);
@@ -562,13 +1281,14 @@ bool dpc_packet_list_id_free(dpc_packet_list_t *pl, DHCP_PACKET *request)
 	return true;
 }
 
+#ifndef DPC_WITH_EPOLL
 /*
  *	Loop over the list of sockets tied to the packet list. Prepare each socket
  *	for reception, calling FD_SET to update a fd_set structure.
  *	Return the highest-numbered fd of these sockets + 1.
  *	(ref: function fr_packet_list_fd_set from protocols/radius/list.c)
  */
-int dpc_packet_list_fd_set(dpc_packet_list_t *pl, fd_set *set)
+static int dpc_packet_list_fd_set(dpc_packet_list_t *pl, fd_set *set)
 {
 	int i, maxfd;
 
@@ -579,8 +1299,7 @@ int dpc_packet_list_fd_set(dpc_packet_list_t *pl, fd_set *set)
 
 	FD_ZERO(set); /* Clear the FD set. */
 
-	for (i = 0; i < DPC_MAX_SOCKETS; i++) {
-		if (pl->sockets[i].sockfd == -1) continue;
+	for (i = 0; i < pl->num_sockets; i++) {
 		FD_SET(pl->sockets[i].sockfd, set); /* Add the socket fd to the set. */
 		if (pl->sockets[i].sockfd > maxfd) {
 			maxfd = pl->sockets[i].sockfd;
@@ -591,32 +1310,496 @@ int dpc_packet_list_fd_set(dpc_packet_list_t *pl, fd_set *set)
 
 	return maxfd + 1;
 }
+#endif
+
+/*
+ *	Flag a socket as ready for reading (or not).
+ */
+static void dpc_socket_set_ready(dpc_packet_list_t *pl, dpc_packet_socket_t *ps, bool ready)
+{
+	if (ps->ready == ready) return;
+
+	ps->ready = ready;
+	pl->num_ready += (ready ? 1 : -1);
+}
+
+/*
+ *	Get the number of sockets from which something can be read without waiting: those flagged as ready, plus
+ *	the one from which datagrams are left in the receive ring (the kernel will not report these again).
+ */
+static inline int dpc_packet_list_pending(dpc_packet_list_t *pl)
+{
+#ifdef DPC_WITH_RECVMMSG
+	if (pl->ring && pl->ring->next < pl->ring->num && !pl->sockets[pl->ring->sock_idx].ready) {
+		return pl->num_ready + 1;
+	}
+#endif
+	return pl->num_ready;
+}
+
+/*
+ *	Wait until at least one of our sockets is ready for reading, spending at most ftd_wait_time doing so
+ *	(or not waiting at all if ftd_wait_time is NULL).
+ *	If some sockets have previously been reported ready and are not yet drained, or if datagrams are left in the
+ *	receive ring, return immediately.
+ *	Returns: number of sockets ready for reading, 0 if none, -1 on error.
+ */
+int dpc_packet_list_wait(dpc_packet_list_t *pl, fr_time_delta_t *ftd_wait_time)
+{
+	int i, num_events;
+
+	dpc_assert(pl != NULL);
+
+	if (dpc_packet_list_pending(pl) > 0) return dpc_packet_list_pending(pl);
+	if (pl->num_sockets == 0) return 0; /* No sockets to listen on! */
+
+#ifdef DPC_WITH_EPOLL
+	struct epoll_event events[DPC_MAX_SOCKETS];
+	int timeout_ms = 0;
+
+	if (ftd_wait_time && *ftd_wait_time > 0) {
+		/* epoll has a millisecond granularity. Round up so we don't spin until the next event is due. */
+		timeout_ms = (*ftd_wait_time + 999999) / 1000000;
+		DEBUG_TRACE("Max wait time: %d ms", timeout_ms);
+	}
+
+	num_events = epoll_wait(pl->epfd, events, DPC_MAX_SOCKETS, timeout_ms);
+	if (num_events < 0) {
+		if (errno == EINTR) return 0;
+		fr_strerror_printf("epoll_wait failed: %s", fr_syserror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < num_events; i++) {
+		uint32_t idx = events[i].data.u32;
+		if (idx >= (uint32_t)pl->num_sockets) continue;
+
+#ifdef DPC_WITH_TIMESTAMPING
+		/* Transmit timestamps are reported through the error queue. */
+		if (events[i].events & EPOLLERR) dpc_socket_errqueue_drain(&pl->sockets[idx]);
+		if (!(events[i].events & EPOLLIN)) continue;
+#endif
+		dpc_socket_set_ready(pl, &pl->sockets[idx], true);
+	}
+#else
+	fd_set set;
+	struct timeval tvi_wait = { 0 };
+	int max_fd;
+
+	max_fd = dpc_packet_list_fd_set(pl, &set);
+	if (max_fd < 0) return 0;
+
+	if (ftd_wait_time) {
+		tvi_wait = fr_time_delta_to_timeval(*ftd_wait_time);
+		DEBUG_TRACE("Max wait time: %.6f", ncc_timeval_to_float(&tvi_wait));
+	}
+
+	num_events = select(max_fd, &set, NULL, NULL, &tvi_wait);
+	if (num_events <= 0) return 0;
+
+	for (i = 0; i < pl->num_sockets; i++) {
+		if (FD_ISSET(pl->sockets[i].sockfd, &set)) dpc_socket_set_ready(pl, &pl->sockets[i], true);
+	}
+#endif
+
+	return dpc_packet_list_pending(pl);
+}
+
+/*
+ *	Get the number of sockets currently flagged as ready for reading (counting datagrams left in the receive ring).
+ */
+int dpc_packet_list_num_ready(dpc_packet_list_t *pl)
+{
+	if (!pl) return 0;
+
+	return dpc_packet_list_pending(pl);
+}
+
+#ifdef DPC_WITH_SENDMMSG
+/*
+ *	Send all packets queued on a socket, with as few system calls as possible.
+ *	The send timestamp of each packet is taken right before the system call through which it is sent.
+ *	Returns: number of packets which could not be sent.
+ */
+static uint32_t dpc_send_queue_flush(dpc_packet_list_t *pl, dpc_packet_socket_t *ps)
+{
+	dpc_send_queue_t *sq = ps->send_queue;
+	uint32_t i, done = 0, num_failed = 0;
+
+	if (!sq || sq->num == 0) return 0;
+
+	while (done < sq->num) {
+		fr_time_t now = fr_time();
+		int num = sendmmsg(ps->sockfd, &sq->msgs[done], sq->num - done, 0);
+
+		if (num <= 0) {
+			/*
+			 *	Give up on the first packet which could not be sent (sendmmsg only reports an error
+			 *	if it failed to send anything), and try again with the following ones.
+			 */
+			int err = errno;
+			fr_strerror_printf("sendmmsg failed: %s", fr_syserror(err));
+
+			DHCP_PACKET *packet = *sq->packets[done];
+			packet->timestamp = now;
+			errno = err; /* So the callback can tell why. */
+			pl->send_cb(sq->packets[done], false);
+
+			num_failed ++;
+			done ++;
+			continue;
+		}
+
+		DEBUG_TRACE("Sent batch of %d packet(s) on socket fd: %d", num, ps->sockfd);
+
+		for (i = done; i < done + num; i++) {
+			DHCP_PACKET *packet = *sq->packets[i];
+			packet->timestamp = now;
+			pl->send_cb(sq->packets[i], true);
+		}
+		done += num;
+	}
+
+	pl->num_queued -= sq->num;
+	sq->num = 0;
+
+	return num_failed;
+}
+#endif
+
+/*
+ *	Queue an encoded packet for sending. Packets are actually sent when the queue of their socket is full,
+ *	or when dpc_packet_list_send_flush is called. The callback is then called for each of them.
+ *	The packet must be in the packet list (so it has been assigned a socket), and must remain there until sent.
+ *	If batched transmission is not supported on this system, the packet is sent right away, and the callback is
+ *	not called: the caller handles the packet as if it had sent it itself.
+ *	Returns: -1 = error (the packet was not queued, or could not be sent), 0 = packet queued, 1 = packet sent.
+ */
+int dpc_packet_list_send_enqueue(dpc_packet_list_t *pl, DHCP_PACKET **packet_p)
+{
+	DHCP_PACKET *packet;
+	dpc_packet_socket_t *ps;
+
+	dpc_assert(pl != NULL);
+	dpc_assert(packet_p != NULL && *packet_p != NULL);
+	dpc_assert(pl->send_batch > 0);
+
+	packet = *packet_p;
+	dpc_assert(packet->data != NULL);
+
+	ps = dpc_socket_find(pl, packet->sockfd);
+	if (!ps) {
+		fr_strerror_printf("Failed to find socket in packet list, fd: %d", packet->sockfd);
+		return -1;
+	}
+
+#ifndef DPC_WITH_SENDMMSG
+	/* No batching available, just send it now. */
+	packet->timestamp = fr_time();
+	if (fr_dhcpv4_udp_packet_send(packet) < 0) return -1;
+	return 1;
+#else
+	dpc_send_queue_t *sq = ps->send_queue;
+
+	if (!sq) {
+		MEM(sq = talloc_zero(pl, dpc_send_queue_t));
+		MEM(sq->packets = talloc_array(sq, DHCP_PACKET **, pl->send_batch));
+		MEM(sq->msgs = talloc_zero_array(sq, struct mmsghdr, pl->send_batch));
+		MEM(sq->iov = talloc_zero_array(sq, struct iovec, pl->send_batch));
+		MEM(sq->dst = talloc_zero_array(sq, struct sockaddr_storage, pl->send_batch));
+		MEM(sq->control = talloc_zero_array(sq, uint8_t, DPC_SEND_CONTROL_LEN * pl->send_batch));
+		ps->send_queue = sq;
+	}
+
+	/*
+	 *	If the queue is full, flush it before adding a new packet.
+	 *	This way the packet we're given is never sent (nor reported to the callback) before we return.
+	 */
+	if (sq->num == pl->send_batch) dpc_send_queue_flush(pl, ps);
+
+	uint32_t i = sq->num;
+	socklen_t dst_len;
+
+	if (fr_ipaddr_to_sockaddr(&packet->dst_ipaddr, packet->dst_port, &sq->dst[i], &dst_len) < 0) {
+		return -1;
+	}
+
+	sq->iov[i].iov_base = packet->data;
+	sq->iov[i].iov_len = packet->data_len;
+
+	memset(&sq->msgs[i], 0, sizeof(sq->msgs[i]));
+	sq->msgs[i].msg_hdr.msg_name = &sq->dst[i];
+	sq->msgs[i].msg_hdr.msg_namelen = dst_len;
+	sq->msgs[i].msg_hdr.msg_iov = &sq->iov[i];
+	sq->msgs[i].msg_hdr.msg_iovlen = 1;
+
+	/*
+	 *	Set the source address (and interface) the packet is sent from, as sendfromto does.
+	 */
+	if (packet->src_ipaddr.af == AF_INET && packet->src_ipaddr.addr.v4.s_addr != INADDR_ANY) {
+		uint8_t *control = &sq->control[i * DPC_SEND_CONTROL_LEN];
+		struct cmsghdr *cmsg;
+		struct in_pktinfo *pktinfo;
+
+		memset(control, 0, DPC_SEND_CONTROL_LEN);
+		sq->msgs[i].msg_hdr.msg_control = control;
+		sq->msgs[i].msg_hdr.msg_controllen = DPC_SEND_CONTROL_LEN;
+
+		cmsg = CMSG_FIRSTHDR(&sq->msgs[i].msg_hdr);
+		cmsg->cmsg_level = IPPROTO_IP;
+		cmsg->cmsg_type = IP_PKTINFO;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+
+		pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+		pktinfo->ipi_spec_dst = packet->src_ipaddr.addr.v4;
+		pktinfo->ipi_ifindex = packet->if_index;
+	}
+
+	sq->packets[i] = packet_p;
+	sq->num ++;
+	pl->num_queued ++;
+
+	return 0;
+#endif
+}
+
+/*
+ *	Send all queued packets, on all sockets.
+ *	Returns: number of packets which could not be sent.
+ */
+uint32_t dpc_packet_list_send_flush(dpc_packet_list_t *pl)
+{
+	uint32_t num_failed = 0;
+
+	dpc_assert(pl != NULL);
+
+	if (pl->num_queued == 0) return 0;
+
+#ifdef DPC_WITH_SENDMMSG
+	int i;
+	for (i = 0; i < pl->num_sockets; i++) {
+		num_failed += dpc_send_queue_flush(pl, &pl->sockets[i]);
+	}
+#endif
+
+	return num_failed;
+}
+
+#ifdef DPC_WITH_RECVMMSG
+/*
+ *	Fill the receive ring with as many datagrams as are available from a socket (up to the ring size),
+ *	using a single system call.
+ *	Returns: number of datagrams received, 0 if socket is drained, -1 on error.
+ */
+static int dpc_recv_ring_fill(dpc_packet_list_t *pl, int sock_idx)
+{
+	dpc_recv_ring_t *ring = pl->ring;
+	dpc_packet_socket_t *ps = &pl->sockets[sock_idx];
+	uint32_t i;
+	int num;
+
+	/* Reset what the kernel overwrites on each call. */
+	for (i = 0; i < ring->size; i++) {
+		ring->msgs[i].msg_len = 0;
+		ring->msgs[i].msg_hdr.msg_namelen = sizeof(ring->slots[i].src);
+		ring->msgs[i].msg_hdr.msg_controllen = sizeof(ring->slots[i].control);
+		ring->msgs[i].msg_hdr.msg_flags = 0;
+	}
+
+	num = recvmmsg(ps->sockfd, ring->msgs, ring->size, MSG_DONTWAIT, NULL);
+	if (num < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+
+		fr_strerror_printf("recvmmsg failed: %s", fr_syserror(errno));
+		return -1;
+	}
+
+	ring->timestamp = fr_time(); /* Shared by all the datagrams of this batch. */
+	ring->sock_idx = sock_idx;
+	ring->num = num;
+	ring->next = 0;
+
+	DEBUG_TRACE("Received batch of %d datagram(s) on socket fd: %d", num, ps->sockfd);
+	return num;
+}
+
+/*
+ *	Allocate a DHCP packet from data received.
+ *	(ref: function fr_dhcpv4_packet_alloc from protocols/dhcpv4/packet.c, which always allocates on the NULL context)
+ */
+static DHCP_PACKET *dpc_reply_packet_alloc(TALLOC_CTX *ctx, uint8_t const *data, size_t data_len)
+{
+	DHCP_PACKET *packet;
+	uint8_t const *code;
+	uint32_t value;
+
+	memcpy(&value, data + 236, 4);
+	if (ntohl(value) != DHCP_OPTION_MAGIC_NUMBER) return NULL;
+
+	code = fr_dhcpv4_packet_get_option((dhcp_packet_t const *) data, data_len, attr_dhcp_message_type);
+	if (!code || code[1] < 1) return NULL;
+
+	MEM(packet = fr_radius_alloc(ctx, false));
+
+	packet->code = code[2];
+	memcpy(&value, data + 4, 4);
+	packet->id = ntohl(value);
+
+	MEM(packet->data = talloc_memdup(packet, data, data_len));
+	talloc_set_type(packet->data, uint8_t);
+	packet->data_len = data_len;
+
+	return packet;
+}
+
+/*
+ *	Get the next datagram from the receive ring, and check if it is a reply to one of our requests.
+ *	Only if it is, a DHCP packet is allocated. Otherwise it is discarded (and counted as unexpected).
+ */
+static DHCP_PACKET *dpc_recv_ring_next(dpc_packet_list_t *pl, uint32_t *num_unexpected)
+{
+	dpc_recv_ring_t *ring = pl->ring;
+	dpc_packet_socket_t *ps;
+	DHCP_PACKET *packet, **packet_p;
+
+	if (ring->sock_idx < 0) return NULL;
+	ps = &pl->sockets[ring->sock_idx];
+
+	while (ring->next < ring->num) {
+		dpc_recv_slot_t *slot = &ring->slots[ring->next];
+		struct msghdr *hdr = &ring->msgs[ring->next].msg_hdr;
+		size_t data_len = ring->msgs[ring->next].msg_len;
+		struct cmsghdr *cmsg;
+		uint32_t xid;
+
+		ring->next ++;
+
+		if (data_len < DPC_RECV_MIN_LEN || (hdr->msg_flags & MSG_TRUNC)) {
+			DEBUG("Discarding malformed datagram (length: %zu) received on socket fd: %d", data_len, ps->sockfd);
+			continue;
+		}
+
+		/*
+		 *	Build a reply stub from the raw datagram, with just what we need to look for the request.
+		 */
+		DHCP_PACKET reply = {
+			.sockfd = ps->sockfd,
+			.dst_ipaddr = ps->src_ipaddr,
+			.dst_port = ps->src_port,
+			.data = slot->data,
+			.data_len = data_len,
+		};
+
+		memcpy(&xid, slot->data + 4, 4);
+		reply.id = ntohl(xid);
+
+		if (fr_ipaddr_from_sockaddr(&slot->src, hdr->msg_namelen, &reply.src_ipaddr, &reply.src_port) < 0) {
+			continue;
+		}
+
+#ifdef DPC_WITH_TIMESTAMPING
+		dpc_tstamp_t rx_tstamp = { 0 };
+#endif
+		for (cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+#ifdef DPC_WITH_TIMESTAMPING
+			if (dpc_cmsg_tstamp_get(&rx_tstamp, cmsg)) continue;
+#endif
+			if (cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+				struct in_pktinfo *pktinfo = (struct in_pktinfo *)CMSG_DATA(cmsg);
+
+				reply.dst_ipaddr.af = AF_INET;
+				reply.dst_ipaddr.prefix = 32;
+				reply.dst_ipaddr.addr.v4 = pktinfo->ipi_addr;
+				reply.if_index = pktinfo->ipi_ifindex;
+			}
+		}
+
+		packet_p = dpc_packet_list_find_byreply(pl, &reply);
+		if (!packet_p) {
+			char from_to_buf[DPC_FROM_TO_STRLEN] = "";
+			DEBUG("Received unexpected packet Id %u (0x%08x) %s length %zu",
+			      reply.id, reply.id, dpc_packet_from_to_sprint(from_to_buf, &reply, false), data_len);
+
+			if (num_unexpected) (*num_unexpected) ++;
+			continue;
+		}
+
+		/*
+		 *	This is a reply we're interested in. Now get a real packet, allocated in the same talloc context
+		 *	as the request it answers (which may be a pool, so this does not necessarily entail a malloc).
+		 */
+		packet = dpc_reply_packet_alloc(talloc_parent(*packet_p), slot->data, data_len);
+		if (!packet) continue; /* Not a valid DHCP packet. */
+
+		packet->sockfd = reply.sockfd;
+		packet->src_ipaddr = reply.src_ipaddr;
+		packet->src_port = reply.src_port;
+		packet->dst_ipaddr = reply.dst_ipaddr;
+		packet->dst_port = reply.dst_port;
+		packet->if_index = reply.if_index;
+		packet->timestamp = ring->timestamp;
+#ifdef DPC_WITH_TIMESTAMPING
+		pl->rx_tstamp = rx_tstamp;
+#endif
+
+		return packet;
+	}
+
+	return NULL;
+}
+#endif
 
 /*
- *	The FD set is ready for reading.
- *	Loop over the list of sockets tied to the packet list.
+ *	Loop over the sockets which have been reported ready for reading.
  *	Receive the first incoming packet found.
+ *	A socket which has nothing more to read is no longer flagged as ready.
  *	(ref: function fr_packet_list_recv from protocols/radius/list.c)
  */
-DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, fd_set *set)
+DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, uint32_t *num_unexpected)
 {
 	int start;
 	DHCP_PACKET *packet;
 	dpc_packet_socket_t *ps;
 
 	dpc_assert(pl != NULL);
-	dpc_assert(set != NULL);
+
+#ifdef DPC_WITH_RECVMMSG
+	/* First handle what's left from the previous batch. */
+	if (pl->ring && (packet = dpc_recv_ring_next(pl, num_unexpected))) return packet;
+#endif
+
+	if (pl->num_ready == 0 || pl->num_sockets == 0) return NULL;
 
 	start = pl->last_recv;
 	do {
-		start = (start + 1) % DPC_MAX_SOCKETS;
+		start = (start + 1) % pl->num_sockets;
 		ps = &pl->sockets[start];
 
-		if (ps->sockfd == -1) continue;
+		if (!ps->ready) continue;
+
+#ifdef DPC_WITH_RECVMMSG
+		/*
+		 *	Batched reception (not for the pcap socket).
+		 *	The socket is drained only if the kernel says so (EAGAIN), or if we got less datagrams than we asked
+		 *	for. On error, it remains flagged as ready: there may be more to read.
+		 */
+		if (pl->ring && ps->edge_triggered) {
+			int num = dpc_recv_ring_fill(pl, start);
+			if (num < 0) {
+				pl->last_recv = start;
+				return NULL;
+			}
+			if ((uint32_t)num < pl->ring->size) dpc_socket_set_ready(pl, ps, false);
 
-		if (!FD_ISSET(ps->sockfd, set)) continue;
+			pl->last_recv = start;
+			packet = dpc_recv_ring_next(pl, num_unexpected);
+			if (packet) return packet;
+			continue;
+		}
+#endif
 
 		/* Using either udp or pcap socket for reception. */
+		errno = 0;
 #ifdef HAVE_LIBPCAP
 		if (ps->pcap) {
 			packet = fr_dhcpv4_pcap_recv(ps->pcap);
@@ -626,7 +1809,21 @@ DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, fd_set *set)
 		{
 			packet = fr_dhcpv4_udp_packet_recv(ps->sockfd);
 		}
-		if (!packet) continue;
+		if (!packet) {
+#ifdef DPC_WITH_EPOLL
+			/*
+			 *	With an edge-triggered socket, we're done only if the kernel says so.
+			 *	Otherwise we just got a bad datagram, and there may be more to read.
+			 */
+			if (ps->edge_triggered && errno != EAGAIN && errno != EWOULDBLOCK) {
+				pl->last_recv = start;
+				return NULL;
+			}
+#endif
+			/* Nothing more to read from this socket for now. */
+			dpc_socket_set_ready(pl, ps, false);
+			continue;
+		}
 
 		/*
 		 *	We've received a packet, but are not guaranteed this was an expected reply.
@@ -634,10 +1831,13 @@ DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, fd_set *set)
 		 */
 		DEBUG_TRACE("Received packet on socket fd: %d (index in array: %d)", ps->sockfd, start);
 
+#ifdef DPC_WITH_TIMESTAMPING
+		memset(&pl->rx_tstamp, 0, sizeof(pl->rx_tstamp)); /* Not available. */
+#endif
 		pl->last_recv = start;
 		return packet;
 
-	} while (start != pl->last_recv);
+	} while (pl->num_ready > 0);
 
 	return NULL;
 }
@@ -8,23 +8,50 @@
 
 typedef struct dpc_packet_list dpc_packet_list_t;
 
+/*
+ *	Packet timestamping modes (SO_TIMESTAMPING).
+ */
+typedef enum {
+	DPC_TIMESTAMPING_NONE = 0,
+	DPC_TIMESTAMPING_SOFTWARE,     //!< Kernel timestamps.
+	DPC_TIMESTAMPING_HARDWARE      //!< NIC timestamps (if supported and enabled on the interface), else kernel.
+} dpc_timestamping_t;
+
+/*
+ *	Callback invoked for a queued packet once it has been sent (or has failed to be, in which case errno tells why).
+ */
+typedef void (*dpc_packet_sent_t)(DHCP_PACKET **packet_p, bool sent);
+
 
 void dpc_packet_list_free(dpc_packet_list_t *pl);
 dpc_packet_list_t *dpc_packet_list_create(TALLOC_CTX *ctx, uint32_t base_id);
+int dpc_packet_list_set_recv_batch(dpc_packet_list_t *pl, uint32_t num);
+int dpc_packet_list_set_send_batch(dpc_packet_list_t *pl, uint32_t num, dpc_packet_sent_t cb);
+int dpc_packet_list_set_timestamping(dpc_packet_list_t *pl, dpc_timestamping_t mode);
+int dpc_packet_list_set_xid_shard(dpc_packet_list_t *pl, uint32_t shard, uint32_t num_shards);
 
 #ifdef HAVE_LIBPCAP
 void dpc_pcap_filter_build(dpc_packet_list_t *pl, fr_pcap_t *pcap);
 int dpc_pcap_socket_add(dpc_packet_list_t *pl, fr_pcap_t *pcap, fr_ipaddr_t *src_ipaddr, uint16_t src_port);
 #endif
 int dpc_socket_provide(dpc_packet_list_t *pl, fr_ipaddr_t *src_ipaddr, uint16_t src_port);
+int dpc_socket_group_open(fr_ipaddr_t *src_ipaddr, uint16_t src_port, uint32_t num, int *fds);
+int dpc_socket_adopt(dpc_packet_list_t *pl, int sockfd, fr_ipaddr_t *src_ipaddr, uint16_t src_port);
 
 bool dpc_packet_list_insert(dpc_packet_list_t *pl, DHCP_PACKET **request_p);
 DHCP_PACKET **dpc_packet_list_find_byreply(dpc_packet_list_t *pl, DHCP_PACKET *reply);
 bool dpc_packet_list_yank(dpc_packet_list_t *pl, DHCP_PACKET *request);
 uint32_t dpc_packet_list_num_elements(dpc_packet_list_t *pl);
 
-bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **request_p);
+bool dpc_packet_list_id_alloc(dpc_packet_list_t *pl, int sockfd, DHCP_PACKET **request_p, bool reuse);
 bool dpc_packet_list_id_free(dpc_packet_list_t *pl, DHCP_PACKET *request);
 
-int dpc_packet_list_fd_set(dpc_packet_list_t *pl, fd_set *set);
-DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, fd_set *set);
+int dpc_packet_list_wait(dpc_packet_list_t *pl, fr_time_delta_t *ftd_wait_time);
+int dpc_packet_list_num_ready(dpc_packet_list_t *pl);
+DHCP_PACKET *dpc_packet_list_recv(dpc_packet_list_t *pl, uint32_t *num_unexpected);
+
+int dpc_packet_list_send_enqueue(dpc_packet_list_t *pl, DHCP_PACKET **packet_p);
+uint32_t dpc_packet_list_send_flush(dpc_packet_list_t *pl);
+
+bool dpc_packet_list_tx_key(dpc_packet_list_t *pl, int sockfd, uint32_t *key);
+bool dpc_packet_list_wire_rtt(dpc_packet_list_t *pl, int sockfd, uint32_t key, fr_time_delta_t *rtt);
@@ -0,0 +1,521 @@
+/**
+ * @file dpc_population.c
+ * @brief Simulated client population.
+ *
+ * A large number of DHCP clients, each of which acquires a lease (DORA), then renews it at T1 (unicast Request to
+ * the server which granted it), and rebinds it after T2 (Request to any server), as real clients would.
+ *
+ * Leases are held in a lease store (struct of arrays, with times stored as 32 bits offsets in seconds from the
+ * creation of the population). The state of clients, and their scheduling, are kept in arrays of their own.
+ * Clients which are not due yet are kept in a timing wheel of one second slots, so that finding the clients which
+ * are due costs nothing more than going through them.
+ */
+
+#include "dhcperfcli.h"
+#include "dpc_population.h"
+
+
+#define DPC_POPULATION_WHEEL_SIZE  4096 /* Number of one second slots of the timing wheel (must be a power of 2). */
+
+#define DPC_CLIENT_IN_PROGRESS     0x80 /* Flag (in client state): a session is ongoing on behalf of this client. */
+#define DPC_CLIENT_STATE(_s)       ((_s) & ~DPC_CLIENT_IN_PROGRESS)
+
+#define DPC_CLIENT_RETRY_DELAY     10   /* Delay (s) before a client which failed to acquire a lease tries again. */
+#define DPC_CLIENT_RENEW_MIN       60   /* Min delay (s) between two attempts to renew or rebind a lease. */
+
+struct dpc_population {
+	uint32_t num;             //!< Number of clients.
+	dpc_lease_store_t *store; //!< Leases of the clients.
+
+	uint8_t *state;           //!< State of each client (dpc_client_state_t, and flag DPC_CLIENT_IN_PROGRESS).
+	uint32_t *due;            //!< When each client is next due to act.
+	uint32_t *next;           //!< Next client in the same list (timer slot, or ready list).
+
+	fr_time_t fte_base;       //!< Origin of time offsets (the origin of the lease store, on our own clock).
+
+	uint32_t wheel[DPC_POPULATION_WHEEL_SIZE]; //!< First client of each timer slot.
+	uint32_t wheel_pos;       //!< Next time offset which has to be handled.
+	uint32_t num_scheduled;   //!< Number of clients in the timing wheel.
+
+	uint32_t ready_head;      //!< First client which is ready to act.
+	uint32_t ready_tail;      //!< Last client which is ready to act.
+	uint32_t num_ready;       //!< Number of clients ready to act.
+
+	dpc_population_stats_t stats;
+};
+
+
+/*
+ *	Get the current time offset (in seconds).
+ */
+static inline uint32_t dpc_population_now(dpc_population_t *pop)
+{
+	return (fr_time() - pop->fte_base) / NSEC;
+}
+
+/*
+ *	Set the origin of time offsets, from the origin of the lease store (wall clock, in seconds).
+ *	Both clocks are read together, so that offset 0 is the exact second "store->base" on our own clock, and offsets
+ *	we compute are the ones the lease store dumps and loads.
+ */
+static void dpc_population_base_set(dpc_population_t *pop)
+{
+	struct timespec ts;
+	fr_time_t now;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	now = fr_time();
+
+	pop->fte_base = now - (fr_time_t)(ts.tv_sec - pop->store->base) * NSEC - ts.tv_nsec;
+}
+
+/*
+ *	Add a delay to a time offset, capping the result so it never reaches "infinite".
+ */
+static inline uint32_t dpc_population_offset_add(uint32_t offset, uint32_t delay)
+{
+	uint64_t value = (uint64_t)offset + delay;
+
+	return (value >= DPC_LEASE_INFINITE) ? DPC_LEASE_INFINITE - 1 : value;
+}
+
+/*
+ *	Change the state of a client (clearing its in progress flag), keeping track of how many clients are in each state.
+ */
+static inline void dpc_client_state_set(dpc_population_t *pop, uint32_t idx, dpc_client_state_t state)
+{
+	pop->stats.num_state[DPC_CLIENT_STATE(pop->state[idx])] --;
+	pop->stats.num_state[state] ++;
+	pop->state[idx] = state;
+}
+
+/*
+ *	Append a client to the ready list.
+ */
+static void dpc_population_ready_push(dpc_population_t *pop, uint32_t idx)
+{
+	pop->next[idx] = DPC_CLIENT_NONE;
+
+	if (pop->ready_tail == DPC_CLIENT_NONE) {
+		pop->ready_head = idx;
+	} else {
+		pop->next[pop->ready_tail] = idx;
+	}
+	pop->ready_tail = idx;
+	pop->num_ready ++;
+}
+
+/*
+ *	Schedule a client to act at a given time offset.
+ *	If it is already due, it is ready right away. Otherwise it is put in the timing wheel.
+ */
+static void dpc_population_schedule(dpc_population_t *pop, uint32_t idx, uint32_t due)
+{
+	uint32_t slot;
+
+	pop->due[idx] = due;
+
+	if (due < pop->wheel_pos) {
+		dpc_population_ready_push(pop, idx);
+		return;
+	}
+
+	slot = due & (DPC_POPULATION_WHEEL_SIZE - 1);
+	pop->next[idx] = pop->wheel[slot];
+	pop->wheel[slot] = idx;
+	pop->num_scheduled ++;
+}
+
+/*
+ *	Move the clients which are due from the timing wheel to the ready list.
+ *	Clients due more than one turn of the wheel later are left in their slot.
+ */
+static void dpc_population_advance(dpc_population_t *pop)
+{
+	uint32_t now = dpc_population_now(pop);
+	uint32_t i, n;
+
+	if (now < pop->wheel_pos) return;
+
+	if (!pop->num_scheduled) {
+		pop->wheel_pos = now + 1;
+		return;
+	}
+
+	n = now - pop->wheel_pos + 1;
+	if (n > DPC_POPULATION_WHEEL_SIZE) n = DPC_POPULATION_WHEEL_SIZE; /* Each slot need only be handled once. */
+
+	for (i = 0; i < n; i++) {
+		uint32_t slot = (pop->wheel_pos + i) & (DPC_POPULATION_WHEEL_SIZE - 1);
+		uint32_t idx = pop->wheel[slot];
+		uint32_t keep = DPC_CLIENT_NONE;
+
+		while (idx != DPC_CLIENT_NONE) {
+			uint32_t next = pop->next[idx];
+
+			if (pop->due[idx] <= now) {
+				pop->num_scheduled --;
+				dpc_population_ready_push(pop, idx);
+			} else {
+				pop->next[idx] = keep;
+				keep = idx;
+			}
+			idx = next;
+		}
+		pop->wheel[slot] = keep;
+	}
+
+	pop->wheel_pos = now + 1;
+}
+
+/*
+ *	(Re)build the schedule of all clients: those which hold a lease are due at T1, the others are ready right away.
+ */
+static void dpc_population_schedule_all(dpc_population_t *pop)
+{
+	dpc_lease_store_t *store = pop->store;
+	uint32_t i;
+
+	for (i = 0; i < DPC_POPULATION_WHEEL_SIZE; i++) {
+		pop->wheel[i] = DPC_CLIENT_NONE;
+	}
+	pop->num_scheduled = 0;
+	pop->ready_head = pop->ready_tail = DPC_CLIENT_NONE;
+	pop->num_ready = 0;
+
+	for (i = 0; i < pop->num; i++) {
+		if (store->yiaddr[i]) {
+			dpc_client_state_set(pop, i, DPC_CLIENT_BOUND);
+			/* Infinite lease: there is nothing more to do for this client. */
+			if (store->t1[i] != DPC_LEASE_INFINITE) dpc_population_schedule(pop, i, store->t1[i]);
+		} else {
+			dpc_client_state_set(pop, i, DPC_CLIENT_INIT);
+			dpc_population_ready_push(pop, i);
+		}
+	}
+}
+
+/*
+ *	Create a population of clients. They all start without a lease, and are ready to acquire one.
+ *	Client hardware addresses are 02:00:xx:xx:xx:xx (locally administered), xx being the client index (starting
+ *	from "first").
+ */
+dpc_population_t *dpc_population_create(TALLOC_CTX *ctx, uint32_t first, uint32_t num)
+{
+	dpc_population_t *pop;
+	uint8_t chaddr[6] = { 0x02, 0x00 };
+	uint32_t i;
+
+	MEM(pop = talloc_zero(ctx, dpc_population_t));
+
+	pop->store = dpc_lease_store_create(pop, num);
+	if (!pop->store) goto error;
+
+	pop->state = talloc_zero_array(pop, uint8_t, num);
+	pop->due = talloc_array(pop, uint32_t, num);
+	pop->next = talloc_array(pop, uint32_t, num);
+	if (!pop->state || !pop->due || !pop->next) {
+		fr_strerror_printf("Failed to allocate %u clients", num);
+		goto error;
+	}
+
+	pop->num = num;
+	dpc_population_base_set(pop);
+
+	pop->stats.num = num;
+	pop->stats.num_state[DPC_CLIENT_INIT] = num;
+
+	for (i = 0; i < num; i++) {
+		uint32_t hw = htonl(first + i);
+
+		memcpy(&chaddr[2], &hw, 4);
+		if (dpc_lease_store_chaddr_set(pop->store, i, chaddr) < 0) goto error;
+	}
+
+	dpc_population_schedule_all(pop);
+
+	return pop;
+
+error:
+	talloc_free(pop);
+	return NULL;
+}
+
+/*
+ *	Get the number of clients.
+ */
+uint32_t dpc_population_num(dpc_population_t *pop)
+{
+	return pop->num;
+}
+
+/*
+ *	Get the leases of the clients.
+ */
+dpc_lease_store_t *dpc_population_store(dpc_population_t *pop)
+{
+	return pop->store;
+}
+
+/*
+ *	Get the population statistics.
+ */
+dpc_population_stats_t const *dpc_population_stats(dpc_population_t *pop)
+{
+	return &pop->stats;
+}
+
+/*
+ *	Load leases acquired by a previous run, before clients start acting. Clients which get a lease from the file
+ *	will renew it at T1 (or right away, if T1 is past), instead of acquiring a new one.
+ *	Returns the number of leases loaded, or -1 on error.
+ */
+int dpc_population_load(dpc_population_t *pop, char const *filename)
+{
+	int ret;
+
+	ret = dpc_lease_store_load(pop->store, filename, dpc_population_now(pop));
+	if (ret < 0) return -1;
+
+	dpc_population_schedule_all(pop);
+	return ret;
+}
+
+/*
+ *	Save the leases the clients currently hold, so a later run can use them.
+ *	Returns the number of leases saved, or -1 on error.
+ */
+int dpc_population_save(dpc_population_t *pop, char const *filename)
+{
+	return dpc_lease_store_dump(pop->store, filename, dpc_population_now(pop));
+}
+
+/*
+ *	Get the number of clients which are ready to act right now.
+ */
+uint32_t dpc_population_num_ready(dpc_population_t *pop)
+{
+	dpc_population_advance(pop);
+	return pop->num_ready;
+}
+
+/*
+ *	Get the time at which clients may next become ready to act.
+ *	Returns 0 if there is no such time to wait for (clients are ready right now, or none is scheduled).
+ */
+fr_time_t dpc_population_next_event(dpc_population_t *pop)
+{
+	dpc_population_advance(pop);
+
+	if (pop->num_ready || !pop->num_scheduled) return 0;
+	return pop->fte_base + (fr_time_t)pop->wheel_pos * NSEC;
+}
+
+/*
+ *	Get the next client which is ready to act, and remove it from the ready list.
+ *	Returns DPC_CLIENT_NONE if there is none.
+ */
+uint32_t dpc_population_ready_get(dpc_population_t *pop)
+{
+	uint32_t idx;
+
+	dpc_population_advance(pop);
+
+	idx = pop->ready_head;
+	if (idx == DPC_CLIENT_NONE) return DPC_CLIENT_NONE;
+
+	pop->ready_head = pop->next[idx];
+	if (pop->ready_head == DPC_CLIENT_NONE) pop->ready_tail = DPC_CLIENT_NONE;
+	pop->num_ready --;
+
+	pop->next[idx] = DPC_CLIENT_NONE;
+	return idx;
+}
+
+/*
+ *	A client which was ready is about to act: figure out what it has to do, according to its lease.
+ *	Returns the state the client is now in: selecting (acquire a lease), renewing, or rebinding.
+ */
+dpc_client_state_t dpc_population_client_start(dpc_population_t *pop, uint32_t idx)
+{
+	dpc_lease_store_t *store = pop->store;
+	uint32_t now = dpc_population_now(pop);
+	dpc_client_state_t state = DPC_CLIENT_STATE(pop->state[idx]);
+
+	switch (state) {
+	case DPC_CLIENT_INIT:
+	case DPC_CLIENT_SELECTING:
+		state = DPC_CLIENT_SELECTING;
+		break;
+
+	default:
+		if (now >= store->expiry[idx]) {
+			/* Too late, the lease is lost. Start over. */
+			pop->stats.num_expired ++;
+			dpc_lease_store_clear(store, idx);
+			state = DPC_CLIENT_SELECTING;
+
+		} else if (now >= store->t2[idx]) {
+			state = DPC_CLIENT_REBINDING;
+
+		} else if (state == DPC_CLIENT_BOUND) {
+			state = DPC_CLIENT_RENEWING;
+		}
+		break;
+	}
+
+	dpc_client_state_set(pop, idx, state);
+	pop->state[idx] |= DPC_CLIENT_IN_PROGRESS;
+
+	return state;
+}
+
+/*
+ *	A client has been granted a lease (or an extension of its lease). Schedule its renewal at T1.
+ *	If the server does not provide T1 and T2, they default to 0.5 and 0.875 times the lease duration
+ *	(RFC 2131, section 4.4.5).
+ */
+void dpc_population_client_ack(dpc_population_t *pop, uint32_t idx, dpc_reply_info_t const *info)
+{
+	dpc_lease_store_t *store = pop->store;
+	uint32_t now = dpc_population_now(pop);
+	uint32_t lease_time = info->lease_time;
+	uint32_t t1, t2;
+
+	/* Not waiting for this (e.g. Ack to a retransmitted request). */
+	if (!(pop->state[idx] & DPC_CLIENT_IN_PROGRESS)) return;
+
+	switch (DPC_CLIENT_STATE(pop->state[idx])) {
+	case DPC_CLIENT_SELECTING:
+		pop->stats.num_acquired ++;
+		break;
+
+	case DPC_CLIENT_RENEWING:
+		pop->stats.num_renewed ++;
+		break;
+
+	case DPC_CLIENT_REBINDING:
+		pop->stats.num_rebound ++;
+		break;
+
+	default:
+		break;
+	}
+
+	store->yiaddr[idx] = info->yiaddr;
+	if (info->server_id) store->server_id[idx] = info->server_id;
+	dpc_client_state_set(pop, idx, DPC_CLIENT_BOUND);
+
+	/* No lease time, or an infinite one: there is nothing more to do for this client. */
+	if (!lease_time || lease_time == DPC_LEASE_INFINITE) {
+		store->t1[idx] = store->t2[idx] = store->expiry[idx] = DPC_LEASE_INFINITE;
+		return;
+	}
+
+	t2 = info->t2 ? info->t2 : (uint32_t)((uint64_t)lease_time * 7 / 8);
+	if (t2 > lease_time) t2 = lease_time;
+	t1 = info->t1 ? info->t1 : lease_time / 2;
+	if (t1 > t2) t1 = t2;
+
+	store->t1[idx] = dpc_population_offset_add(now, t1);
+	store->t2[idx] = dpc_population_offset_add(now, t2);
+	store->expiry[idx] = dpc_population_offset_add(now, lease_time);
+
+	dpc_population_schedule(pop, idx, store->t1[idx]);
+}
+
+/*
+ *	A client has been refused its lease. It has to start over right away.
+ */
+void dpc_population_client_nak(dpc_population_t *pop, uint32_t idx)
+{
+	if (!(pop->state[idx] & DPC_CLIENT_IN_PROGRESS)) return;
+
+	pop->stats.num_nak ++;
+
+	dpc_lease_store_clear(pop->store, idx);
+	dpc_client_state_set(pop, idx, DPC_CLIENT_INIT);
+
+	dpc_population_schedule(pop, idx, dpc_population_now(pop));
+}
+
+/*
+ *	Get when a client which failed to renew (or rebind) its lease should try again: after half the time remaining
+ *	until the limit (T2, or the lease expiry), but not sooner than a minimum delay (RFC 2131, section 4.4.5).
+ */
+static uint32_t dpc_client_retry_time(uint32_t now, uint32_t limit)
+{
+	uint32_t delay;
+
+	if (now >= limit) return now;
+
+	delay = (limit - now) / 2;
+	if (delay < DPC_CLIENT_RENEW_MIN) delay = DPC_CLIENT_RENEW_MIN;
+
+	return (delay < limit - now) ? now + delay : limit;
+}
+
+/*
+ *	The session handled on behalf of a client is finished.
+ *	If the client did not get what it asked for (no reply), it will try again later.
+ */
+void dpc_population_client_end(dpc_population_t *pop, uint32_t idx)
+{
+	dpc_lease_store_t *store = pop->store;
+	dpc_client_state_t state = DPC_CLIENT_STATE(pop->state[idx]);
+	uint32_t now, due;
+
+	if (!(pop->state[idx] & DPC_CLIENT_IN_PROGRESS)) return; /* Ack or Nak has been handled already. */
+
+	pop->state[idx] = state;
+	now = dpc_population_now(pop);
+
+	switch (state) {
+	case DPC_CLIENT_SELECTING:
+		due = dpc_population_offset_add(now, DPC_CLIENT_RETRY_DELAY);
+		break;
+
+	case DPC_CLIENT_RENEWING:
+		due = dpc_client_retry_time(now, store->t2[idx]);
+		break;
+
+	case DPC_CLIENT_REBINDING:
+		due = dpc_client_retry_time(now, store->expiry[idx]);
+		break;
+
+	default:
+		due = now;
+		break;
+	}
+
+	dpc_population_schedule(pop, idx, due);
+}
+
+/*
+ *	Get the lease held by a client, if it has one which has not expired and which it may release.
+ *	Returns true (and the lease information) if so, false otherwise.
+ */
+bool dpc_population_client_lease(dpc_population_t *pop, uint32_t idx, uint32_t *yiaddr, uint32_t *server_id)
+{
+	dpc_lease_store_t *store = pop->store;
+	dpc_client_state_t state = pop->state[idx];
+
+	if (!store->yiaddr[idx] || dpc_population_now(pop) >= store->expiry[idx]) return false;
+	if (state != DPC_CLIENT_BOUND && state != DPC_CLIENT_RENEWING && state != DPC_CLIENT_REBINDING) return false;
+
+	*yiaddr = store->yiaddr[idx];
+	*server_id = store->server_id[idx];
+
+	return true;
+}
+
+/*
+ *	A client has released its lease (the DHCP Release has been sent).
+ */
+void dpc_population_client_release(dpc_population_t *pop, uint32_t idx)
+{
+	pop->stats.num_released ++;
+
+	dpc_lease_store_clear(pop->store, idx);
+	dpc_client_state_set(pop, idx, DPC_CLIENT_INIT);
+}
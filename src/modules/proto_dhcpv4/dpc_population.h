@@ -0,0 +1,27 @@
+#pragma once
+/*
+ * dpc_population.h
+ */
+#include "dpc_lease_store.h"
+
+#define DPC_CLIENT_NONE  UINT32_MAX /* No client (end of a list of clients). */
+
+typedef struct dpc_population dpc_population_t;
+
+dpc_population_t *dpc_population_create(TALLOC_CTX *ctx, uint32_t first, uint32_t num);
+uint32_t dpc_population_num(dpc_population_t *pop);
+dpc_lease_store_t *dpc_population_store(dpc_population_t *pop);
+dpc_population_stats_t const *dpc_population_stats(dpc_population_t *pop);
+int dpc_population_load(dpc_population_t *pop, char const *filename);
+int dpc_population_save(dpc_population_t *pop, char const *filename);
+
+uint32_t dpc_population_num_ready(dpc_population_t *pop);
+fr_time_t dpc_population_next_event(dpc_population_t *pop);
+uint32_t dpc_population_ready_get(dpc_population_t *pop);
+
+dpc_client_state_t dpc_population_client_start(dpc_population_t *pop, uint32_t idx);
+void dpc_population_client_ack(dpc_population_t *pop, uint32_t idx, dpc_reply_info_t const *info);
+void dpc_population_client_nak(dpc_population_t *pop, uint32_t idx);
+void dpc_population_client_end(dpc_population_t *pop, uint32_t idx);
+bool dpc_population_client_lease(dpc_population_t *pop, uint32_t idx, uint32_t *yiaddr, uint32_t *server_id);
+void dpc_population_client_release(dpc_population_t *pop, uint32_t idx);
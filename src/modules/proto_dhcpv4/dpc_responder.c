@@ -0,0 +1,634 @@
+/**
+ * @file dpc_responder.c
+ * @brief Loopback DHCP responder.
+ *
+ * A minimal DHCP server, so that the client can be benchmarked without being limited by an actual server.
+ * Replies are encoded once at startup: for each request, a reply is copied and the values specific to that request
+ * (xid, flags, giaddr, chaddr, offered address) are patched in place. No lease is kept: the address offered to a
+ * client is derived from its chaddr, so that a Request following an Offer is acknowledged with the same address.
+ * Replies can be delayed (with jitter), and a share of requests can be dropped, to behave somewhat like a server.
+ */
+
+#include "dhcperfcli.h"
+#include "ncc_util.h"
+#include "dpc_responder.h"
+
+#include <poll.h>
+
+#ifdef __linux__
+#  define DPC_RESPONDER_WITH_MMSG 1
+#endif
+
+
+#define DPC_RESPONDER_BATCH      64    /* Max number of datagrams received or sent with a single system call. */
+#define DPC_RESPONDER_BUF_SIZE   1500  /* Size of receive buffers (Ethernet MTU). */
+#define DPC_RESPONDER_REPLY_LEN  300   /* Length of replies (BOOTP minimum message length). */
+
+#define DPC_RESPONDER_POOL_START 0x0a000001 /* First address offered: 10.0.0.1. */
+#define DPC_RESPONDER_POOL_SIZE  0x00fffffe /* Up to 10.255.255.254. */
+#define DPC_RESPONDER_LEASE_TIME 3600
+#define DPC_RESPONDER_NETMASK    0xff000000
+
+/*
+ *	Offsets of DHCP fields.
+ */
+#define DHCP_OFF_OP              0
+#define DHCP_OFF_HTYPE           1
+#define DHCP_OFF_HLEN            2
+#define DHCP_OFF_XID             4
+#define DHCP_OFF_FLAGS           10
+#define DHCP_OFF_CIADDR          12
+#define DHCP_OFF_YIADDR          16
+#define DHCP_OFF_GIADDR          24
+#define DHCP_OFF_CHADDR          28
+#define DHCP_OFF_COOKIE          236
+#define DHCP_OFF_OPTIONS         240
+
+#define DHCP_CHADDR_LEN          16
+
+/*
+ *	DHCP options we need to know about.
+ */
+#define DHCP_OPT_PAD             0
+#define DHCP_OPT_SUBNET_MASK     1
+#define DHCP_OPT_REQUESTED_IP    50
+#define DHCP_OPT_LEASE_TIME      51
+#define DHCP_OPT_MESSAGE_TYPE    53
+#define DHCP_OPT_SERVER_ID       54
+#define DHCP_OPT_END             255
+
+static uint8_t const dhcp_magic_cookie[4] = { 0x63, 0x82, 0x53, 0x63 };
+
+typedef uint8_t dpc_responder_buf_t[DPC_RESPONDER_BUF_SIZE];
+
+/*
+ *	Replies encoded at startup.
+ */
+typedef enum {
+	DPC_RESPONDER_OFFER = 0,
+	DPC_RESPONDER_ACK,
+	DPC_RESPONDER_ACK_INFORM,      //!< Ack to an Inform (no lease).
+	DPC_RESPONDER_NAK,
+	DPC_RESPONDER_LEASE_ACTIVE,
+	DPC_RESPONDER_LEASE_UNKNOWN,
+	DPC_RESPONDER_REPLY_MAX
+} dpc_responder_reply_type_t;
+
+/*
+ *	A reply waiting to be sent.
+ */
+typedef struct dpc_responder_reply {
+	fr_time_t fte_due;             //!< When it is to be sent.
+	struct sockaddr_in dst;        //!< Where it is to be sent (to the source of the request).
+	uint8_t code;                  //!< Message type.
+	uint8_t data[DPC_RESPONDER_REPLY_LEN];
+} dpc_responder_reply_t;
+
+struct dpc_responder {
+	int sockfd;
+	uint32_t server_id;            //!< Our address (network order), which we identify ourselves with.
+	bool volatile stop;            //!< Set (from a signal handler) to stop answering requests.
+
+	fr_time_delta_t ftd_latency;   //!< Delay before replies are sent.
+	fr_time_delta_t ftd_jitter;    //!< Max random variation (more or less) of this delay.
+	uint32_t drop;                 //!< Requests which are not replied to (per million).
+
+	uint8_t templ[DPC_RESPONDER_REPLY_MAX][DPC_RESPONDER_REPLY_LEN]; //!< Replies encoded at startup.
+	uint8_t templ_code[DPC_RESPONDER_REPLY_MAX];
+
+	dpc_responder_buf_t *bufs;     //!< Buffers in which requests are received.
+	struct sockaddr_in *from;      //!< Source of requests received.
+	size_t *lens;                  //!< Length of requests received.
+
+	dpc_responder_reply_t *replies; //!< Slots of replies waiting to be sent.
+	uint32_t num_replies;          //!< Number of slots allocated.
+	uint32_t *free_slots;          //!< Slots not in use.
+	uint32_t num_free;
+	uint32_t *heap;                //!< Slots in use, as a binary min-heap on due time.
+	uint32_t num_heap;
+
+	fr_time_t fte_start;
+	fr_time_t fte_end;
+	uint64_t num_recv[DHCP_MAX_MESSAGE_TYPE];  //!< Requests received (by message type).
+	uint64_t num_sent[DHCP_MAX_MESSAGE_TYPE];  //!< Replies sent (by message type).
+	uint64_t num_dropped;          //!< Requests deliberately not replied to.
+	uint64_t num_ignored;          //!< Datagrams which are not requests we answer.
+	uint64_t num_send_fail;        //!< Replies which could not be sent.
+};
+
+
+/*
+ *	Encode a reply: everything which does not depend on the request.
+ */
+static void dpc_responder_templ_init(dpc_responder_t *responder, dpc_responder_reply_type_t type, uint8_t code,
+                                     bool with_lease)
+{
+	uint8_t *data = responder->templ[type];
+	uint8_t *p = data + DHCP_OFF_OPTIONS;
+	uint32_t value;
+
+	memset(data, 0, DPC_RESPONDER_REPLY_LEN);
+	responder->templ_code[type] = code;
+
+	data[DHCP_OFF_OP] = 2; /* BOOTREPLY */
+	memcpy(data + DHCP_OFF_COOKIE, dhcp_magic_cookie, sizeof(dhcp_magic_cookie));
+
+	*p++ = DHCP_OPT_MESSAGE_TYPE;
+	*p++ = 1;
+	*p++ = code;
+
+	*p++ = DHCP_OPT_SERVER_ID;
+	*p++ = 4;
+	memcpy(p, &responder->server_id, 4);
+	p += 4;
+
+	if (with_lease) {
+		*p++ = DHCP_OPT_LEASE_TIME;
+		*p++ = 4;
+		value = htonl(DPC_RESPONDER_LEASE_TIME);
+		memcpy(p, &value, 4);
+		p += 4;
+
+		*p++ = DHCP_OPT_SUBNET_MASK;
+		*p++ = 4;
+		value = htonl(DPC_RESPONDER_NETMASK);
+		memcpy(p, &value, 4);
+		p += 4;
+	}
+
+	*p = DHCP_OPT_END; /* Followed by padding up to the fixed reply length. */
+}
+
+/*
+ *	Allocate a responder, with a socket bound to the address and port on which requests are to be received.
+ *	Latency and jitter are in seconds, drop is a percentage.
+ */
+dpc_responder_t *dpc_responder_create(TALLOC_CTX *ctx, ncc_endpoint_t const *ep,
+                                      double latency, double jitter, double drop)
+{
+	dpc_responder_t *responder;
+	fr_ipaddr_t ipaddr = ep->ipaddr;
+	uint16_t port = ep->port;
+
+	if (ipaddr.af != AF_INET) {
+		fr_strerror_printf("Responder address must be IPv4");
+		return NULL;
+	}
+
+	MEM(responder = talloc_zero(ctx, dpc_responder_t));
+
+	responder->sockfd = fr_socket_server_udp(&ipaddr, &port, NULL, false);
+	if (responder->sockfd < 0) {
+		fr_strerror_printf("Error opening socket: %s", fr_strerror());
+		talloc_free(responder);
+		return NULL;
+	}
+	if (fr_socket_bind(responder->sockfd, &ipaddr, &port, NULL) < 0) {
+		fr_strerror_printf("Error binding socket: %s", fr_strerror());
+		close(responder->sockfd);
+		talloc_free(responder);
+		return NULL;
+	}
+	if (fr_nonblock(responder->sockfd) < 0) {
+		fr_strerror_printf("Error setting socket non-blocking: %s", fr_syserror(errno));
+		close(responder->sockfd);
+		talloc_free(responder);
+		return NULL;
+	}
+
+	responder->server_id = ipaddr.addr.v4.s_addr;
+	responder->ftd_latency = ncc_float_to_fr_time(latency);
+	responder->ftd_jitter = ncc_float_to_fr_time(jitter);
+	responder->drop = drop * 10000;
+
+	dpc_responder_templ_init(responder, DPC_RESPONDER_OFFER, FR_DHCP_OFFER, true);
+	dpc_responder_templ_init(responder, DPC_RESPONDER_ACK, FR_DHCP_ACK, true);
+	dpc_responder_templ_init(responder, DPC_RESPONDER_ACK_INFORM, FR_DHCP_ACK, false);
+	dpc_responder_templ_init(responder, DPC_RESPONDER_NAK, FR_DHCP_NAK, false);
+	dpc_responder_templ_init(responder, DPC_RESPONDER_LEASE_ACTIVE, FR_DHCP_LEASE_ACTIVE, true);
+	dpc_responder_templ_init(responder, DPC_RESPONDER_LEASE_UNKNOWN, FR_DHCP_LEASE_UNKNOWN, false);
+
+	MEM(responder->bufs = talloc_array(responder, dpc_responder_buf_t, DPC_RESPONDER_BATCH));
+	MEM(responder->from = talloc_array(responder, struct sockaddr_in, DPC_RESPONDER_BATCH));
+	MEM(responder->lens = talloc_array(responder, size_t, DPC_RESPONDER_BATCH));
+
+	return responder;
+}
+
+/*
+ *	Stop answering requests. This can be called from a signal handler.
+ */
+void dpc_responder_stop(dpc_responder_t *responder)
+{
+	responder->stop = true;
+}
+
+/*
+ *	Find an option in a request. Return a pointer to its value (and its length), or NULL if it's not there.
+ *	(Option overload is not handled: we only need options which are in the options field.)
+ */
+static uint8_t const *dpc_responder_option_find(uint8_t *opt_len, uint8_t const *data, size_t data_len, uint8_t code)
+{
+	uint8_t const *p = data + DHCP_OFF_OPTIONS;
+	uint8_t const *end = data + data_len;
+
+	while (p < end) {
+		if (*p == DHCP_OPT_END) break;
+		if (*p == DHCP_OPT_PAD) {
+			p++;
+			continue;
+		}
+		if (p + 2 > end || p + 2 + p[1] > end) break; /* Malformed. */
+
+		if (*p == code) {
+			*opt_len = p[1];
+			return p + 2;
+		}
+		p += 2 + p[1];
+	}
+	return NULL;
+}
+
+/*
+ *	Get the address (network order) offered to a client, derived from its chaddr.
+ */
+static uint32_t dpc_responder_lease_addr(uint8_t const *data)
+{
+	uint8_t hlen = data[DHCP_OFF_HLEN];
+
+	if (hlen > DHCP_CHADDR_LEN) hlen = DHCP_CHADDR_LEN;
+
+	return htonl(DPC_RESPONDER_POOL_START + (fr_hash(data + DHCP_OFF_CHADDR, hlen) % DPC_RESPONDER_POOL_SIZE));
+}
+
+/*
+ *	Check if an address (network order) belongs to our pool.
+ */
+static bool dpc_responder_addr_in_pool(uint32_t addr)
+{
+	addr = ntohl(addr);
+	return (addr >= DPC_RESPONDER_POOL_START && addr < DPC_RESPONDER_POOL_START + DPC_RESPONDER_POOL_SIZE);
+}
+
+/*
+ *	Get a free slot for a reply, growing the slots if none is available.
+ */
+static dpc_responder_reply_t *dpc_responder_reply_alloc(dpc_responder_t *responder, uint32_t *slot)
+{
+	uint32_t i, num;
+
+	if (!responder->num_free) {
+		num = responder->num_replies ? 2 * responder->num_replies : DPC_RESPONDER_BATCH;
+
+		MEM(responder->replies = talloc_realloc(responder, responder->replies, dpc_responder_reply_t, num));
+		MEM(responder->free_slots = talloc_realloc(responder, responder->free_slots, uint32_t, num));
+		MEM(responder->heap = talloc_realloc(responder, responder->heap, uint32_t, num));
+
+		for (i = responder->num_replies; i < num; i++) {
+			responder->free_slots[responder->num_free++] = i;
+		}
+		responder->num_replies = num;
+	}
+
+	*slot = responder->free_slots[--responder->num_free];
+	return &responder->replies[*slot];
+}
+
+#define HEAP_DUE(_i) (responder->replies[responder->heap[_i]].fte_due)
+
+/*
+ *	Add a reply to the heap of replies waiting to be sent.
+ */
+static void dpc_responder_heap_push(dpc_responder_t *responder, uint32_t slot)
+{
+	uint32_t i = responder->num_heap++;
+	uint32_t parent;
+
+	responder->heap[i] = slot;
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (HEAP_DUE(parent) <= HEAP_DUE(i)) break;
+
+		responder->heap[i] = responder->heap[parent];
+		responder->heap[parent] = slot;
+		i = parent;
+	}
+}
+
+/*
+ *	Remove the first reply due from the heap of replies waiting to be sent.
+ */
+static uint32_t dpc_responder_heap_pop(dpc_responder_t *responder)
+{
+	uint32_t slot = responder->heap[0];
+	uint32_t i = 0, child, tmp;
+
+	responder->heap[0] = responder->heap[--responder->num_heap];
+	while ((child = 2 * i + 1) < responder->num_heap) {
+		if (child + 1 < responder->num_heap && HEAP_DUE(child + 1) < HEAP_DUE(child)) child++;
+		if (HEAP_DUE(i) <= HEAP_DUE(child)) break;
+
+		tmp = responder->heap[i];
+		responder->heap[i] = responder->heap[child];
+		responder->heap[child] = tmp;
+		i = child;
+	}
+
+	return slot;
+}
+
+/*
+ *	Handle a request: build the reply, and schedule it to be sent.
+ */
+static void dpc_responder_request_handle(dpc_responder_t *responder, uint8_t const *data, size_t data_len,
+                                         struct sockaddr_in const *from, fr_time_t now)
+{
+	uint8_t const *opt;
+	uint8_t opt_len, code;
+	uint32_t yiaddr = 0, ciaddr, slot;
+	dpc_responder_reply_type_t type;
+	dpc_responder_reply_t *reply;
+	fr_time_delta_t ftd_delay;
+
+	if (data_len < DHCP_OFF_OPTIONS || data[DHCP_OFF_OP] != 1 /* BOOTREQUEST */
+	    || memcmp(data + DHCP_OFF_COOKIE, dhcp_magic_cookie, sizeof(dhcp_magic_cookie)) != 0) {
+		responder->num_ignored++;
+		return;
+	}
+
+	opt = dpc_responder_option_find(&opt_len, data, data_len, DHCP_OPT_MESSAGE_TYPE);
+	if (!opt || opt_len != 1 || !is_dhcp_message(*opt)) {
+		responder->num_ignored++;
+		return;
+	}
+	code = *opt;
+	responder->num_recv[code]++;
+
+	memcpy(&ciaddr, data + DHCP_OFF_CIADDR, 4);
+
+	switch (code) {
+	case FR_DHCP_DISCOVER:
+		type = DPC_RESPONDER_OFFER;
+		yiaddr = dpc_responder_lease_addr(data);
+		break;
+
+	case FR_DHCP_REQUEST:
+		/* Requested address (selecting, init-reboot), or client address (renewing, rebinding). */
+		opt = dpc_responder_option_find(&opt_len, data, data_len, DHCP_OPT_REQUESTED_IP);
+		if (opt && opt_len == 4) {
+			memcpy(&yiaddr, opt, 4);
+		} else {
+			yiaddr = ciaddr;
+		}
+		if (yiaddr && dpc_responder_addr_in_pool(yiaddr)) {
+			type = DPC_RESPONDER_ACK;
+		} else {
+			type = DPC_RESPONDER_NAK;
+			yiaddr = 0;
+		}
+		break;
+
+	case FR_DHCP_INFORM:
+		type = DPC_RESPONDER_ACK_INFORM;
+		break;
+
+	case FR_DHCP_LEASE_QUERY:
+		type = (ciaddr && dpc_responder_addr_in_pool(ciaddr)) ? DPC_RESPONDER_LEASE_ACTIVE : DPC_RESPONDER_LEASE_UNKNOWN;
+		break;
+
+	default: /* Not something we reply to (e.g. Release, Decline). */
+		return;
+	}
+
+	if (responder->drop && (fr_rand() % 1000000) < responder->drop) {
+		responder->num_dropped++;
+		return;
+	}
+
+	/*
+	 *	Copy the reply encoded at startup, and patch what is specific to this request.
+	 */
+	reply = dpc_responder_reply_alloc(responder, &slot);
+
+	memcpy(reply->data, responder->templ[type], DPC_RESPONDER_REPLY_LEN);
+	reply->code = responder->templ_code[type];
+
+	reply->data[DHCP_OFF_HTYPE] = data[DHCP_OFF_HTYPE];
+	reply->data[DHCP_OFF_HLEN] = data[DHCP_OFF_HLEN];
+	memcpy(reply->data + DHCP_OFF_XID, data + DHCP_OFF_XID, 4);
+	memcpy(reply->data + DHCP_OFF_FLAGS, data + DHCP_OFF_FLAGS, 2);
+	if (code == FR_DHCP_INFORM || code == FR_DHCP_LEASE_QUERY || type == DPC_RESPONDER_ACK) {
+		memcpy(reply->data + DHCP_OFF_CIADDR, &ciaddr, 4);
+	}
+	memcpy(reply->data + DHCP_OFF_YIADDR, &yiaddr, 4);
+	memcpy(reply->data + DHCP_OFF_GIADDR, data + DHCP_OFF_GIADDR, 4);
+	memcpy(reply->data + DHCP_OFF_CHADDR, data + DHCP_OFF_CHADDR, DHCP_CHADDR_LEN);
+
+	/* Reply to wherever the request came from (the client, or the relay). */
+	reply->dst = *from;
+
+	/* Delay: latency, more or less jitter (uniformly distributed). */
+	ftd_delay = responder->ftd_latency;
+	if (responder->ftd_jitter) {
+		ftd_delay += (fr_time_delta_t)(((double)fr_rand() / UINT32_MAX * 2 - 1) * responder->ftd_jitter);
+		if (ftd_delay < 0) ftd_delay = 0;
+	}
+	reply->fte_due = now + ftd_delay;
+
+	dpc_responder_heap_push(responder, slot);
+}
+
+/*
+ *	Receive a batch of datagrams. Return how many were received (0 if there is nothing to read), or -1 on error.
+ */
+static int dpc_responder_recv(dpc_responder_t *responder)
+{
+	int i, num;
+#ifdef DPC_RESPONDER_WITH_MMSG
+	struct mmsghdr msgs[DPC_RESPONDER_BATCH];
+	struct iovec iovs[DPC_RESPONDER_BATCH];
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < DPC_RESPONDER_BATCH; i++) {
+		iovs[i].iov_base = responder->bufs[i];
+		iovs[i].iov_len = DPC_RESPONDER_BUF_SIZE;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &responder->from[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(responder->from[i]);
+	}
+
+	num = recvmmsg(responder->sockfd, msgs, DPC_RESPONDER_BATCH, MSG_DONTWAIT, NULL);
+	if (num < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+		fr_strerror_printf("Error receiving requests: %s", fr_syserror(errno));
+		return -1;
+	}
+	for (i = 0; i < num; i++) {
+		responder->lens[i] = msgs[i].msg_len;
+	}
+#else
+	ssize_t len;
+	socklen_t from_len;
+
+	for (num = 0; num < DPC_RESPONDER_BATCH; num++) {
+		from_len = sizeof(responder->from[num]);
+		len = recvfrom(responder->sockfd, responder->bufs[num], DPC_RESPONDER_BUF_SIZE, MSG_DONTWAIT,
+		               (struct sockaddr *)&responder->from[num], &from_len);
+		if (len < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) break;
+			fr_strerror_printf("Error receiving requests: %s", fr_syserror(errno));
+			return -1;
+		}
+		responder->lens[num] = len;
+	}
+#endif
+
+	return num;
+}
+
+/*
+ *	Send the replies which are due, in batches.
+ */
+static void dpc_responder_send_due(dpc_responder_t *responder, fr_time_t now)
+{
+	uint32_t slots[DPC_RESPONDER_BATCH];
+	int i, num, sent;
+	dpc_responder_reply_t *reply;
+#ifdef DPC_RESPONDER_WITH_MMSG
+	struct mmsghdr msgs[DPC_RESPONDER_BATCH];
+	struct iovec iovs[DPC_RESPONDER_BATCH];
+#endif
+
+	while (responder->num_heap && HEAP_DUE(0) <= now) {
+		num = 0;
+		while (num < DPC_RESPONDER_BATCH && responder->num_heap && HEAP_DUE(0) <= now) {
+			slots[num++] = dpc_responder_heap_pop(responder);
+		}
+
+#ifdef DPC_RESPONDER_WITH_MMSG
+		memset(msgs, 0, num * sizeof(msgs[0]));
+		for (i = 0; i < num; i++) {
+			reply = &responder->replies[slots[i]];
+			iovs[i].iov_base = reply->data;
+			iovs[i].iov_len = DPC_RESPONDER_REPLY_LEN;
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &reply->dst;
+			msgs[i].msg_hdr.msg_namelen = sizeof(reply->dst);
+		}
+
+		sent = sendmmsg(responder->sockfd, msgs, num, 0);
+		if (sent < 0) sent = 0;
+#else
+		for (sent = 0; sent < num; sent++) {
+			reply = &responder->replies[slots[sent]];
+			if (sendto(responder->sockfd, reply->data, DPC_RESPONDER_REPLY_LEN, 0,
+			           (struct sockaddr *)&reply->dst, sizeof(reply->dst)) < 0) break;
+		}
+#endif
+
+		/* Replies which could not be sent are not retried. */
+		for (i = 0; i < num; i++) {
+			if (i < sent) {
+				responder->num_sent[responder->replies[slots[i]].code]++;
+			} else {
+				responder->num_send_fail++;
+			}
+			responder->free_slots[responder->num_free++] = slots[i];
+		}
+	}
+}
+
+/*
+ *	Answer requests, until stopped.
+ *	Returns 0 once stopped, or -1 on error.
+ */
+int dpc_responder_run(dpc_responder_t *responder)
+{
+	struct pollfd pfd = { .fd = responder->sockfd, .events = POLLIN };
+	int i, num, timeout;
+	fr_time_t now;
+
+	responder->fte_start = fr_time();
+
+	while (!responder->stop) {
+		/* Wait for requests, or until the next reply is due. */
+		timeout = -1;
+		if (responder->num_heap) {
+			now = fr_time();
+			timeout = (HEAP_DUE(0) > now) ? (HEAP_DUE(0) - now + NSEC / 1000 - 1) / (NSEC / 1000) : 0;
+		}
+
+		if (poll(&pfd, 1, timeout) < 0) {
+			if (errno == EINTR) continue; /* Interrupted (e.g. by a signal which stops us). */
+			fr_strerror_printf("Error waiting for requests: %s", fr_syserror(errno));
+			return -1;
+		}
+
+		now = fr_time();
+		if (pfd.revents & POLLIN) {
+			do {
+				num = dpc_responder_recv(responder);
+				if (num < 0) return -1;
+
+				for (i = 0; i < num; i++) {
+					dpc_responder_request_handle(responder, responder->bufs[i], responder->lens[i],
+					                             &responder->from[i], now);
+				}
+
+				/* Send what is due after each batch, so replies without delay go out immediately. */
+				dpc_responder_send_due(responder, now);
+			} while (num == DPC_RESPONDER_BATCH);
+		}
+
+		dpc_responder_send_due(responder, fr_time());
+	}
+
+	responder->fte_end = fr_time();
+	return 0;
+}
+
+/*
+ *	Print the statistics of a responder.
+ */
+void dpc_responder_stats_fprint(FILE *fp, dpc_responder_t *responder)
+{
+	int i;
+	uint64_t total_recv = 0, total_sent = 0;
+	double elapsed;
+
+	if (!responder->fte_end) responder->fte_end = fr_time();
+	elapsed = ncc_fr_time_to_float(responder->fte_end - responder->fte_start);
+
+	for (i = 1; i < DHCP_MAX_MESSAGE_TYPE; i++) {
+		total_recv += responder->num_recv[i];
+		total_sent += responder->num_sent[i];
+	}
+
+	fprintf(fp, "*** Responder statistics:\n");
+	fprintf(fp, "\t%-*.*s: %.3f\n", LG_PAD_STATS, LG_PAD_STATS, "Elapsed time (s)", elapsed);
+
+	fprintf(fp, "\t%-*.*s: %"PRIu64, LG_PAD_STATS, LG_PAD_STATS, "Requests received", total_recv);
+	for (i = 1; i < DHCP_MAX_MESSAGE_TYPE; i++) {
+		if (responder->num_recv[i]) fprintf(fp, ", %s: %"PRIu64, dpc_message_types[i], responder->num_recv[i]);
+	}
+	fprintf(fp, "\n");
+
+	fprintf(fp, "\t%-*.*s: %"PRIu64, LG_PAD_STATS, LG_PAD_STATS, "Replies sent", total_sent);
+	for (i = 1; i < DHCP_MAX_MESSAGE_TYPE; i++) {
+		if (responder->num_sent[i]) fprintf(fp, ", %s: %"PRIu64, dpc_message_types[i], responder->num_sent[i]);
+	}
+	fprintf(fp, "\n");
+
+	if (elapsed > 0) {
+		fprintf(fp, "\t%-*.*s: %.3f\n", LG_PAD_STATS, LG_PAD_STATS, "Reply rate (/s)", total_sent / elapsed);
+	}
+	fprintf(fp, "\t%-*.*s: %"PRIu64"\n", LG_PAD_STATS, LG_PAD_STATS, "Dropped", responder->num_dropped);
+	if (responder->num_ignored) {
+		fprintf(fp, "\t%-*.*s: %"PRIu64"\n", LG_PAD_STATS, LG_PAD_STATS, "Ignored", responder->num_ignored);
+	}
+	if (responder->num_send_fail) {
+		fprintf(fp, "\t%-*.*s: %"PRIu64"\n", LG_PAD_STATS, LG_PAD_STATS, "Failed to send", responder->num_send_fail);
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+/*
+ * dpc_responder.h
+ */
+
+typedef struct dpc_responder dpc_responder_t;
+
+dpc_responder_t *dpc_responder_create(TALLOC_CTX *ctx, ncc_endpoint_t const *ep,
+                                      double latency, double jitter, double drop);
+int dpc_responder_run(dpc_responder_t *responder);
+void dpc_responder_stop(dpc_responder_t *responder);
+void dpc_responder_stats_fprint(FILE *fp, dpc_responder_t *responder);
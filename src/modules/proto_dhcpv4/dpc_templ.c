@@ -0,0 +1,342 @@
+/**
+ * @file dpc_templ.c
+ * @brief Encode-once packet templates.
+ *
+ * When an input item is used repeatedly (template mode), the packets built from it only differ by a few values:
+ * the xid, and attributes which are xlat expanded (e.g. chaddr, Host-Name).
+ * So instead of building a new list of value pairs and encoding it for each session, we encode the first packet
+ * normally, record where the varying values are located in the encoded data, and then for each following session
+ * copy the encoded data and patch these values in place.
+ */
+
+#include "dhcperfcli.h"
+#include "ncc_util.h"
+#include "ncc_xlat.h"
+#include "dpc_xlat.h"
+#include "dpc_templ.h"
+
+
+/*
+ *	A value to be patched in the encoded packet data.
+ */
+typedef struct dpc_templ_patch {
+	fr_dict_attr_t const *da;   //!< Attribute (DHCP field or option).
+	dpc_xlat_compiled_t const *compiled; //!< Compiled xlat expression (from input), to obtain the value.
+	VALUE_PAIR *vp;             //!< Holds the expanded value. Allocated once, reused for each packet.
+	size_t offset;              //!< Where the value is located in encoded data.
+	size_t len;                 //!< Length of encoded value.
+} dpc_templ_patch_t;
+
+/*
+ *	Compiled packet template.
+ */
+struct dpc_templ {
+	uint8_t *data;              //!< Encoded packet data.
+	size_t data_len;
+
+	dpc_templ_patch_t *patches; //!< Values to patch for each new packet.
+	uint32_t num_patches;
+
+	bool patch_giaddr;          //!< Whether giaddr is set from the gateway (not provided in input).
+};
+
+/*
+ *	Location of DHCP fields (those which can be patched) in encoded data.
+ *	Note: xid is handled separately (it is always set when the packet is sent).
+ */
+static struct {
+	fr_dict_attr_t const **da;
+	size_t offset;
+	size_t len;
+} dpc_templ_fields[] = {
+	{ &attr_dhcp_hop_count,               3, 1 },
+	{ &attr_dhcp_number_of_seconds,       8, 2 },
+	{ &attr_dhcp_flags,                  10, 2 },
+	{ &attr_dhcp_client_ip_address,      12, 4 },
+	{ &attr_dhcp_your_ip_address,        16, 4 },
+	{ &attr_dhcp_server_ip_address,      20, 4 },
+	{ &attr_dhcp_gateway_ip_address,     24, 4 },
+	{ &attr_dhcp_client_hardware_address, 28, 6 },
+
+	{ NULL }
+};
+
+#define DPC_TEMPL_OPTIONS_OFFSET 240 /* DHCP fields, and magic cookie. */
+#define DPC_TEMPL_VALUE_MAX_LEN  253 /* Max length of a DHCP option (not split). */
+
+
+/*
+ *	Encode a value as it would be in a DHCP packet.
+ *	Only the types of value we know how to patch are handled.
+ *	Returns: length of encoded value, -1 if the type is not handled.
+ */
+static ssize_t dpc_templ_value_encode(uint8_t *out, size_t outlen, VALUE_PAIR const *vp)
+{
+	size_t len;
+	uint8_t const *p;
+	uint16_t v16;
+	uint32_t v32;
+
+	switch (vp->da->type) {
+	case FR_TYPE_UINT8:
+		p = &vp->vp_uint8;
+		len = 1;
+		break;
+
+	case FR_TYPE_UINT16:
+		v16 = htons(vp->vp_uint16);
+		p = (uint8_t const *)&v16;
+		len = 2;
+		break;
+
+	case FR_TYPE_UINT32:
+		v32 = htonl(vp->vp_uint32);
+		p = (uint8_t const *)&v32;
+		len = 4;
+		break;
+
+	case FR_TYPE_IPV4_ADDR:
+		p = (uint8_t const *)&vp->vp_ipv4addr; /* Already in network byte order. */
+		len = 4;
+		break;
+
+	case FR_TYPE_ETHERNET:
+		p = vp->vp_ether;
+		len = 6;
+		break;
+
+	case FR_TYPE_STRING:
+		p = (uint8_t const *)vp->vp_strvalue;
+		len = vp->vp_length;
+		break;
+
+	case FR_TYPE_OCTETS:
+		p = vp->vp_octets;
+		len = vp->vp_length;
+		break;
+
+	default:
+		return -1;
+	}
+
+	if (len > outlen) return -1;
+
+	memcpy(out, p, len);
+	return len;
+}
+
+/*
+ *	Find where a given option is located in encoded data.
+ *	Returns: offset of the option value, 0 if the option is not found or is present more than once.
+ */
+static size_t dpc_templ_option_find(uint8_t const *data, size_t data_len, unsigned int code, size_t *len)
+{
+	size_t pos = DPC_TEMPL_OPTIONS_OFFSET;
+	size_t found = 0;
+
+	while (pos < data_len) {
+		uint8_t opt = data[pos];
+
+		if (opt == 255) break; /* End. */
+		if (opt == 0) { /* Pad. */
+			pos ++;
+			continue;
+		}
+		if (pos + 2 > data_len || pos + 2 + data[pos + 1] > data_len) break; /* Malformed. */
+
+		if (opt == code) {
+			if (found) return 0; /* Split option, or multiple instances: cannot patch that. */
+			found = pos + 2;
+			*len = data[pos + 1];
+		}
+		pos += 2 + data[pos + 1];
+	}
+
+	return found;
+}
+
+/*
+ *	Find where a value is located in encoded data.
+ *	Returns: offset of the value, 0 if not found (or not something we can patch).
+ */
+static size_t dpc_templ_value_locate(uint8_t const *data, size_t data_len, fr_dict_attr_t const *da, size_t *len)
+{
+	int i;
+
+	/* DHCP fields. */
+	for (i = 0; dpc_templ_fields[i].da; i++) {
+		if (*dpc_templ_fields[i].da == da) {
+			*len = dpc_templ_fields[i].len;
+			return dpc_templ_fields[i].offset;
+		}
+	}
+
+	/* Top level DHCP options (not sub-options, nor vendor options). */
+	if (da->parent != fr_dict_root(dict_dhcpv4) || da->attr == 0 || da->attr >= 255) return 0;
+
+	return dpc_templ_option_find(data, data_len, da->attr, len);
+}
+
+/*
+ *	Compile a packet template from an input item, and the first packet built (and encoded) from it.
+ *	The packet must have been built from the input with the full encoder.
+ *	Returns: the template, or NULL if the input is not suitable for templating.
+ */
+dpc_templ_t *dpc_templ_compile(TALLOC_CTX *ctx, dpc_input_t *input, DHCP_PACKET *packet, bool with_gateway)
+{
+	fr_cursor_t cursor;
+	VALUE_PAIR *vp;
+	dpc_templ_t *templ;
+	uint8_t buffer[DPC_TEMPL_VALUE_MAX_LEN];
+
+	if (!packet->data || packet->data_len < DPC_TEMPL_OPTIONS_OFFSET) return NULL;
+
+	/* Pre-encoded data is already as fast as it gets. */
+	if (ncc_pair_find_by_da(input->vps, attr_encoded_data)) return NULL;
+
+	/* This one is looked for in the request value pairs, which we won't have. */
+	if (ncc_pair_find_by_da(input->vps, attr_authorized_server)) return NULL;
+
+	MEM(templ = talloc_zero(ctx, dpc_templ_t));
+
+	for (vp = fr_cursor_init(&cursor, &input->vps); vp; vp = fr_cursor_next(&cursor)) {
+		VALUE_PAIR *vp_value;
+		dpc_templ_patch_t *patch;
+		size_t offset, len = 0;
+		ssize_t enc_len;
+		uint32_t i;
+
+		if (vp->type != VT_XLAT) continue;
+
+		/* xid is allocated, and we can't know in advance what the xlat would produce. */
+		if (vp->da == attr_dhcp_transaction_id) goto fail;
+
+		/* We need the value from the packet, which has to be unique. */
+		for (i = 0; i < templ->num_patches; i++) {
+			if (templ->patches[i].da == vp->da) goto fail;
+		}
+
+		vp_value = ncc_pair_find_by_da(packet->vps, vp->da);
+		if (!vp_value) goto fail;
+
+		/*
+		 *	Locate the value in encoded data, and check that it is really what we think it is.
+		 */
+		enc_len = dpc_templ_value_encode(buffer, sizeof(buffer), vp_value);
+		if (enc_len < 0) goto fail;
+
+		offset = dpc_templ_value_locate(packet->data, packet->data_len, vp->da, &len);
+		if (!offset || len != (size_t)enc_len || offset + len > packet->data_len
+		    || memcmp(packet->data + offset, buffer, len) != 0) goto fail;
+
+		TALLOC_REALLOC_ZERO(templ, templ->patches, dpc_templ_patch_t, templ->num_patches, templ->num_patches + 1);
+		patch = &templ->patches[templ->num_patches];
+		templ->num_patches ++;
+
+		patch->da = vp->da;
+		patch->compiled = vp->vp_ptr;
+		patch->offset = offset;
+		patch->len = len;
+		MEM(patch->vp = fr_pair_afrom_da(templ, vp->da));
+
+		DEBUG_TRACE("Template (input id: %u): patch %s at offset %zu (len: %zu)", input->id, vp->da->name, offset, len);
+	}
+
+	/* Giaddr is set from the gateway, unless provided in input. */
+	templ->patch_giaddr = (with_gateway && !ncc_pair_find_by_da(input->vps, attr_dhcp_gateway_ip_address));
+
+	MEM(templ->data = talloc_memdup(templ, packet->data, packet->data_len));
+	templ->data_len = packet->data_len;
+
+	DEBUG2("Compiled packet template for input (id: %u): %u value(s) to patch", input->id, templ->num_patches);
+	return templ;
+
+fail:
+	DEBUG2("Input (id: %u) is not suitable for packet templating", input->id);
+	talloc_free(templ);
+	return NULL;
+}
+
+/*
+ *	Build a packet from the list of input value pairs, using values we've already expanded.
+ *	This is used when we cannot patch a value in place (its length has changed).
+ */
+static void dpc_templ_vps_build(DHCP_PACKET *packet, dpc_templ_t *templ, dpc_input_t *input)
+{
+	fr_cursor_t cursor;
+	VALUE_PAIR *vp;
+	uint32_t i;
+
+	ncc_pair_list_append(packet, &packet->vps, input->vps);
+
+	for (vp = fr_cursor_init(&cursor, &packet->vps); vp; vp = fr_cursor_next(&cursor)) {
+		if (vp->type != VT_XLAT) continue;
+
+		for (i = 0; i < templ->num_patches; i++) {
+			if (templ->patches[i].da != vp->da) continue;
+
+			vp->vp_ptr = NULL; /* Do not free the compiled xlat. */
+			ncc_pair_copy_value(vp, templ->patches[i].vp);
+			break;
+		}
+	}
+}
+
+/*
+ *	Instantiate a packet from a template: expand the values which vary, and patch them into a copy of the
+ *	template encoded data.
+ *	If a value cannot be patched (its length has changed), the packet value pairs are built instead (using
+ *	values already expanded), and the caller will have to use the regular encoder.
+ *	Returns: 1 = packet data is set, 0 = packet value pairs are set, -1 = error.
+ */
+int dpc_templ_instantiate(DHCP_PACKET *packet, dpc_templ_t *templ, dpc_input_t *input, ncc_endpoint_t *gateway)
+{
+	uint32_t i;
+	bool patchable = true;
+	uint8_t value[DPC_TEMPL_VALUE_MAX_LEN];
+
+	/* This would not be the same packet layout. */
+	if (templ->patch_giaddr && !gateway) {
+		fr_strerror_printf("Template requires a gateway");
+		return -1;
+	}
+
+	ncc_xlat_set_num(input->xlat_set); /* Initialize xlat context for processing this input. */
+
+	/* Allow xlat expressions to reference input attributes. */
+	DHCP_PACKET xlat_ctx = { .vps = input->vps };
+
+	/*
+	 *	Expand all values first (even if we find out we can't patch them), so that each expansion is done
+	 *	exactly once per packet, as would be the case without a template.
+	 */
+	for (i = 0; i < templ->num_patches; i++) {
+		dpc_templ_patch_t *patch = &templ->patches[i];
+
+		/* With a native generator, the value is set directly (no xlat expansion, no string conversion). */
+		if (dpc_xlat_pair_eval(patch->vp, patch->compiled, &xlat_ctx) < 0) return -1;
+
+		if (dpc_templ_value_encode(value, sizeof(value), patch->vp) != (ssize_t)patch->len) patchable = false;
+	}
+
+	if (!patchable) {
+		DEBUG_TRACE("Template (input id: %u): value length changed, using regular encoder", input->id);
+		dpc_templ_vps_build(packet, templ, input);
+		return 0;
+	}
+
+	MEM(packet->data = talloc_memdup(packet, templ->data, templ->data_len));
+	packet->data_len = templ->data_len;
+
+	for (i = 0; i < templ->num_patches; i++) {
+		dpc_templ_patch_t *patch = &templ->patches[i];
+
+		dpc_templ_value_encode(packet->data + patch->offset, patch->len, patch->vp);
+	}
+
+	if (templ->patch_giaddr) {
+		memcpy(packet->data + 24, &gateway->ipaddr.addr.v4.s_addr, 4);
+	}
+
+	return 1;
+}
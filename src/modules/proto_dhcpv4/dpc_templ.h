@@ -0,0 +1,9 @@
+#pragma once
+/*
+ * dpc_templ.h
+ */
+
+typedef struct dpc_templ dpc_templ_t;
+
+dpc_templ_t *dpc_templ_compile(TALLOC_CTX *ctx, dpc_input_t *input, DHCP_PACKET *packet, bool with_gateway);
+int dpc_templ_instantiate(DHCP_PACKET *packet, dpc_templ_t *templ, dpc_input_t *input, ncc_endpoint_t *gateway);
@@ -8,6 +8,8 @@
 #include "dpc_packet_list.h"
 #include "dpc_util.h"
 
+#include <math.h>
+
 
 typedef struct {
 	uint8_t size;
@@ -177,6 +179,9 @@ void dpc_packet_digest_fprint(FILE *fp, dpc_session_ctx_t *session, DHCP_PACKET
 	/* Also print rtt for replies. */
 	if (pevent == DPC_PACKET_RECEIVED && session->ftd_rtt) {
 		fprintf(fp, ", rtt: %.3f ms", 1000 * ncc_fr_time_to_float(session->ftd_rtt));
+		if (session->ftd_rtt_wire) {
+			fprintf(fp, " (wire: %.3f ms)", 1000 * ncc_fr_time_to_float(session->ftd_rtt_wire));
+		}
 	}
 	fprintf(fp, "\n");
 }
@@ -694,6 +699,105 @@ uint32_t dpc_xid_extract(VALUE_PAIR *vp)
 	return ntohl(value);
 }
 
+/*
+ *	Get a 32 bits option value (network byte order) in host byte order.
+ */
+static inline uint32_t dpc_option_uint32_get(uint8_t const *p)
+{
+	uint32_t value;
+
+	memcpy(&value, p, 4);
+	return ntohl(value);
+}
+
+/*
+ *	Scan a region of DHCP options, looking for the few we need to handle a reply.
+ *	Returns -1 if the options are malformed, 0 otherwise.
+ */
+static int dpc_reply_info_options_scan(dpc_reply_info_t *info, uint8_t const *p, uint8_t const *end, uint8_t *overload)
+{
+	while (p < end) {
+		if (*p == 0) { /* Pad. */
+			p++;
+			continue;
+		}
+		if (*p == 255) break; /* End. */
+
+		if ((p + 2 > end) || (p + 2 + p[1] > end)) {
+			fr_strerror_printf("Option %u overflows packet", p[0]);
+			return -1;
+		}
+
+		switch (p[0]) {
+		case 51: /* IP Address Lease Time. */
+			if (p[1] == 4 && !info->lease_time) info->lease_time = dpc_option_uint32_get(p + 2);
+			break;
+
+		case 52: /* Option Overload. */
+			if (overload && p[1] == 1) *overload = p[2];
+			break;
+
+		case 53: /* DHCP Message Type. */
+			if (p[1] == 1 && !info->code) info->code = p[2];
+			break;
+
+		case 54: /* Server Identifier. */
+			if (p[1] == 4 && !info->server_id) memcpy(&info->server_id, p + 2, 4);
+			break;
+
+		case 58: /* Renewal (T1) Time Value. */
+			if (p[1] == 4 && !info->t1) info->t1 = dpc_option_uint32_get(p + 2);
+			break;
+
+		case 59: /* Rebinding (T2) Time Value. */
+			if (p[1] == 4 && !info->t2) info->t2 = dpc_option_uint32_get(p + 2);
+			break;
+		}
+
+		p += 2 + p[1];
+	}
+	return 0;
+}
+
+/*
+ *	Extract from a reply the information we need to handle it (message type, xid, yiaddr, chaddr, server identifier,
+ *	and lease times),
+ *	directly from the packet data, without building the list of value pairs.
+ *	This does not allocate anything, and goes through the options only once.
+ *	Returns -1 if the packet is malformed, 0 otherwise.
+ */
+int dpc_reply_info_extract(dpc_reply_info_t *info, DHCP_PACKET *packet)
+{
+	uint8_t const *data = packet->data;
+	uint8_t overload = 0;
+
+	memset(info, 0, sizeof(*info));
+
+	if (!data || packet->data_len < 240) {
+		fr_strerror_printf("Packet too short (length: %zu)", packet->data_len);
+		return -1;
+	}
+
+	memcpy(&info->xid, data + 4, 4);
+	info->xid = ntohl(info->xid);
+	memcpy(&info->yiaddr, data + 16, 4);
+	memcpy(info->chaddr, data + 28, 6);
+
+	if (dpc_reply_info_options_scan(info, data + 240, data + packet->data_len, &overload) < 0) return -1;
+
+	/*
+	 *	Options may also be found in fields "file" then "sname" (RFC 2131, section 4.1).
+	 */
+	if ((overload & 1) && dpc_reply_info_options_scan(info, data + 108, data + 236, NULL) < 0) return -1;
+	if ((overload & 2) && dpc_reply_info_options_scan(info, data + 44, data + 108, NULL) < 0) return -1;
+
+	if (!info->code) {
+		fr_strerror_printf("No option 53 (message type) found");
+		return -1;
+	}
+	return 0;
+}
+
 /*
  *	Duplicate an input item (copy initially does not belong to any list).
  */
@@ -715,6 +819,8 @@ dpc_input_t *dpc_input_item_copy(TALLOC_CTX *ctx, dpc_input_t const *in)
 
 	MEM(fr_pair_list_copy(out, &out->vps, in->vps) >= 0);
 
+	if (in->rate_profile) out->rate_profile = dpc_rate_profile_copy(out, in->rate_profile);
+
 	return out;
 }
 
@@ -760,3 +866,338 @@ int dpc_ipaddr_is_broadcast(fr_ipaddr_t const *ipaddr)
 
 	return 0;
 }
+
+/*
+ *	Get the histogram bucket for a value (in microseconds).
+ */
+static uint32_t dpc_histogram_bucket(uint64_t value)
+{
+	uint32_t msb;
+
+	if (value < DPC_HISTO_SUB_BUCKETS) return value;
+	if (value >= ((uint64_t)1 << DPC_HISTO_MAX_BITS)) return DPC_HISTO_NUM_BUCKETS - 1;
+
+	msb = 63 - __builtin_clzll(value);
+	return ((msb - DPC_HISTO_SUB_BITS + 1) << DPC_HISTO_SUB_BITS)
+		+ (uint32_t)((value >> (msb - DPC_HISTO_SUB_BITS)) - DPC_HISTO_SUB_BUCKETS);
+}
+
+/*
+ *	Get the highest value (in microseconds) which would be counted in a given histogram bucket.
+ */
+static uint64_t dpc_histogram_bucket_value(uint32_t bucket)
+{
+	uint32_t block = bucket >> DPC_HISTO_SUB_BITS;
+	uint64_t sub = bucket & (DPC_HISTO_SUB_BUCKETS - 1);
+
+	if (block == 0) return sub;
+
+	return ((DPC_HISTO_SUB_BUCKETS + sub + 1) << (block - 1)) - 1;
+}
+
+/*
+ *	Record a value in a histogram. This is O(1), and does not allocate anything.
+ */
+void dpc_histogram_add(dpc_histogram_t *histo, fr_time_delta_t value)
+{
+	histo->buckets[dpc_histogram_bucket(value / 1000)] ++;
+}
+
+/*
+ *	Merge a histogram into another.
+ */
+void dpc_histogram_merge(dpc_histogram_t *histo, dpc_histogram_t const *in)
+{
+	int i;
+
+	for (i = 0; i < DPC_HISTO_NUM_BUCKETS; i++) {
+		histo->buckets[i] += in->buckets[i];
+	}
+}
+
+/*
+ *	Get the difference between a histogram and a previous state of it.
+ */
+void dpc_histogram_diff(dpc_histogram_t *out, dpc_histogram_t const *histo, dpc_histogram_t const *prev)
+{
+	int i;
+
+	for (i = 0; i < DPC_HISTO_NUM_BUCKETS; i++) {
+		out->buckets[i] = histo->buckets[i] - prev->buckets[i];
+	}
+}
+
+/*
+ *	Get values at given percentiles (which must be provided in ascending order) from a histogram of 'num' values.
+ *	The value reported for a percentile is the highest value which is equivalent (within the histogram precision)
+ *	to the actual value.
+ */
+void dpc_histogram_percentiles(fr_time_delta_t *out, dpc_histogram_t const *histo, uint32_t num,
+                               double const *percentiles, int num_percentiles)
+{
+	int i, p = 0;
+	uint64_t cumul = 0;
+
+	if (!num) {
+		for (p = 0; p < num_percentiles; p++) out[p] = 0;
+		return;
+	}
+
+	for (i = 0; i < DPC_HISTO_NUM_BUCKETS && p < num_percentiles; i++) {
+		cumul += histo->buckets[i];
+
+		while (p < num_percentiles) {
+			double rank = percentiles[p] * num / 100;
+			uint64_t target = rank;
+
+			if (target < rank || target == 0) target++; /* Round up. */
+			if (cumul < target) break;
+
+			out[p] = dpc_histogram_bucket_value(i) * 1000;
+			p++;
+		}
+	}
+
+	/* Should not happen, unless histogram and number of values are inconsistent. */
+	for (; p < num_percentiles; p++) out[p] = dpc_histogram_bucket_value(DPC_HISTO_NUM_BUCKETS - 1) * 1000;
+}
+
+/*
+ *	Parse a rate profile: a list of points (time in seconds, rate per second), e.g. "0:100, 600:50000, 900:50000".
+ *	Values can be separated by any of: spaces, tabs, new lines, ',', ':', ';'. Anything following a '#' on a line is
+ *	ignored (so a profile can be read from a file with one "<time> <rate>" point per line).
+ *	The target rate is interpolated linearly between two points, and the rate of the last point holds afterwards.
+ *	A step is obtained with two points at the same time.
+ */
+dpc_rate_profile_t *dpc_rate_profile_parse(TALLOC_CTX *ctx, char const *in)
+{
+	dpc_rate_profile_t *profile;
+	char const *p = in;
+	double values[2];
+	int n = 0;
+	uint32_t i;
+
+	MEM(profile = talloc_zero(ctx, dpc_rate_profile_t));
+
+	while (*p) {
+		char *end;
+
+		if (*p == '#') { /* Comment, skip until end of line. */
+			while (*p && *p != '\n') p++;
+			continue;
+		}
+		if (strchr(" \t\r\n,:;", *p)) {
+			p++;
+			continue;
+		}
+
+		values[n] = strtod(p, &end);
+		if (end == p) {
+			fr_strerror_printf("Invalid value at: \"%.20s\"", p);
+			goto error;
+		}
+		if (values[n] < 0) {
+			fr_strerror_printf("Negative value not allowed at: \"%.20s\"", p);
+			goto error;
+		}
+		p = end;
+
+		if (++n < 2) continue;
+		n = 0;
+
+		if (profile->num > 0 && values[0] < profile->points[profile->num - 1].time) {
+			fr_strerror_printf("Point times must be in ascending order (%.3f is before %.3f)",
+			                   values[0], profile->points[profile->num - 1].time);
+			goto error;
+		}
+
+		/* If the first point is not at time 0, add one with the same rate. */
+		if (profile->num == 0 && values[0] > 0) {
+			TALLOC_REALLOC_ZERO(profile, profile->points, dpc_rate_point_t, 0, 1);
+			profile->points[0].rate = values[1];
+			profile->num = 1;
+		}
+
+		TALLOC_REALLOC_ZERO(profile, profile->points, dpc_rate_point_t, profile->num, profile->num + 1);
+		profile->points[profile->num].time = values[0];
+		profile->points[profile->num].rate = values[1];
+		profile->num ++;
+	}
+
+	if (n != 0) {
+		fr_strerror_printf("Missing rate for time %.3f", values[0]);
+		goto error;
+	}
+	if (profile->num == 0) {
+		fr_strerror_printf("No point defined");
+		goto error;
+	}
+
+	/* Number of sessions due at each point. */
+	for (i = 1; i < profile->num; i++) {
+		dpc_rate_point_t *prev = &profile->points[i - 1], *this = &profile->points[i];
+
+		this->due = prev->due + (this->time - prev->time) * (prev->rate + this->rate) / 2;
+	}
+
+	return profile;
+
+error:
+	talloc_free(profile);
+	return NULL;
+}
+
+/*
+ *	Read a rate profile from a file.
+ */
+dpc_rate_profile_t *dpc_rate_profile_load(TALLOC_CTX *ctx, char const *filename)
+{
+	dpc_rate_profile_t *profile;
+	FILE *fp;
+	char *buf = NULL;
+	size_t len = 0;
+	char chunk[4096];
+	size_t n;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		fr_strerror_printf("Failed to open file \"%s\": %s", filename, fr_syserror(errno));
+		return NULL;
+	}
+
+	MEM(buf = talloc_strdup(ctx, ""));
+	while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+		MEM(buf = talloc_strndup_append_buffer(buf, chunk, n));
+		len += n;
+	}
+	fclose(fp);
+
+	if (strlen(buf) != len) {
+		fr_strerror_printf("Unexpected binary content in file \"%s\"", filename);
+		talloc_free(buf);
+		return NULL;
+	}
+
+	profile = dpc_rate_profile_parse(ctx, buf);
+	talloc_free(buf);
+	return profile;
+}
+
+/*
+ *	Copy a rate profile.
+ */
+dpc_rate_profile_t *dpc_rate_profile_copy(TALLOC_CTX *ctx, dpc_rate_profile_t const *in)
+{
+	dpc_rate_profile_t *out;
+
+	MEM(out = talloc_zero(ctx, dpc_rate_profile_t));
+	out->num = in->num;
+	MEM(out->points = talloc_memdup(out, in->points, in->num * sizeof(dpc_rate_point_t)));
+	return out;
+}
+
+/*
+ *	Scale a rate profile (e.g. to split it between several workers).
+ */
+void dpc_rate_profile_scale(dpc_rate_profile_t *profile, double factor)
+{
+	uint32_t i;
+
+	for (i = 0; i < profile->num; i++) {
+		profile->points[i].rate *= factor;
+		profile->points[i].due *= factor;
+	}
+}
+
+/*
+ *	Restart a rate profile at a given time, with a constant rate and a given number of sessions due at that time.
+ *	Whatever was scheduled before is forgotten (including sessions which were due, but could not be started).
+ */
+void dpc_rate_profile_restart(dpc_rate_profile_t *profile, double time, double rate, double due)
+{
+	if (profile->num == 0) {
+		TALLOC_REALLOC_ZERO(profile, profile->points, dpc_rate_point_t, 0, 1);
+	}
+	profile->num = 1;
+	profile->points[0].time = time;
+	profile->points[0].rate = rate;
+	profile->points[0].due = due;
+}
+
+/*
+ *	Get the last point of a rate profile which is at (or before) a given time.
+ */
+static uint32_t dpc_rate_profile_point(dpc_rate_profile_t const *profile, double t)
+{
+	uint32_t lo = 0, hi = profile->num - 1;
+
+	while (lo < hi) {
+		uint32_t mid = (lo + hi + 1) / 2;
+
+		if (profile->points[mid].time <= t) lo = mid;
+		else hi = mid - 1;
+	}
+	return lo;
+}
+
+/*
+ *	Get the target rate at a given time.
+ */
+double dpc_rate_profile_rate(dpc_rate_profile_t const *profile, double t)
+{
+	uint32_t i = dpc_rate_profile_point(profile, t);
+	dpc_rate_point_t const *this = &profile->points[i], *next;
+
+	if (i == profile->num - 1) return this->rate; /* Last rate holds. */
+
+	next = &profile->points[i + 1];
+	return this->rate + (next->rate - this->rate) * (t - this->time) / (next->time - this->time);
+}
+
+/*
+ *	Get the number of sessions due at a given time (i.e. the integral of the target rate since start).
+ */
+double dpc_rate_profile_due(dpc_rate_profile_t const *profile, double t)
+{
+	uint32_t i = dpc_rate_profile_point(profile, t);
+	dpc_rate_point_t const *this = &profile->points[i];
+
+	return this->due + (t - this->time) * (this->rate + dpc_rate_profile_rate(profile, t)) / 2;
+}
+
+/*
+ *	Get the time at which a given number of sessions is due (the inverse of dpc_rate_profile_due).
+ *	Returns a negative value if this never happens (the rate is 0 from some point on).
+ */
+double dpc_rate_profile_time(dpc_rate_profile_t const *profile, double due)
+{
+	uint32_t lo = 0, hi = profile->num - 1;
+	dpc_rate_point_t const *this, *next;
+	double accel, x;
+
+	/* Get the last point at which no more than 'due' sessions are due. */
+	while (lo < hi) {
+		uint32_t mid = (lo + hi + 1) / 2;
+
+		if (profile->points[mid].due <= due) lo = mid;
+		else hi = mid - 1;
+	}
+	this = &profile->points[lo];
+
+	if (lo == profile->num - 1) {
+		if (due <= this->due) return this->time;
+		if (this->rate <= 0) return -1;
+		return this->time + (due - this->due) / this->rate;
+	}
+
+	/* Rate changes linearly within this segment: solve rate * x + accel * x^2 / 2 = due - this->due */
+	next = &profile->points[lo + 1];
+	accel = (next->rate - this->rate) / (next->time - this->time);
+
+	if (accel == 0) {
+		x = (due - this->due) / this->rate; /* rate cannot be 0 here, otherwise next point would have the same due. */
+	} else {
+		x = (sqrt(this->rate * this->rate + 2 * accel * (due - this->due)) - this->rate) / accel;
+	}
+	return this->time + x;
+}
@@ -35,6 +35,22 @@ void dpc_octet_array_increment(uint8_t *array, int size, uint8_t low, uint8_t hi
 bool dpc_octet_increment(uint8_t *value, uint8_t low, uint8_t high);
 unsigned int dpc_message_type_extract(VALUE_PAIR *vp);
 uint32_t dpc_xid_extract(VALUE_PAIR *vp);
+int dpc_reply_info_extract(dpc_reply_info_t *info, DHCP_PACKET *packet);
+
+dpc_rate_profile_t *dpc_rate_profile_parse(TALLOC_CTX *ctx, char const *in);
+dpc_rate_profile_t *dpc_rate_profile_load(TALLOC_CTX *ctx, char const *filename);
+dpc_rate_profile_t *dpc_rate_profile_copy(TALLOC_CTX *ctx, dpc_rate_profile_t const *in);
+void dpc_rate_profile_scale(dpc_rate_profile_t *profile, double factor);
+void dpc_rate_profile_restart(dpc_rate_profile_t *profile, double time, double rate, double due);
+double dpc_rate_profile_rate(dpc_rate_profile_t const *profile, double t);
+double dpc_rate_profile_due(dpc_rate_profile_t const *profile, double t);
+double dpc_rate_profile_time(dpc_rate_profile_t const *profile, double due);
+
+void dpc_histogram_add(dpc_histogram_t *histo, fr_time_delta_t value);
+void dpc_histogram_merge(dpc_histogram_t *histo, dpc_histogram_t const *in);
+void dpc_histogram_diff(dpc_histogram_t *out, dpc_histogram_t const *histo, dpc_histogram_t const *prev);
+void dpc_histogram_percentiles(fr_time_delta_t *out, dpc_histogram_t const *histo, uint32_t num,
+                               double const *percentiles, int num_percentiles);
 
 dpc_input_t *dpc_input_item_copy(TALLOC_CTX *ctx, dpc_input_t const *in);
 void dpc_input_list_fprint(FILE *fp, ncc_list_t *list);
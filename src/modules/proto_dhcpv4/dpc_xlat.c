@@ -5,6 +5,7 @@
 
 #include "dhcperfcli.h"
 #include "ncc_xlat.h"
+#include "dpc_xlat.h"
 
 #include <freeradius-devel/server/xlat_priv.h>
 
@@ -41,3 +42,28 @@ ssize_t dpc_xlat_eval_compiled(char *out, size_t outlen, xlat_exp_t const *xlat,
 
 	return len;
 }
+
+/*
+ *	Set the value of a pair from its compiled xlat expression.
+ *	Use the native generator if there is one, otherwise expand the xlat and convert the string to the pair type.
+ */
+int dpc_xlat_pair_eval(VALUE_PAIR *vp, dpc_xlat_compiled_t const *compiled, DHCP_PACKET *packet)
+{
+	char buffer[DPC_XLAT_MAX_LEN];
+	ssize_t len;
+
+	vp->vp_ptr = NULL; /* Otherwise fr_pair_value_strcpy would free our compiled xlat! */
+
+	if (compiled->gen) return ncc_xlat_gen_eval(vp, compiled->gen);
+
+	len = dpc_xlat_eval_compiled(buffer, sizeof(buffer), compiled->xlat, packet);
+	if (len <= 0) { /* Consider empty string as failed expansion. */
+		fr_strerror_printf("Failed to expand xlat '%s': %s", vp->da->name, fr_strerror());
+		return -1;
+	}
+
+	DEBUG_TRACE("xlat %s = [%s] => (len: %zd) [%s]", vp->da->name, vp->xlat, len, buffer);
+
+	/* Convert the xlat'ed string to the appropriate type. */
+	return ncc_pair_value_from_str(vp, buffer);
+}
@@ -6,5 +6,17 @@
 
 #define DPC_XLAT_MAX_LEN 4096
 
+/*
+ *	Compiled xlat expression of an input value pair (stored in the value pair "generic pointer" vp_ptr).
+ *	If the whole value is produced by one of our range functions, it also has a native generator.
+ *	It is shared by all the copies of an input item.
+ */
+typedef struct dpc_xlat_compiled {
+	xlat_exp_t *xlat;         //!< Compiled xlat expression.
+	ncc_xlat_gen_t *gen;      //!< Native generator (NULL if the xlat engine is needed).
+	uint32_t refs;            //!< Number of input items which share it (only with streamed input).
+} dpc_xlat_compiled_t;
+
 ssize_t dpc_xlat_eval(char *out, size_t outlen, char const *fmt, DHCP_PACKET *packet);
 ssize_t dpc_xlat_eval_compiled(char *out, size_t outlen, xlat_exp_t const *xlat, DHCP_PACKET *packet);
+int dpc_xlat_pair_eval(VALUE_PAIR *vp, dpc_xlat_compiled_t const *compiled, DHCP_PACKET *packet);
@@ -126,22 +126,6 @@ typedef struct ncc_endpoint_list {
 } ncc_endpoint_list_t;
 
 
-/* Get visibility on fr_event_timer_t opaque struct (fr_event_timer is defined in lib/util/event.c) */
-typedef struct ncc_fr_event_timer {
-	fr_event_list_t		*el;			//!< because talloc_parent() is O(N) in number of objects
-	fr_time_t		when;			//!< When this timer should fire.
-	/* We don't need anything beyond that. */
-} ncc_fr_event_timer_t;
-
-/* Get visibility on fr_event_list_t opaque struct (fr_event_list is defined in lib/util/event.c) */
-typedef struct ncc_fr_event_list {
-	fr_heap_t		*times;			//!< of timer events to be executed.
-	/* We don't need anything beyond that. */
-} ncc_fr_event_list_t;
-
-
-int ncc_fr_event_timer_peek(fr_event_list_t *fr_el, fr_time_t *when);
-
 void ncc_log_init(FILE *log_fp, int debug_lvl, int debug_dev);
 void ncc_printf_log(char const *fmt, ...);
 void ncc_log_dev_printf(char const *file, int line, char const *fmt, ...);
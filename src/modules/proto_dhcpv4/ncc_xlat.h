@@ -27,6 +27,9 @@ void ncc_xlat_init_request(VALUE_PAIR *vps);
 void ncc_xlat_set_num(uint64_t num);
 int ncc_xlat_get_rcode(void);
 int ncc_xlat_file_add(char const *filename);
+void ncc_xlat_file_shard(uint32_t index, uint32_t count);
+uint32_t ncc_xlat_frame_set_alloc(void);
+void ncc_xlat_frame_set_free(uint32_t id_set);
 
 int ncc_parse_num_range(uint64_t *num1, uint64_t *num2, char const *in);
 ssize_t ncc_xlat_num_range(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, char const *fmt);
@@ -40,4 +43,10 @@ int ncc_parse_ethaddr_range(uint8_t ethaddr1[6], uint8_t ethaddr2[6], char const
 ssize_t ncc_xlat_ethaddr_range(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, char const *fmt);
 ssize_t ncc_xlat_ethaddr_rand(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, char const *fmt);
 
+/* A native generator (which is an xlat frame of its own). */
+typedef struct ncc_xlat_frame ncc_xlat_gen_t;
+
+ncc_xlat_gen_t *ncc_xlat_gen_compile(TALLOC_CTX *ctx, char const *in, fr_type_t type);
+int ncc_xlat_gen_eval(VALUE_PAIR *vp, ncc_xlat_gen_t *gen);
+
 void ncc_xlat_register(void);
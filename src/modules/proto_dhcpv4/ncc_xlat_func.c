@@ -13,11 +13,16 @@
 
 #include <freeradius-devel/server/xlat_priv.h>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 
 /*
  *	Xlat names.
  */
 #define NCC_XLAT_FILE          "file"
+#define NCC_XLAT_FILE_RAND     "file.rand"
 #define NCC_XLAT_NUM_RANGE     "num.range"
 #define NCC_XLAT_NUM_RAND      "num.rand"
 #define NCC_XLAT_IPADDR_RANGE  "ipaddr.range"
@@ -32,6 +37,7 @@
  */
 typedef enum {
 	NCC_CTX_TYPE_FILE = 1,
+	NCC_CTX_TYPE_FILE_RAND,
 	NCC_CTX_TYPE_NUM_RANGE,
 	NCC_CTX_TYPE_NUM_RAND,
 	NCC_CTX_TYPE_IPADDR_RANGE,
@@ -41,12 +47,6 @@ typedef enum {
 } ncc_xlat_frame_type_t;
 
 typedef struct ncc_xlat_frame {
-	/* Generic chaining */
-	ncc_list_t *list;       //!< The list to which this entry belongs (NULL for an unchained entry).
-	ncc_list_item_t *prev;
-	ncc_list_item_t *next;
-
-	/* Specific item data */
 	uint32_t num;
 	ncc_xlat_frame_type_t type;
 
@@ -73,18 +73,46 @@ typedef struct ncc_xlat_frame {
 
 } ncc_xlat_frame_t;
 
+/*
+ *	Xlat frames of an input item, indexed by the position of the xlat function call in its expansions.
+ */
+typedef struct ncc_xlat_frame_set {
+	ncc_xlat_frame_t *frames;
+	uint32_t num;
+	uint32_t next_free;     //!< Next set in the free list (if this one is free).
+} ncc_xlat_frame_set_t;
+
+/*
+ *	A file from which values are read (one per line).
+ *	The file is memory mapped (read-only), and the offset of each line is indexed when the file is added.
+ */
 typedef struct ncc_xlat_file {
-	FILE *fp;
+	uint8_t const *data;    //!< File content.
+	size_t size;
+	size_t *lines;          //!< Offset of each line, and an extra one: (end of last line) + 1.
+	uint32_t num_lines;
+	uint32_t next;          //!< Next line to be read sequentially.
 } ncc_xlat_file_t;
 
 static TALLOC_CTX *xlat_ctx;
 
-static ncc_list_t *ncc_xlat_frame_list; /* This is an array of lists. */
-static uint32_t num_xlat_frame_list = 0;
+/*
+ *	Sets of xlat frames, indexed by a set id obtained from ncc_xlat_frame_set_alloc.
+ *	Ids of sets which have been freed are reused, so the number of sets is bounded by the number of input items
+ *	alive at the same time (not the number of input items ever read, e.g. when they are streamed).
+ */
+static ncc_xlat_frame_set_t *ncc_xlat_frame_sets;
+static uint32_t num_xlat_frame_sets = 0; /* Number of sets allocated. */
+static uint32_t num_xlat_frame_sets_used = 0; /* Number of set ids handed out (free or not). */
+static uint32_t xlat_frame_set_free_head = UINT32_MAX; /* First free set id. */
 
 static ncc_xlat_file_t *ncc_xlat_file_list;
 static uint32_t num_xlat_file = 0;
 
+/* Lines of xlat files which we use (e.g. for a worker): index, index + count, index + 2 * count, etc. */
+static uint32_t xlat_file_shard_index = 0;
+static uint32_t xlat_file_shard_count = 1;
+
 
 void ncc_xlat_init()
 {
@@ -93,8 +121,21 @@ void ncc_xlat_init()
 
 void ncc_xlat_free()
 {
+	uint32_t i;
+
+	for (i = 0; i < num_xlat_file; i++) {
+		munmap((void *)ncc_xlat_file_list[i].data, ncc_xlat_file_list[i].size);
+	}
+	num_xlat_file = 0;
+
 	if (FX_request) TALLOC_FREE(FX_request);
 	TALLOC_FREE(xlat_ctx);
+
+	/* These were allocated in the xlat context. */
+	ncc_xlat_frame_sets = NULL;
+	num_xlat_frame_sets = 0;
+	num_xlat_frame_sets_used = 0;
+	xlat_frame_set_free_head = UINT32_MAX;
 }
 
 /*
@@ -156,23 +197,87 @@ int ncc_xlat_get_rcode()
 }
 
 /*
- *	Add a xlat file from which values will be read sequentially.
+ *	Add a xlat file from which values will be read (one per line).
+ *	The file is memory mapped, and its lines are indexed, so that any line can be obtained directly.
  */
 int ncc_xlat_file_add(char const *filename)
 {
-	FILE *fp = fopen(filename, "r");
-	if (!fp) {
+	int fd;
+	struct stat st;
+	void *data;
+	ncc_xlat_file_t *file;
+	uint8_t const *p, *end, *eol;
+	uint32_t num_lines = 0;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0) {
 		ERROR("Error opening %s: %s", filename, strerror(errno));
 		return -1;
 	}
 
+	if (fstat(fd, &st) < 0) {
+		ERROR("Error reading %s: %s", filename, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (st.st_size == 0) {
+		ERROR("Error reading %s: file is empty", filename);
+		close(fd);
+		return -1;
+	}
+
+	/* Read-only private mapping: pages are shared with other processes (e.g. workers) which map the same file. */
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		ERROR("Error mapping %s: %s", filename, strerror(errno));
+		return -1;
+	}
+
 	ncc_xlat_file_list = talloc_realloc(xlat_ctx, ncc_xlat_file_list, ncc_xlat_file_t, num_xlat_file + 1);
-	ncc_xlat_file_list[num_xlat_file].fp = fp;
+	file = &ncc_xlat_file_list[num_xlat_file];
+	memset(file, 0, sizeof(*file));
+	file->data = data;
+	file->size = st.st_size;
+
+	/* Count lines first, so the index is allocated only once. A last line need not end with a \n. */
+	end = file->data + file->size;
+	for (p = file->data; p < end; p = eol + 1) {
+		eol = memchr(p, '\n', end - p);
+		num_lines++;
+		if (!eol) break;
+	}
+
+	MEM(file->lines = talloc_array(xlat_ctx, size_t, num_lines + 1));
+	file->num_lines = 0;
+	for (p = file->data; p < end; p = eol + 1) {
+		file->lines[file->num_lines++] = p - file->data;
+		eol = memchr(p, '\n', end - p);
+		if (!eol) eol = end; /* The extra offset is then (end of file) + 1. */
+	}
+	file->lines[file->num_lines] = eol + 1 - file->data;
+
 	num_xlat_file++;
 
 	return 0;
 }
 
+/*
+ *	Only use a shard of the lines of xlat files: index, index + count, index + 2 * count, etc.
+ *	This allows several workers to use the same files without ever using the same values.
+ */
+void ncc_xlat_file_shard(uint32_t index, uint32_t count)
+{
+	uint32_t i;
+
+	xlat_file_shard_index = index;
+	xlat_file_shard_count = count ? count : 1;
+
+	for (i = 0; i < num_xlat_file; i++) {
+		ncc_xlat_file_list[i].next = index % ncc_xlat_file_list[i].num_lines;
+	}
+}
+
 
 #define XLAT_ERR_RETURN \
 	request->rcode = -1; \
@@ -186,35 +291,75 @@ static ncc_xlat_frame_t *ncc_xlat_get_ctx(TALLOC_CTX *ctx)
 {
 	ncc_xlat_frame_t *xlat_frame;
 
-	uint32_t id_list = FX_request->number;
+	uint32_t id_set = FX_request->number;
 	uint32_t id_item = FX_request->child_number;
 
-	/* Get the list for this input item. If it doesn't exist yet, allocate a new one. */
-	ncc_list_t *list;
-	if (id_list >= num_xlat_frame_list) {
-		uint32_t num_xlat_frame_list_pre = num_xlat_frame_list;
-		num_xlat_frame_list = id_list + 1;
+	/* Get the set of frames for this input item (it has been allocated beforehand). */
+	ncc_xlat_frame_set_t *set;
+	if (id_set >= num_xlat_frame_sets_used) {
+		fr_strerror_printf("Invalid xlat frame set: %u", id_set);
+		return NULL;
+	}
+	set = &ncc_xlat_frame_sets[id_set];
 
-		/* Allocate lists to all input items, even if they don't need xlat'ing. This is simpler. */
-		TALLOC_REALLOC_ZERO(ctx, ncc_xlat_frame_list, ncc_list_t,
-		                    num_xlat_frame_list_pre, num_xlat_frame_list);
+	/*
+	 *	Now get the xlat context. If it doesn't exist yet, add a new one to the set.
+	 *	This only happens on the first expansion of an input item: afterwards, the set holds all the frames needed.
+	 *	(Frames may be moved when the set grows, so they must not be referenced beyond the current xlat call.)
+	 */
+	if (id_item >= set->num) {
+		TALLOC_REALLOC_ZERO(ctx, set->frames, ncc_xlat_frame_t, set->num, id_item + 1);
+		set->num = id_item + 1;
+		set->frames[id_item].num = id_item;
 	}
-	list = &ncc_xlat_frame_list[id_list];
+	xlat_frame = &set->frames[id_item];
 
-	/* Now get the xlat context. If it doesn't exist yet, allocate a new one and add it to the list. */
-	xlat_frame = NCC_LIST_INDEX(list, id_item);
-	if (!xlat_frame) {
-		/* We don't have a context element yet, need to add a new one. */
-		MEM(xlat_frame = talloc_zero(ctx, ncc_xlat_frame_t));
+	FX_request->child_number ++; /* Prepare next xlat context. */
 
-		xlat_frame->num = id_item;
+	return xlat_frame;
+}
 
-		NCC_LIST_ENQUEUE(list, xlat_frame);
+/*
+ *	Get a set of xlat frames for an input item: reuse one which has been freed, or else add a new one.
+ *	Returns the id of the set (to be provided to ncc_xlat_set_num).
+ */
+uint32_t ncc_xlat_frame_set_alloc(void)
+{
+	uint32_t id_set = xlat_frame_set_free_head;
+
+	if (id_set != UINT32_MAX) {
+		xlat_frame_set_free_head = ncc_xlat_frame_sets[id_set].next_free;
+		ncc_xlat_frame_sets[id_set].next_free = UINT32_MAX;
+		return id_set;
 	}
 
-	FX_request->child_number ++; /* Prepare next xlat context. */
+	if (num_xlat_frame_sets_used == num_xlat_frame_sets) {
+		uint32_t num_xlat_frame_sets_pre = num_xlat_frame_sets;
 
-	return xlat_frame;
+		/* Grow geometrically, so that we don't realloc for each new input item. */
+		num_xlat_frame_sets = num_xlat_frame_sets ? num_xlat_frame_sets * 2 : 64;
+
+		TALLOC_REALLOC_ZERO(xlat_ctx, ncc_xlat_frame_sets, ncc_xlat_frame_set_t,
+		                    num_xlat_frame_sets_pre, num_xlat_frame_sets);
+	}
+
+	id_set = num_xlat_frame_sets_used ++;
+	ncc_xlat_frame_sets[id_set].next_free = UINT32_MAX;
+	return id_set;
+}
+
+/*
+ *	Free the xlat frames of an input item which will not be used anymore. The set id can then be reused.
+ */
+void ncc_xlat_frame_set_free(uint32_t id_set)
+{
+	if (id_set >= num_xlat_frame_sets_used) return;
+
+	TALLOC_FREE(ncc_xlat_frame_sets[id_set].frames);
+	ncc_xlat_frame_sets[id_set].num = 0;
+
+	ncc_xlat_frame_sets[id_set].next_free = xlat_frame_set_free_head;
+	xlat_frame_set_free_head = id_set;
 }
 
 
@@ -244,6 +389,49 @@ int ncc_parse_file(uint32_t *num_file, char const *in)
 	return 0;
 }
 
+/*
+ *	Initialize a file xlat frame (of type NCC_CTX_TYPE_FILE or NCC_CTX_TYPE_FILE_RAND).
+ */
+static int ncc_xlat_frame_file_init(ncc_xlat_frame_t *xlat_frame, ncc_xlat_frame_type_t type, char const *fmt)
+{
+	uint32_t num_file;
+
+	if (ncc_parse_file(&num_file, fmt) < 0) {
+		fr_strerror_printf("Failed to parse xlat file: %s", fr_strerror());
+		return -1;
+	}
+
+	xlat_frame->type = type;
+	xlat_frame->file.num = num_file;
+	return 0;
+}
+
+/*
+ *	Get the next line (sequentially, or randomly) from a file xlat frame, within the lines of our shard.
+ *	This points directly into the file content, which is not terminated by a \0.
+ */
+static char const *ncc_xlat_frame_file_next(size_t *len, ncc_xlat_frame_t *xlat_frame)
+{
+	ncc_xlat_file_t *file = &ncc_xlat_file_list[xlat_frame->file.num];
+	uint32_t first = xlat_file_shard_index % file->num_lines;
+	uint32_t line;
+
+	if (xlat_frame->type == NCC_CTX_TYPE_FILE_RAND) {
+		uint32_t num_shard = (file->num_lines - first + xlat_file_shard_count - 1) / xlat_file_shard_count;
+
+		line = first + (fr_rand() % num_shard) * xlat_file_shard_count;
+	} else {
+		line = file->next;
+
+		/* Prepare next line. After the last one, rewind. */
+		file->next += xlat_file_shard_count;
+		if (file->next >= file->num_lines) file->next = first;
+	}
+
+	*len = file->lines[line + 1] - file->lines[line] - 1;
+	return (char const *)file->data + file->lines[line];
+}
+
 /** Read values sequentially from a file.
  *
  *  %{file:<index>} - where <index> (0, 1, ...) correspond to xlat files added through ncc_xlat_file_add.
@@ -252,6 +440,9 @@ static ssize_t _ncc_xlat_file(UNUSED TALLOC_CTX *ctx, char **out, size_t outlen,
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
+	char const *value;
+	size_t len;
+
 	*out = NULL;
 
 	/* Do *not* use the TALLOC context we get from FreeRADIUS. We don't want our contexts to be freed. */
@@ -260,39 +451,46 @@ static ssize_t _ncc_xlat_file(UNUSED TALLOC_CTX *ctx, char **out, size_t outlen,
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		uint32_t num_file;
-		if (ncc_parse_file(&num_file, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat file: %s", fr_strerror());
+		if (ncc_xlat_frame_file_init(xlat_frame, NCC_CTX_TYPE_FILE, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_FILE;
-		xlat_frame->file.num = num_file;
 	}
 
-	FILE *fp = ncc_xlat_file_list[xlat_frame->file.num].fp;
-	if (!fp) {
-		return -1;
-	}
+	value = ncc_xlat_frame_file_next(&len, xlat_frame);
 
-	char buf[8192];
-	if (fgets(buf, sizeof(buf), fp) == NULL) {
-		/* Rewind file. Then read again. */
-		fseek(fp, 0L, SEEK_SET);
+	*out = talloc_strndup(ctx, value, len);
+	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
 
-		if (fgets(buf, sizeof(buf), fp) == NULL) {
-			/* Should never happen: even if the file is empty, we can read once (obtaining an empty string). */
-			return -1;
+	return strlen(*out);
+}
+
+/** Read values randomly from a file.
+ *
+ *  %{file.rand:<index>}
+ */
+static ssize_t _ncc_xlat_file_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t outlen,
+				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
+				UNUSED REQUEST *request, char const *fmt)
+{
+	char const *value;
+	size_t len;
+
+	*out = NULL;
+
+	/* Do *not* use the TALLOC context we get from FreeRADIUS. We don't want our contexts to be freed. */
+	ncc_xlat_frame_t *xlat_frame = ncc_xlat_get_ctx(xlat_ctx);
+	if (!xlat_frame) return -1; /* Cannot happen. */
+
+	if (!xlat_frame->type) {
+		/* Not yet parsed. */
+		if (ncc_xlat_frame_file_init(xlat_frame, NCC_CTX_TYPE_FILE_RAND, fmt) < 0) {
+			XLAT_ERR_RETURN;
 		}
 	}
 
-	/* Remove trailing \n if there is one. */
-	size_t len = strlen(buf);
-	if (len > 0 && buf[len-1] == '\n') {
-		buf[--len] = '\0';
-	}
+	value = ncc_xlat_frame_file_next(&len, xlat_frame);
 
-	*out = talloc_strdup(ctx, buf);
+	*out = talloc_strndup(ctx, value, len);
 	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
 
 	return strlen(*out);
@@ -350,6 +548,52 @@ int ncc_parse_num_range(uint64_t *num1, uint64_t *num2, char const *in)
 	return 0;
 }
 
+/*
+ *	Initialize a num range xlat frame (of type NCC_CTX_TYPE_NUM_RANGE or NCC_CTX_TYPE_NUM_RAND).
+ */
+static int ncc_xlat_frame_num_init(ncc_xlat_frame_t *xlat_frame, ncc_xlat_frame_type_t type, char const *fmt)
+{
+	uint64_t num1, num2;
+
+	if (ncc_parse_num_range(&num1, &num2, fmt) < 0) {
+		fr_strerror_printf("Failed to parse xlat num range: %s", fr_strerror());
+		return -1;
+	}
+
+	xlat_frame->type = type;
+	xlat_frame->num_range.min = num1;
+	xlat_frame->num_range.max = num2;
+	xlat_frame->num_range.next = num1;
+	return 0;
+}
+
+/*
+ *	Get the next value (increasing or random) from a num range xlat frame.
+ */
+static uint64_t ncc_xlat_frame_num_next(ncc_xlat_frame_t *xlat_frame)
+{
+	uint64_t delta, value;
+
+	if (xlat_frame->type == NCC_CTX_TYPE_NUM_RAND) {
+		double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
+
+		//delta = xlat_frame->num_range.max - xlat_frame->num_range.min + 1;
+		delta = xlat_frame->num_range.max - xlat_frame->num_range.min;
+		if (delta < UINT64_MAX) delta++; /* Don't overthrow. */
+		return (uint64_t)(rnd * delta) + xlat_frame->num_range.min;
+	}
+
+	value = xlat_frame->num_range.next;
+
+	/* Prepare next value. */
+	if (xlat_frame->num_range.next == xlat_frame->num_range.max) {
+		xlat_frame->num_range.next = xlat_frame->num_range.min;
+	} else {
+		xlat_frame->num_range.next ++;
+	}
+	return value;
+}
+
 /** Generate increasing numeric values from a range.
  *
  *  %{num.range:1000-2000} -> 1000, 1001, etc.
@@ -366,28 +610,14 @@ static ssize_t _ncc_xlat_num_range(UNUSED TALLOC_CTX *ctx, char **out, size_t ou
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		uint64_t num1, num2;
-		if (ncc_parse_num_range(&num1, &num2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat num range: %s", fr_strerror());
+		if (ncc_xlat_frame_num_init(xlat_frame, NCC_CTX_TYPE_NUM_RANGE, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_NUM_RANGE;
-		xlat_frame->num_range.min = num1;
-		xlat_frame->num_range.max = num2;
-		xlat_frame->num_range.next = num1;
 	}
 
-	*out = talloc_typed_asprintf(ctx, "%lu", xlat_frame->num_range.next);
+	*out = talloc_typed_asprintf(ctx, "%lu", ncc_xlat_frame_num_next(xlat_frame));
 	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
 
-	/* Prepare next value. */
-	if (xlat_frame->num_range.next == xlat_frame->num_range.max) {
-		xlat_frame->num_range.next = xlat_frame->num_range.min;
-	} else {
-		xlat_frame->num_range.next ++;
-	}
-
 	return strlen(*out);
 }
 
@@ -404,8 +634,6 @@ static ssize_t _ncc_xlat_num_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t out
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
-	uint64_t delta, value;
-
 	*out = NULL;
 
 	/* Do *not* use the TALLOC context we get from FreeRADIUS. We don't want our contexts to be freed. */
@@ -414,25 +642,12 @@ static ssize_t _ncc_xlat_num_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t out
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		uint64_t num1, num2;
-		if (ncc_parse_num_range(&num1, &num2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat num range: %s", fr_strerror());
+		if (ncc_xlat_frame_num_init(xlat_frame, NCC_CTX_TYPE_NUM_RAND, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_NUM_RAND;
-		xlat_frame->num_range.min = num1;
-		xlat_frame->num_range.max = num2;
 	}
 
-	double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
-
-	//delta = xlat_frame->num_range.max - xlat_frame->num_range.min + 1;
-	delta = xlat_frame->num_range.max - xlat_frame->num_range.min;
-	if (delta < UINT64_MAX) delta++; /* Don't overthrow. */
-	value = (uint64_t)(rnd * delta) + xlat_frame->num_range.min;
-
-	*out = talloc_typed_asprintf(ctx, "%lu", value);
+	*out = talloc_typed_asprintf(ctx, "%lu", ncc_xlat_frame_num_next(xlat_frame));
 	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
 
 	return strlen(*out);
@@ -443,7 +658,6 @@ ssize_t ncc_xlat_num_rand(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, cha
 	return _ncc_xlat_num_rand(ctx, out, outlen, NULL, NULL, NULL, fmt);
 }
 
-
 /*
  *	Parse an IPv4 range "<IP1>-<IP2>" and extract <IP1> / <IP2> as fr_ipaddr_t.
  */
@@ -503,6 +717,75 @@ int ncc_parse_ipaddr_range(fr_ipaddr_t *ipaddr1, fr_ipaddr_t *ipaddr2, char cons
 	return 0;
 }
 
+/*
+ *	Initialize an IP addr range xlat frame (of type NCC_CTX_TYPE_IPADDR_RANGE or NCC_CTX_TYPE_IPADDR_RAND).
+ */
+static int ncc_xlat_frame_ipaddr_init(ncc_xlat_frame_t *xlat_frame, ncc_xlat_frame_type_t type, char const *fmt)
+{
+	fr_ipaddr_t ipaddr1, ipaddr2;
+
+	if (ncc_parse_ipaddr_range(&ipaddr1, &ipaddr2, fmt) < 0) {
+		fr_strerror_printf("Failed to parse xlat ipaddr range: %s", fr_strerror());
+		return -1;
+	}
+
+	xlat_frame->type = type;
+	xlat_frame->ipaddr_range.min = ipaddr1.addr.v4.s_addr;
+	xlat_frame->ipaddr_range.max = ipaddr2.addr.v4.s_addr;
+	xlat_frame->ipaddr_range.next = ipaddr1.addr.v4.s_addr;
+	return 0;
+}
+
+/*
+ *	Get the next value (increasing or random) from an IP addr range xlat frame, in network byte order.
+ */
+static uint32_t ncc_xlat_frame_ipaddr_next(ncc_xlat_frame_t *xlat_frame)
+{
+	uint32_t num1, num2, value;
+	uint64_t delta; /* Allow UINT32_MAX + 1. */
+
+	if (xlat_frame->type == NCC_CTX_TYPE_IPADDR_RAND) {
+		num1 = ntohl(xlat_frame->ipaddr_range.min);
+		num2 = ntohl(xlat_frame->ipaddr_range.max);
+
+		double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
+
+		delta = (uint64_t)num2 - num1 + 1;
+		value = (uint32_t)(rnd * delta) + num1;
+		return htonl(value);
+	}
+
+	value = xlat_frame->ipaddr_range.next;
+
+	/* Prepare next value. */
+	if (xlat_frame->ipaddr_range.next == xlat_frame->ipaddr_range.max) {
+		xlat_frame->ipaddr_range.next = xlat_frame->ipaddr_range.min;
+	} else {
+		xlat_frame->ipaddr_range.next = htonl(ntohl(xlat_frame->ipaddr_range.next) + 1);
+	}
+	return value;
+}
+
+/*
+ *	Print the next value from an IP addr range xlat frame.
+ */
+static ssize_t ncc_xlat_frame_ipaddr_print(TALLOC_CTX *ctx, char **out, ncc_xlat_frame_t *xlat_frame)
+{
+	char ipaddr_buf[FR_IPADDR_STRLEN] = "";
+	struct in_addr addr;
+
+	addr.s_addr = ncc_xlat_frame_ipaddr_next(xlat_frame);
+	if (inet_ntop(AF_INET, &addr, ipaddr_buf, sizeof(ipaddr_buf)) == NULL) { /* Cannot happen. */
+		fr_strerror_printf("%s", fr_syserror(errno));
+		return -1;
+	}
+
+	*out = talloc_typed_asprintf(ctx, "%s", ipaddr_buf);
+	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
+
+	return strlen(*out);
+}
+
 /** Generate increasing IP addr values from a range.
  *
  *  %{ipaddr.range:10.0.0.1-10.0.0.255} -> 10.0.0.1, 10.0.0.2, etc.
@@ -511,6 +794,8 @@ static ssize_t _ncc_xlat_ipaddr_range(UNUSED TALLOC_CTX *ctx, char **out, size_t
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
+	ssize_t len;
+
 	*out = NULL;
 
 	/* Do *not* use the TALLOC context we get from FreeRADIUS. We don't want our contexts to be freed. */
@@ -519,37 +804,16 @@ static ssize_t _ncc_xlat_ipaddr_range(UNUSED TALLOC_CTX *ctx, char **out, size_t
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		fr_ipaddr_t ipaddr1, ipaddr2;
-		if (ncc_parse_ipaddr_range(&ipaddr1, &ipaddr2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat ipaddr range: %s", fr_strerror());
+		if (ncc_xlat_frame_ipaddr_init(xlat_frame, NCC_CTX_TYPE_IPADDR_RANGE, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_IPADDR_RANGE;
-		xlat_frame->ipaddr_range.min = ipaddr1.addr.v4.s_addr;
-		xlat_frame->ipaddr_range.max = ipaddr2.addr.v4.s_addr;
-		xlat_frame->ipaddr_range.next = ipaddr1.addr.v4.s_addr;
 	}
 
-	char ipaddr_buf[FR_IPADDR_STRLEN] = "";
-	struct in_addr addr;
-	addr.s_addr = xlat_frame->ipaddr_range.next;
-	if (inet_ntop(AF_INET, &addr, ipaddr_buf, sizeof(ipaddr_buf)) == NULL) { /* Cannot happen. */
-		fr_strerror_printf("%s", fr_syserror(errno));
+	len = ncc_xlat_frame_ipaddr_print(ctx, out, xlat_frame);
+	if (len < 0) {
 		XLAT_ERR_RETURN;
 	}
-
-	*out = talloc_typed_asprintf(ctx, "%s", ipaddr_buf);
-	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
-
-	/* Prepare next value. */
-	if (xlat_frame->ipaddr_range.next == xlat_frame->ipaddr_range.max) {
-		xlat_frame->ipaddr_range.next = xlat_frame->ipaddr_range.min;
-	} else {
-		xlat_frame->ipaddr_range.next = htonl(ntohl(xlat_frame->ipaddr_range.next) + 1);
-	}
-
-	return strlen(*out);
+	return len;
 }
 
 ssize_t ncc_xlat_ipaddr_range(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, char const *fmt)
@@ -567,8 +831,7 @@ static ssize_t _ncc_xlat_ipaddr_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
-	uint32_t num1, num2, value;
-	uint64_t delta; /* Allow UINT32_MAX + 1. */
+	ssize_t len;
 
 	*out = NULL;
 
@@ -578,36 +841,16 @@ static ssize_t _ncc_xlat_ipaddr_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		fr_ipaddr_t ipaddr1, ipaddr2;
-		if (ncc_parse_ipaddr_range(&ipaddr1, &ipaddr2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat ipaddr range: %s", fr_strerror());
+		if (ncc_xlat_frame_ipaddr_init(xlat_frame, NCC_CTX_TYPE_IPADDR_RAND, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_IPADDR_RAND;
-		xlat_frame->ipaddr_range.min = ipaddr1.addr.v4.s_addr;
-		xlat_frame->ipaddr_range.max = ipaddr2.addr.v4.s_addr;
 	}
 
-	num1 = ntohl(xlat_frame->ipaddr_range.min);
-	num2 = ntohl(xlat_frame->ipaddr_range.max);
-
-	double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
-
-	delta = (uint64_t)num2 - num1 + 1;
-	value = (uint32_t)(rnd * delta) + num1;
-
-	char ipaddr_buf[FR_IPADDR_STRLEN] = "";
-	struct in_addr addr;
-	addr.s_addr = htonl(value);;
-	if (inet_ntop(AF_INET, &addr, ipaddr_buf, sizeof(ipaddr_buf)) == NULL) { /* Cannot happen. */
-		fr_strerror_printf("%s", fr_syserror(errno));
+	len = ncc_xlat_frame_ipaddr_print(ctx, out, xlat_frame);
+	if (len < 0) {
 		XLAT_ERR_RETURN;
 	}
-	*out = talloc_typed_asprintf(ctx, "%s", ipaddr_buf);
-	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
-
-	return strlen(*out);
+	return len;
 }
 
 ssize_t ncc_xlat_ipaddr_rand(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen, char const *fmt)
@@ -615,7 +858,6 @@ ssize_t ncc_xlat_ipaddr_rand(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen,
 	return _ncc_xlat_ipaddr_rand(ctx, out, outlen, NULL, NULL, NULL, fmt);
 }
 
-
 /*
  *	Parse an Ethernet address range "<Ether1>-<Ether2>" and extract <Ether1> / <Ether2> as uint8_t[6].
  */
@@ -686,6 +928,67 @@ int ncc_parse_ethaddr_range(uint8_t ethaddr1[6], uint8_t ethaddr2[6], char const
 	return 0;
 }
 
+/*
+ *	Initialize an Ethernet addr range xlat frame (of type NCC_CTX_TYPE_ETHADDR_RANGE or NCC_CTX_TYPE_ETHADDR_RAND).
+ */
+static int ncc_xlat_frame_ethaddr_init(ncc_xlat_frame_t *xlat_frame, ncc_xlat_frame_type_t type, char const *fmt)
+{
+	uint8_t ethaddr1[6], ethaddr2[6];
+
+	if (ncc_parse_ethaddr_range(ethaddr1, ethaddr2, fmt) < 0) {
+		fr_strerror_printf("Failed to parse xlat ethaddr range: %s", fr_strerror());
+		return -1;
+	}
+
+	xlat_frame->type = type;
+	memcpy(xlat_frame->ethaddr_range.min, ethaddr1, 6);
+	memcpy(xlat_frame->ethaddr_range.max, ethaddr2, 6);
+	memcpy(xlat_frame->ethaddr_range.next, ethaddr1, 6);
+	return 0;
+}
+
+/*
+ *	Get the next value (increasing or random) from an Ethernet addr range xlat frame.
+ */
+static void ncc_xlat_frame_ethaddr_next(uint8_t out[6], ncc_xlat_frame_t *xlat_frame)
+{
+	uint64_t num1 = 0, num2 = 0, delta;
+	uint64_t value;
+
+	if (xlat_frame->type == NCC_CTX_TYPE_ETHADDR_RAND) {
+		memcpy(&num1, xlat_frame->ethaddr_range.min, 6);
+		num1 = (ntohll(num1) >> 16);
+
+		memcpy(&num2, xlat_frame->ethaddr_range.max, 6);
+		num2 = (ntohll(num2) >> 16);
+
+		double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
+
+		delta = num2 - num1 + 1;
+		value = (uint64_t)(rnd * delta) + num1;
+
+		value = htonll(value << 16);
+		memcpy(out, &value, 6);
+		return;
+	}
+
+	memcpy(out, xlat_frame->ethaddr_range.next, 6);
+
+	/* Prepare next value. */
+	if (memcmp(xlat_frame->ethaddr_range.next, xlat_frame->ethaddr_range.max, 6) == 0) {
+		memcpy(xlat_frame->ethaddr_range.next, xlat_frame->ethaddr_range.min, 6);
+	} else {
+		/* Store the 6 octets of Ethernet addr in a uint64_t to perform an integer increment.
+		 */
+		uint64_t ethaddr = 0;
+		memcpy(&ethaddr, xlat_frame->ethaddr_range.next, 6);
+
+		ethaddr = (ntohll(ethaddr) >> 16) + 1;
+		ethaddr = htonll(ethaddr << 16);
+		memcpy(xlat_frame->ethaddr_range.next, &ethaddr, 6);
+	}
+}
+
 /** Generate increasing Ethernet addr values from a range.
  *
  *  %{ethaddr.range:01:02:03:04:05:06-01:02:03:04:05:ff} -> 01:02:03:04:05:06, 01:02:03:04:05:07, etc.
@@ -694,6 +997,8 @@ static ssize_t _ncc_xlat_ethaddr_range(UNUSED TALLOC_CTX *ctx, char **out, size_
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
+	uint8_t ethaddr[6];
+
 	*out = NULL;
 
 	/* Do *not* use the TALLOC context we get from FreeRADIUS. We don't want our contexts to be freed. */
@@ -702,38 +1007,19 @@ static ssize_t _ncc_xlat_ethaddr_range(UNUSED TALLOC_CTX *ctx, char **out, size_
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		uint8_t ethaddr1[6], ethaddr2[6];
-		if (ncc_parse_ethaddr_range(ethaddr1, ethaddr2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat ethaddr range: %s", fr_strerror());
+		if (ncc_xlat_frame_ethaddr_init(xlat_frame, NCC_CTX_TYPE_ETHADDR_RANGE, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_ETHADDR_RANGE;
-		memcpy(xlat_frame->ethaddr_range.min, ethaddr1, 6);
-		memcpy(xlat_frame->ethaddr_range.max, ethaddr2, 6);
-		memcpy(xlat_frame->ethaddr_range.next, ethaddr1, 6);
 	}
 
+	ncc_xlat_frame_ethaddr_next(ethaddr, xlat_frame);
+
 	char ethaddr_buf[NCC_ETHADDR_STRLEN] = "";
-	ncc_ether_addr_sprint(ethaddr_buf, xlat_frame->ethaddr_range.next);
+	ncc_ether_addr_sprint(ethaddr_buf, ethaddr);
 
 	*out = talloc_typed_asprintf(ctx, "%s", ethaddr_buf);
 	/* Note: we allocate our own output buffer (outlen = 0) as specified when registering. */
 
-	/* Prepare next value. */
-	if (memcmp(xlat_frame->ethaddr_range.next, xlat_frame->ethaddr_range.max, 6) == 0) {
-		memcpy(xlat_frame->ethaddr_range.next, xlat_frame->ethaddr_range.min, 6);
-	} else {
-		/* Store the 6 octets of Ethernet addr in a uint64_t to perform an integer increment.
-		 */
-		uint64_t ethaddr = 0;
-		memcpy(&ethaddr, xlat_frame->ethaddr_range.next, 6);
-
-		ethaddr = (ntohll(ethaddr) >> 16) + 1;
-		ethaddr = htonll(ethaddr << 16);
-		memcpy(xlat_frame->ethaddr_range.next, &ethaddr, 6);
-	}
-
 	return strlen(*out);
 }
 
@@ -752,8 +1038,6 @@ static ssize_t _ncc_xlat_ethaddr_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t
 				UNUSED void const *mod_inst, UNUSED void const *xlat_inst,
 				UNUSED REQUEST *request, char const *fmt)
 {
-	uint64_t num1 = 0, num2 = 0, delta;
-	uint64_t value;
 	uint8_t ethaddr[6];
 
 	*out = NULL;
@@ -763,30 +1047,12 @@ static ssize_t _ncc_xlat_ethaddr_rand(UNUSED TALLOC_CTX *ctx, char **out, size_t
 
 	if (!xlat_frame->type) {
 		/* Not yet parsed. */
-		uint8_t ethaddr1[6], ethaddr2[6];
-		if (ncc_parse_ethaddr_range(ethaddr1, ethaddr2, fmt) < 0) {
-			fr_strerror_printf("Failed to parse xlat ethaddr range: %s", fr_strerror());
+		if (ncc_xlat_frame_ethaddr_init(xlat_frame, NCC_CTX_TYPE_ETHADDR_RAND, fmt) < 0) {
 			XLAT_ERR_RETURN;
 		}
-
-		xlat_frame->type = NCC_CTX_TYPE_ETHADDR_RAND;
-		memcpy(xlat_frame->ethaddr_range.min, ethaddr1, 6);
-		memcpy(xlat_frame->ethaddr_range.max, ethaddr2, 6);
 	}
 
-	memcpy(&num1, xlat_frame->ethaddr_range.min, 6);
-	num1 = (ntohll(num1) >> 16);
-
-	memcpy(&num2, xlat_frame->ethaddr_range.max, 6);
-	num2 = (ntohll(num2) >> 16);
-
-	double rnd = (double)fr_rand() / UINT32_MAX; /* Random value between 0..1 */
-
-	delta = num2 - num1 + 1;
-	value = (uint64_t)(rnd * delta) + num1;
-
-	value = htonll(value << 16);
-	memcpy(ethaddr, &value, 6);
+	ncc_xlat_frame_ethaddr_next(ethaddr, xlat_frame);
 
 	char ethaddr_buf[NCC_ETHADDR_STRLEN] = "";
 	ncc_ether_addr_sprint(ethaddr_buf, ethaddr);
@@ -802,7 +1068,6 @@ ssize_t ncc_xlat_ethaddr_rand(TALLOC_CTX *ctx, char **out, UNUSED size_t outlen,
 	return _ncc_xlat_ethaddr_rand(ctx, out, outlen, NULL, NULL, NULL, fmt);
 }
 
-
 /** Generate a string of random chars
  *
  *  Reuse from FreeRADIUS xlat_func_randstr (src/lib/server/xlat_func.c)
@@ -983,6 +1248,181 @@ static ssize_t _ncc_xlat_randstr(UNUSED TALLOC_CTX *ctx, char **out, size_t outl
 }
 
 
+/*
+ *	Native generators.
+ *	An xlat expression which consists only of one of our range or file functions (e.g. "%{ethaddr.range:...}") can be
+ *	evaluated without the xlat engine: values are produced in binary form and set directly in the value pair,
+ *	instead of being printed to a string which is then parsed back.
+ *	A generator holds its state in a frame of its own (not in the sets of frames of input items).
+ */
+static struct {
+	char const *name;
+	ncc_xlat_frame_type_t type;
+} ncc_xlat_gen_funcs[] = {
+	{ NCC_XLAT_FILE,          NCC_CTX_TYPE_FILE },
+	{ NCC_XLAT_FILE_RAND,     NCC_CTX_TYPE_FILE_RAND },
+	{ NCC_XLAT_NUM_RANGE,     NCC_CTX_TYPE_NUM_RANGE },
+	{ NCC_XLAT_NUM_RAND,      NCC_CTX_TYPE_NUM_RAND },
+	{ NCC_XLAT_IPADDR_RANGE,  NCC_CTX_TYPE_IPADDR_RANGE },
+	{ NCC_XLAT_IPADDR_RAND,   NCC_CTX_TYPE_IPADDR_RAND },
+	{ NCC_XLAT_ETHADDR_RANGE, NCC_CTX_TYPE_ETHADDR_RANGE },
+	{ NCC_XLAT_ETHADDR_RAND,  NCC_CTX_TYPE_ETHADDR_RAND },
+
+	{ NULL }
+};
+
+/*
+ *	Compile a native generator from a xlat expression, for a value pair of a given type.
+ *	Returns NULL if the expression is not suitable: it must be exactly one call to a range function (nothing nested,
+ *	nothing else around it), which produces values of that type. This is not an error, the expression is then just
+ *	handled by the xlat engine (which will also report any parsing error).
+ */
+ncc_xlat_gen_t *ncc_xlat_gen_compile(TALLOC_CTX *ctx, char const *in, fr_type_t type)
+{
+	ncc_xlat_frame_t *gen;
+	char const *p, *end;
+	char *fmt = NULL;
+	size_t in_len, name_len;
+	uint64_t type_max;
+	int i, ret;
+
+	in_len = strlen(in);
+	if (in_len < 4 || strncmp(in, "%{", 2) != 0 || in[in_len - 1] != '}') return NULL;
+
+	p = in + 2;
+	end = in + in_len - 1;
+	if (memchr(p, '%', end - p) || memchr(p, '{', end - p) || memchr(p, '}', end - p)) return NULL;
+
+	name_len = strcspn(p, ":}");
+	for (i = 0; ncc_xlat_gen_funcs[i].name; i++) {
+		if (strlen(ncc_xlat_gen_funcs[i].name) == name_len
+		    && strncmp(ncc_xlat_gen_funcs[i].name, p, name_len) == 0) break;
+	}
+	if (!ncc_xlat_gen_funcs[i].name) return NULL;
+
+	/* Values produced must be of the value pair type. */
+	switch (ncc_xlat_gen_funcs[i].type) {
+	case NCC_CTX_TYPE_FILE:
+	case NCC_CTX_TYPE_FILE_RAND:
+		break; /* Lines are converted to whatever type is needed. */
+
+	case NCC_CTX_TYPE_NUM_RANGE:
+	case NCC_CTX_TYPE_NUM_RAND:
+		if (type == FR_TYPE_UINT8) type_max = UINT8_MAX;
+		else if (type == FR_TYPE_UINT16) type_max = UINT16_MAX;
+		else if (type == FR_TYPE_UINT32) type_max = UINT32_MAX;
+		else if (type == FR_TYPE_UINT64) type_max = UINT64_MAX;
+		else return NULL;
+		break;
+
+	case NCC_CTX_TYPE_IPADDR_RANGE:
+	case NCC_CTX_TYPE_IPADDR_RAND:
+		if (type != FR_TYPE_IPV4_ADDR) return NULL;
+		break;
+
+	case NCC_CTX_TYPE_ETHADDR_RANGE:
+	case NCC_CTX_TYPE_ETHADDR_RAND:
+		if (type != FR_TYPE_ETHERNET) return NULL;
+		break;
+
+	default:
+		return NULL;
+	}
+
+	if (p[name_len] == ':') MEM(fmt = talloc_strndup(NULL, p + name_len + 1, end - (p + name_len + 1)));
+
+	MEM(gen = talloc_zero(ctx, ncc_xlat_frame_t));
+
+	switch (ncc_xlat_gen_funcs[i].type) {
+	case NCC_CTX_TYPE_FILE:
+	case NCC_CTX_TYPE_FILE_RAND:
+		ret = ncc_xlat_frame_file_init(gen, ncc_xlat_gen_funcs[i].type, fmt);
+		break;
+
+	case NCC_CTX_TYPE_NUM_RANGE:
+	case NCC_CTX_TYPE_NUM_RAND:
+		ret = ncc_xlat_frame_num_init(gen, ncc_xlat_gen_funcs[i].type, fmt);
+		/* Values which would not fit are not handled the same as when parsed from a string. */
+		if (ret == 0 && gen->num_range.max > type_max) ret = -1;
+		break;
+
+	case NCC_CTX_TYPE_IPADDR_RANGE:
+	case NCC_CTX_TYPE_IPADDR_RAND:
+		ret = ncc_xlat_frame_ipaddr_init(gen, ncc_xlat_gen_funcs[i].type, fmt);
+		break;
+
+	default:
+		ret = ncc_xlat_frame_ethaddr_init(gen, ncc_xlat_gen_funcs[i].type, fmt);
+		break;
+	}
+	talloc_free(fmt);
+
+	if (ret < 0) {
+		talloc_free(gen);
+		return NULL;
+	}
+	return gen;
+}
+
+/*
+ *	Evaluate a native generator: set the next value directly in the value pair.
+ */
+int ncc_xlat_gen_eval(VALUE_PAIR *vp, ncc_xlat_gen_t *gen)
+{
+	uint64_t num;
+	fr_type_t type = vp->da->type;
+	char const *line;
+	size_t len;
+
+	vp->type = VT_DATA;
+	vp->vp_type = type;
+
+	switch (gen->type) {
+	case NCC_CTX_TYPE_FILE:
+	case NCC_CTX_TYPE_FILE_RAND:
+		/* Convert the line directly from the file content. */
+		line = ncc_xlat_frame_file_next(&len, gen);
+		return fr_value_box_from_str(vp, &vp->data, &type, NULL, line, len, '\0', false);
+
+	case NCC_CTX_TYPE_NUM_RANGE:
+	case NCC_CTX_TYPE_NUM_RAND:
+		num = ncc_xlat_frame_num_next(gen);
+		switch (vp->da->type) {
+		case FR_TYPE_UINT8:
+			vp->vp_uint8 = num;
+			break;
+		case FR_TYPE_UINT16:
+			vp->vp_uint16 = num;
+			break;
+		case FR_TYPE_UINT32:
+			vp->vp_uint32 = num;
+			break;
+		default:
+			vp->vp_uint64 = num;
+			break;
+		}
+		break;
+
+	case NCC_CTX_TYPE_IPADDR_RANGE:
+	case NCC_CTX_TYPE_IPADDR_RAND:
+		memset(&vp->vp_ip, 0, sizeof(vp->vp_ip));
+		vp->vp_ip.af = AF_INET;
+		vp->vp_ip.prefix = 32;
+		vp->vp_ipv4addr = ncc_xlat_frame_ipaddr_next(gen);
+		break;
+
+	case NCC_CTX_TYPE_ETHADDR_RANGE:
+	case NCC_CTX_TYPE_ETHADDR_RAND:
+		ncc_xlat_frame_ethaddr_next(vp->vp_ether, gen);
+		break;
+
+	default: /* Cannot happen. */
+		fr_strerror_printf("Not a native generator");
+		return -1;
+	}
+	return 0;
+}
+
 /*
  *	Register our own xlat functions (and implicitly initialize the xlat framework).
  */
@@ -991,6 +1431,7 @@ void ncc_xlat_register(void)
 	ncc_xlat_init();
 
 	ncc_xlat_core_register(NULL, NCC_XLAT_FILE, _ncc_xlat_file, NULL, NULL, 0, 0, true);
+	ncc_xlat_core_register(NULL, NCC_XLAT_FILE_RAND, _ncc_xlat_file_rand, NULL, NULL, 0, 0, true);
 
 	ncc_xlat_core_register(NULL, NCC_XLAT_NUM_RANGE, _ncc_xlat_num_range, NULL, NULL, 0, 0, true);
 	ncc_xlat_core_register(NULL, NCC_XLAT_NUM_RAND, _ncc_xlat_num_rand, NULL, NULL, 0, 0, true);